@@ -1,15 +1,15 @@
 from os.path import join
 Import("env")
 
-# Add library source files to build
+# Add library source files to build (from the libdeps folder of the environment being built)
 env.BuildSources(
     join("$BUILD_DIR", "lib_crypto"),
-    join("$PROJECT_DIR", ".pio", "libdeps", "native", "Crypto"),
+    join("$PROJECT_DIR", ".pio", "libdeps", "$PIOENV", "Crypto"),
 )
 
 env.BuildSources(
     join("$BUILD_DIR", "lib_base64"),
-    join("$PROJECT_DIR", ".pio", "libdeps", "native", "base64_encode", "src"),
+    join("$PROJECT_DIR", ".pio", "libdeps", "$PIOENV", "base64_encode", "src"),
 )
 
 # Add mock files
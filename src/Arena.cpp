@@ -0,0 +1,114 @@
+#include "Arena.h"
+#include <cstring>
+
+static const size_t ARENA_ALIGNMENT = alignof(std::max_align_t);
+
+static inline size_t alignUp(size_t value)
+{
+    return (value + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+}
+
+Arena::Arena(uint8_t *buffer, size_t capacity)
+    : buffer_(buffer)
+    , capacity_(capacity)
+{
+    // Start handing out memory from the first aligned address in the buffer
+    size_t misalignment = reinterpret_cast<uintptr_t>(buffer) % ARENA_ALIGNMENT;
+    if (misalignment != 0) {
+        size_t skip = ARENA_ALIGNMENT - misalignment;
+        buffer_ += skip;
+        capacity_ = capacity > skip ? capacity - skip : 0;
+    }
+}
+
+void *Arena::allocate(size_t size)
+{
+    size_t offset = alignUp(used_);
+    if (offset > capacity_ || size > capacity_ - offset) {
+        exhausted_ = true;
+        return nullptr;
+    }
+    last_offset_ = offset;
+    used_ = offset + size;
+    if (used_ > high_water_) {
+        high_water_ = used_;
+    }
+    return buffer_ + offset;
+}
+
+bool Arena::extend(void *ptr, size_t new_size)
+{
+    if (ptr != buffer_ + last_offset_ || used_ == 0) {
+        return false;
+    }
+    if (new_size > capacity_ - last_offset_) {
+        exhausted_ = true;
+        return false;
+    }
+    used_ = last_offset_ + new_size;
+    if (used_ > high_water_) {
+        high_water_ = used_;
+    }
+    return true;
+}
+
+void Arena::reset()
+{
+    used_ = 0;
+    last_offset_ = 0;
+    exhausted_ = false;
+}
+
+void Arena::rewind(size_t mark)
+{
+    if (mark < used_) {
+        used_ = mark;
+        last_offset_ = mark;
+    }
+    exhausted_ = false;
+}
+
+// Block header, padded so the payload keeps the arena's alignment
+static const size_t BLOCK_HEADER_SIZE = alignUp(sizeof(size_t));
+
+void *ArenaJsonAllocator::allocate(size_t size)
+{
+    if (!arena_) {
+        return nullptr;
+    }
+    uint8_t *block = static_cast<uint8_t *>(arena_->allocate(BLOCK_HEADER_SIZE + size));
+    if (!block) {
+        return nullptr;
+    }
+    memcpy(block, &size, sizeof(size));
+    return block + BLOCK_HEADER_SIZE;
+}
+
+void ArenaJsonAllocator::deallocate(void *)
+{
+    // Released in bulk by Arena::reset()
+}
+
+void *ArenaJsonAllocator::reallocate(void *ptr, size_t new_size)
+{
+    if (!ptr) {
+        return allocate(new_size);
+    }
+    uint8_t *block = static_cast<uint8_t *>(ptr) - BLOCK_HEADER_SIZE;
+    size_t old_size;
+    memcpy(&old_size, block, sizeof(old_size));
+
+    if (new_size <= old_size || arena_->extend(block, BLOCK_HEADER_SIZE + new_size)) {
+        // Shrinking keeps the block where it is; growing the newest block happens in place
+        if (new_size > old_size) {
+            memcpy(block, &new_size, sizeof(new_size));
+        }
+        return ptr;
+    }
+
+    void *moved = allocate(new_size);
+    if (moved) {
+        memcpy(moved, ptr, old_size);
+    }
+    return moved;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <ArduinoJson.h>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Worst-case arena footprint of a single blockchain command, in bytes.
+ *
+ * The arena is reset at the start of every command, so the budget only has to cover the
+ * largest one, which is the "send" of update-sent carrying an encrypted secret:
+ *   - command document and its serialized form:          ~2.0 KiB
+ *   - post object, signed request body and "cmds" wrapper: ~3.5 KiB
+ *   - secret encryption scratch (decoded PEM key, AES and base64 buffers): ~2.0 KiB
+ *   - /local response body and parsed document (director key included): ~3.5 KiB
+ *   - inflate window for a compressed /local response: INFLATE_WINDOW_SIZE (4 KiB by default)
+ * A 16 KiB arena leaves about 1 KiB of headroom above the sum of these. Retries rewind the arena
+ * to just after the signed request body, so a retried command needs no more than one attempt.
+ */
+#define BLOCKCHAIN_ARENA_MIN_SIZE 16384
+
+/**
+ * A bump allocator over a single caller-provided buffer.
+ *
+ * Allocations are never freed individually; the whole arena is released with reset().
+ * When a request does not fit, allocate() returns nullptr and the arena is flagged as
+ * exhausted instead of falling back to the heap, so callers can fail deterministically.
+ */
+class Arena
+{
+  public:
+    /**
+     * @param buffer The pre-reserved memory the arena hands out. Must outlive the arena.
+     * @param capacity The size of the buffer in bytes.
+     */
+    Arena(uint8_t *buffer, size_t capacity);
+
+    /**
+     * Returns a block of at least size bytes aligned for any fundamental type, or nullptr if
+     * the arena is exhausted.
+     */
+    void *allocate(size_t size);
+
+    /**
+     * Grows the most recent allocation in place.
+     *
+     * @return True if ptr is the most recent allocation and the new size fits, otherwise false.
+     */
+    bool extend(void *ptr, size_t new_size);
+
+    /**
+     * Releases every allocation and clears the exhausted flag. The high-water mark is kept.
+     */
+    void reset();
+
+    /**
+     * Returns the current fill level, to be passed to rewind().
+     */
+    size_t mark() const { return used_; }
+
+    /**
+     * Releases every allocation made since mark was taken and clears the exhausted flag.
+     * Allocations made before it stay valid but can no longer be extended in place.
+     */
+    void rewind(size_t mark);
+
+    size_t used() const { return used_; }
+    size_t capacity() const { return capacity_; }
+    size_t highWater() const { return high_water_; }
+    bool exhausted() const { return exhausted_; }
+
+  private:
+    uint8_t *buffer_;
+    size_t capacity_;
+    size_t used_ = 0;
+    size_t last_offset_ = 0;
+    size_t high_water_ = 0;
+    bool exhausted_ = false;
+};
+
+/**
+ * ArduinoJson allocator that serves JsonDocument memory from an Arena.
+ *
+ * Each block carries a small size header so reallocate() can copy the old contents when a
+ * block cannot be grown in place. deallocate() is a no-op; memory returns on Arena::reset().
+ */
+class ArenaJsonAllocator : public ArduinoJson::Allocator
+{
+  public:
+    explicit ArenaJsonAllocator(Arena *arena = nullptr) : arena_(arena) {}
+
+    void setArena(Arena *arena) { arena_ = arena; }
+
+    void *allocate(size_t size) override;
+    void deallocate(void *ptr) override;
+    void *reallocate(void *ptr, size_t new_size) override;
+
+  private:
+    Arena *arena_;
+};
@@ -0,0 +1,115 @@
+#include "BeaconBatch.h"
+#include "Blake2bBatch.h"
+#include <cstring>
+
+// Leaves hashed per blake2b256Batch call
+static const size_t LEAF_CHUNK = 16;
+
+static int hexDigit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool BeaconBatch::encodeLeaf(const std::string &publicKey, uint32_t packetId, const String &secret,
+                             uint8_t leaf[BEACON_LEAF_SIZE])
+{
+    if (publicKey.length() != 64) {
+        return false;
+    }
+    uint8_t *p = leaf;
+    *p++ = MERKLE_LEAF_TAG;
+    for (size_t i = 0; i < 32; i++) {
+        int high = hexDigit(publicKey[2 * i]);
+        int low = hexDigit(publicKey[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        *p++ = static_cast<uint8_t>(high << 4 | low);
+    }
+    for (int i = 0; i < 4; i++) {
+        *p++ = static_cast<uint8_t>(packetId >> (8 * i));
+    }
+    const uint8_t *message = reinterpret_cast<const uint8_t *>(secret.c_str());
+    size_t length = secret.length();
+    blake2b256Batch(&message, &length, 1, reinterpret_cast<uint8_t(*)[32]>(p));
+    return true;
+}
+
+void BeaconBatch::reserve(size_t leaf_count)
+{
+    public_keys_.reserve(leaf_count);
+    pending_.reserve(leaf_count * BEACON_LEAF_SIZE);
+    tree_.reserve(leaf_count);
+}
+
+int BeaconBatch::add(const std::string &publicKey, uint32_t packetId, const String &secret)
+{
+    if (size() >= BEACON_BATCH_MAX_LEAVES) {
+        return -1;
+    }
+    size_t offset = pending_.size();
+    pending_.resize(offset + BEACON_LEAF_SIZE);
+    if (!encodeLeaf(publicKey, packetId, secret, &pending_[offset])) {
+        pending_.resize(offset);
+        return -1;
+    }
+    public_keys_.push_back(publicKey);
+    return public_keys_.size() - 1;
+}
+
+void BeaconBatch::flush()
+{
+    size_t count = pending_.size() / BEACON_LEAF_SIZE;
+    const uint8_t *messages[LEAF_CHUNK];
+    size_t lengths[LEAF_CHUNK];
+    for (size_t first = 0; first < count; first += LEAF_CHUNK) {
+        size_t chunk = count - first < LEAF_CHUNK ? count - first : LEAF_CHUNK;
+        for (size_t i = 0; i < chunk; i++) {
+            messages[i] = &pending_[(first + i) * BEACON_LEAF_SIZE];
+            lengths[i] = BEACON_LEAF_SIZE;
+        }
+        tree_.appendData(messages, lengths, chunk);
+    }
+    pending_.clear();
+}
+
+const uint8_t *BeaconBatch::root()
+{
+    flush();
+    return tree_.root();
+}
+
+bool BeaconBatch::proof(size_t index, MerkleProof &proof)
+{
+    flush();
+    return tree_.proof(index, proof);
+}
+
+void BeaconBatch::clear()
+{
+    public_keys_.clear();
+    pending_.clear();
+    tree_.clear();
+}
+
+bool BeaconBatch::leafHash(const std::string &publicKey, uint32_t packetId, const String &secret,
+                           uint8_t hash[MERKLE_HASH_SIZE])
+{
+    uint8_t leaf[BEACON_LEAF_SIZE];
+    if (!encodeLeaf(publicKey, packetId, secret, leaf)) {
+        return false;
+    }
+    const uint8_t *message = leaf;
+    size_t length = sizeof(leaf);
+    blake2b256Batch(&message, &length, 1, reinterpret_cast<uint8_t(*)[32]>(hash));
+    return true;
+}
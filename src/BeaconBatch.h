@@ -0,0 +1,92 @@
+#pragma once
+#include <Arduino.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MerkleTree.h"
+
+// Nodes committed by one update-sent-batch transaction
+#define BEACON_BATCH_MAX_LEAVES 1024
+
+// Leaf data: MERKLE_LEAF_TAG, node public key, packet id (little-endian) and BLAKE2b-256 of the encrypted secret
+#define BEACON_LEAF_SIZE (1 + 32 + 4 + MERKLE_HASH_SIZE)
+
+// Gas for the batch transaction, growing with the node keys it marks; 1024 leaves stay under the block limit
+#define BEACON_BATCH_GAS_BASE 1000
+#define BEACON_BATCH_GAS_PER_LEAF 100
+
+/**
+ * Collects the beacons of many nodes into one Merkle-committed update-sent-batch transaction.
+ *
+ * A gateway adds each node's encrypted secret as it arrives. The transaction only carries the
+ * Merkle root and the node keys; the secrets go to the director off-chain together with their
+ * inclusion proofs, which the director (or the node itself) checks against the root on chain with
+ * leafHash and MerkleTree::verify. Leaves are staged and hashed in BLAKE2b lanes when the root
+ * or a proof is first needed.
+ *
+ * update-sent-batch is not part of the deployed free.mesh03 contract yet; see
+ * BlockchainHandler::submitBeaconBatch.
+ */
+class BeaconBatch
+{
+  public:
+    /**
+     * Reserves room for leaf_count nodes.
+     */
+    void reserve(size_t leaf_count);
+
+    /**
+     * Adds a node's beacon.
+     *
+     * @param publicKey The node's public key, 64 hex digits.
+     * @param packetId The packet id the secret was generated for.
+     * @param secret The encrypted secret, as produced by EncryptionHandler::encrypt.
+     * @return The leaf index, or -1 if the batch is full or the key is malformed.
+     */
+    int add(const std::string &publicKey, uint32_t packetId, const String &secret);
+
+    size_t size() const { return public_keys_.size(); }
+
+    /**
+     * Returns the node keys in leaf order.
+     */
+    const std::vector<std::string> &publicKeys() const { return public_keys_; }
+
+    /**
+     * Returns the Merkle root, or nullptr for an empty batch.
+     */
+    const uint8_t *root();
+
+    /**
+     * Fills the inclusion proof of a leaf.
+     */
+    bool proof(size_t index, MerkleProof &proof);
+
+    /**
+     * Returns the gas limit the batch transaction needs.
+     */
+    uint32_t gasLimit() const { return BEACON_BATCH_GAS_BASE + BEACON_BATCH_GAS_PER_LEAF * size(); }
+
+    /**
+     * Empties the batch, keeping its memory for the next one.
+     */
+    void clear();
+
+    /**
+     * Computes the leaf hash of a beacon, e.g. for the director to verify a proof.
+     *
+     * @return False if the key is malformed.
+     */
+    static bool leafHash(const std::string &publicKey, uint32_t packetId, const String &secret,
+                         uint8_t hash[MERKLE_HASH_SIZE]);
+
+  private:
+    static bool encodeLeaf(const std::string &publicKey, uint32_t packetId, const String &secret,
+                           uint8_t leaf[BEACON_LEAF_SIZE]);
+    void flush();
+
+    std::vector<std::string> public_keys_;
+    std::vector<uint8_t> pending_;
+    MerkleTree tree_;
+};
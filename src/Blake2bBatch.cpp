@@ -0,0 +1,232 @@
+#include "Blake2bBatch.h"
+#include <cstring>
+
+static const uint64_t BLAKE2B_IV[8] = {0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL,
+                                       0xa54ff53a5f1d36f1ULL, 0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+                                       0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL};
+
+static const uint8_t BLAKE2B_SIGMA[12][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15}, {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4}, {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13}, {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11}, {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5}, {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15}, {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+};
+
+// Parameter block word 0 for an unkeyed 32-byte digest: digest length, key length 0, fanout and depth 1
+static const uint64_t BLAKE2B_256_PARAMETERS = 0x01010020ULL;
+
+// Lane state laid out word-major, so word i of every lane is contiguous and loads as one vector
+template <size_t LANES>
+struct LaneBlock {
+    uint64_t h[8][LANES];
+    uint64_t m[16][LANES];
+    uint64_t t[LANES];
+    uint64_t f[LANES];
+};
+
+// Vectors are only passed by reference: by value they would hit the vector ABI outside the target functions
+template <typename V>
+static inline __attribute__((always_inline)) void rotateRight(V &x, int n)
+{
+    x = (x >> n) | (x << (64 - n));
+}
+
+template <typename V>
+static inline __attribute__((always_inline)) void mix(V v[16], int a, int b, int c, int d, const V &x, const V &y)
+{
+    v[a] = v[a] + v[b] + x;
+    v[d] = v[d] ^ v[a];
+    rotateRight(v[d], 32);
+    v[c] = v[c] + v[d];
+    v[b] = v[b] ^ v[c];
+    rotateRight(v[b], 24);
+    v[a] = v[a] + v[b] + y;
+    v[d] = v[d] ^ v[a];
+    rotateRight(v[d], 16);
+    v[c] = v[c] + v[d];
+    v[b] = v[b] ^ v[c];
+    rotateRight(v[b], 63);
+}
+
+// One BLAKE2b compression per lane; V holds one 64-bit word of every lane
+template <typename V, size_t LANES>
+static inline __attribute__((always_inline)) void compressLanes(LaneBlock<LANES> &block)
+{
+    V h[8], m[16], v[16];
+    for (int i = 0; i < 8; i++) {
+        memcpy(&h[i], block.h[i], sizeof(V));
+    }
+    for (int i = 0; i < 16; i++) {
+        memcpy(&m[i], block.m[i], sizeof(V));
+    }
+    V t, f;
+    memcpy(&t, block.t, sizeof(V));
+    memcpy(&f, block.f, sizeof(V));
+
+    for (int i = 0; i < 8; i++) {
+        v[i] = h[i];
+        v[i + 8] = V{} + BLAKE2B_IV[i];
+    }
+    v[12] = v[12] ^ t;
+    v[14] = v[14] ^ f;
+
+    // Unrolled, so the message schedule resolves to fixed registers
+#pragma GCC unroll 12
+    for (int round = 0; round < 12; round++) {
+        const uint8_t *s = BLAKE2B_SIGMA[round];
+        mix(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+        mix(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+        mix(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+        mix(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+        mix(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+        mix(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+        mix(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+        mix(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        h[i] = h[i] ^ v[i] ^ v[i + 8];
+        memcpy(block.h[i], &h[i], sizeof(V));
+    }
+}
+
+static void compress1(LaneBlock<1> &block)
+{
+    compressLanes<uint64_t, 1>(block);
+}
+
+#if BLAKE2B_BATCH_X86
+typedef uint64_t U64x4 __attribute__((vector_size(32)));
+typedef uint64_t U64x8 __attribute__((vector_size(64)));
+
+__attribute__((target("avx2"))) static void compress4(LaneBlock<4> &block)
+{
+    compressLanes<U64x4, 4>(block);
+}
+
+__attribute__((target("avx512f"))) static void compress8(LaneBlock<8> &block)
+{
+    compressLanes<U64x8, 8>(block);
+}
+#endif
+
+static inline uint64_t loadWord(const uint8_t *p)
+{
+    uint64_t value = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(&value, p, sizeof(value));
+#else
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+#endif
+    return value;
+}
+
+template <size_t LANES>
+static void hashLanes(const uint8_t *const messages[], const size_t lengths[], size_t count, uint8_t hashes[][32],
+                      void (*compress)(LaneBlock<LANES> &))
+{
+    LaneBlock<LANES> block = {};
+    size_t message[LANES];
+    size_t offset[LANES];
+    bool active[LANES];
+    size_t next = 0;
+
+    auto start = [&](size_t lane) {
+        active[lane] = next < count;
+        if (!active[lane]) {
+            return;
+        }
+        message[lane] = next++;
+        offset[lane] = 0;
+        for (int i = 0; i < 8; i++) {
+            block.h[i][lane] = BLAKE2B_IV[i];
+        }
+        block.h[0][lane] ^= BLAKE2B_256_PARAMETERS;
+    };
+    for (size_t lane = 0; lane < LANES; lane++) {
+        start(lane);
+    }
+
+    bool running = count > 0;
+    while (running) {
+        // Idle lanes at the tail compress stale data; their state is never read again
+        for (size_t lane = 0; lane < LANES; lane++) {
+            if (!active[lane]) {
+                continue;
+            }
+            size_t length = lengths[message[lane]];
+            size_t remaining = length - offset[lane];
+            uint8_t buffer[128];
+            const uint8_t *data = messages[message[lane]] + offset[lane];
+            if (remaining < sizeof(buffer)) {
+                memset(buffer, 0, sizeof(buffer));
+                if (remaining > 0) {
+                    memcpy(buffer, data, remaining);
+                }
+                data = buffer;
+            }
+            for (int i = 0; i < 16; i++) {
+                block.m[i][lane] = loadWord(data + 8 * i);
+            }
+            bool last = remaining <= 128;
+            block.t[lane] = last ? length : offset[lane] + 128;
+            block.f[lane] = last ? ~0ULL : 0;
+        }
+
+        compress(block);
+
+        running = false;
+        for (size_t lane = 0; lane < LANES; lane++) {
+            if (!active[lane]) {
+                continue;
+            }
+            if (block.f[lane]) {
+                uint8_t *out = hashes[message[lane]];
+                for (int i = 0; i < 32; i++) {
+                    out[i] = static_cast<uint8_t>(block.h[i / 8][lane] >> (8 * (i % 8)));
+                }
+                start(lane);
+            } else {
+                offset[lane] += 128;
+            }
+            running = running || active[lane];
+        }
+    }
+}
+
+size_t blake2bBatchLanes()
+{
+#if BLAKE2B_BATCH_X86
+    if (__builtin_cpu_supports("avx512f")) {
+        return 8;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return 4;
+    }
+#endif
+    return 1;
+}
+
+void blake2b256Batch(const uint8_t *const messages[], const size_t lengths[], size_t count, uint8_t hashes[][32],
+                     size_t max_lanes)
+{
+#if BLAKE2B_BATCH_X86
+    static const size_t available = blake2bBatchLanes();
+    size_t lanes = max_lanes == 0 || max_lanes > available ? available : max_lanes;
+    // A single message gains nothing from wide lanes
+    if (lanes >= 8 && count > 4) {
+        hashLanes<8>(messages, lengths, count, hashes, compress8);
+        return;
+    }
+    if (lanes >= 4 && count > 1) {
+        hashLanes<4>(messages, lengths, count, hashes, compress4);
+        return;
+    }
+#endif
+    (void)max_lanes;
+    hashLanes<1>(messages, lengths, count, hashes, compress1);
+}
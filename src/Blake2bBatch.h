@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Multi-lane kernels use GCC/Clang vector extensions and are selected at runtime on x86
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(BLAKE2B_BATCH_SCALAR)
+  #define BLAKE2B_BATCH_X86 1
+#else
+  #define BLAKE2B_BATCH_X86 0
+#endif
+
+#define BLAKE2B_BATCH_MAX_LANES 8
+
+/**
+ * Returns the number of messages blake2b256Batch hashes in parallel on this CPU: 8 with AVX-512,
+ * 4 with AVX2, otherwise 1.
+ */
+size_t blake2bBatchLanes();
+
+/**
+ * Computes unkeyed BLAKE2b-256 over independent messages, several at a time in SIMD lanes.
+ *
+ * Each lane works through its own message and picks up the next one as soon as it finishes, so
+ * messages of different lengths keep the lanes busy. The result is identical to hashing each
+ * message on its own.
+ *
+ * @param messages The messages to hash.
+ * @param lengths The length of each message.
+ * @param count The number of messages.
+ * @param hashes Receives one 32-byte hash per message.
+ * @param max_lanes Caps the lanes used, e.g. 1 for the scalar path; 0 uses blake2bBatchLanes().
+ */
+void blake2b256Batch(const uint8_t *const messages[], const size_t lengths[], size_t count, uint8_t hashes[][32],
+                     size_t max_lanes = 0);
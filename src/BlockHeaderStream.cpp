@@ -0,0 +1,241 @@
+#include "BlockHeaderStream.h"
+#include <ArduinoJson.h>
+#include <cctype>
+#include <cstring>
+
+void BlockHeaderEventParser::feed(const char *data, size_t length)
+{
+    for (size_t i = 0; i < length; i++) {
+        feed(data[i]);
+    }
+}
+
+void BlockHeaderEventParser::feed(char c)
+{
+    // Lines end with CRLF, LF or CR
+    if (c == '\n' && after_cr_) {
+        after_cr_ = false;
+        return;
+    }
+    after_cr_ = c == '\r';
+    if (c == '\n' || c == '\r') {
+        endLine();
+        return;
+    }
+    if (data_length_ + line_length_ + 1 >= sizeof(buffer_)) {
+        overflow_ = true;
+        line_overflow_ = true;
+        return;
+    }
+    buffer_[data_length_ + line_length_++] = c;
+}
+
+void BlockHeaderEventParser::reset()
+{
+    data_length_ = 0;
+    line_length_ = 0;
+    overflow_ = false;
+    line_overflow_ = false;
+    after_cr_ = false;
+    event_[0] = '\0';
+}
+
+void BlockHeaderEventParser::endLine()
+{
+    if (line_length_ == 0 && !line_overflow_) {
+        dispatch();
+        return;
+    }
+
+    char *line = buffer_ + data_length_;
+    size_t length = line_length_;
+    line_length_ = 0;
+    if (line_overflow_ || line[0] == ':') { // comment, e.g. a keep-alive
+        line_overflow_ = false;
+        return;
+    }
+
+    const char *colon = static_cast<const char *>(memchr(line, ':', length));
+    size_t name_length = colon ? colon - line : length;
+    const char *value = colon ? colon + 1 : line + length;
+    if (value < line + length && *value == ' ') {
+        value++;
+    }
+    size_t value_length = line + length - value;
+
+    if (name_length == 4 && strncmp(line, "data", 4) == 0) {
+        // Keep the value in place as part of the event data, joining data lines with '\n'
+        if (data_length_ > 0) {
+            buffer_[data_length_++] = '\n';
+        }
+        memmove(buffer_ + data_length_, value, value_length);
+        data_length_ += value_length;
+    } else if (name_length == 5 && strncmp(line, "event", 5) == 0) {
+        size_t n = value_length < sizeof(event_) - 1 ? value_length : sizeof(event_) - 1;
+        memcpy(event_, value, n);
+        event_[n] = '\0';
+    } else if (name_length == 5 && strncmp(line, "retry", 5) == 0) {
+        uint32_t retry = 0;
+        for (size_t i = 0; i < value_length && isdigit(static_cast<unsigned char>(value[i])); i++) {
+            retry = retry * 10 + (value[i] - '0');
+        }
+        retry_ms_ = retry;
+    }
+}
+
+void BlockHeaderEventParser::dispatch()
+{
+    static const JsonDocument filter = []() {
+        JsonDocument filter;
+        filter["header"]["chainId"] = true;
+        filter["header"]["height"] = true;
+        return filter;
+    }();
+
+    bool wanted = !overflow_ && data_length_ > 0 && (event_[0] == '\0' || strcmp(event_, "BlockHeader") == 0);
+    if (wanted) {
+        JsonDocument doc;
+        DeserializationError error = deserializeJson(doc, buffer_, data_length_, DeserializationOption::Filter(filter));
+        JsonVariant header = doc["header"];
+        if (!error && header["chainId"].is<int>() && header["height"].is<uint32_t>()) {
+            events_++;
+            if (callback_) {
+                callback_(header["chainId"].as<uint8_t>(), header["height"].as<uint32_t>());
+            }
+        }
+    }
+    data_length_ = 0;
+    overflow_ = false;
+    event_[0] = '\0';
+}
+
+BlockHeaderSubscription::BlockHeaderSubscription(const String &network_url) : url_(network_url)
+{
+    url_ += "/header/updates";
+    parser_.setCallback([this](uint8_t chain_id, uint32_t height) {
+        // A delivered event proves the connection works, so the next drop retries quickly again
+        retry_delay_ms_ = parser_.retryMs() ? parser_.retryMs() : BLOCK_HEADER_RECONNECT_MIN_MS;
+        if (listener_) {
+            listener_(chain_id, height);
+        }
+    });
+}
+
+void BlockHeaderSubscription::poll()
+{
+    poll(millis());
+}
+
+void BlockHeaderSubscription::poll(unsigned long now_ms)
+{
+    if (!connected_) {
+        if (static_cast<long>(now_ms - next_attempt_ms_) >= 0) {
+            connect(now_ms);
+        }
+        return;
+    }
+
+    size_t budget = BLOCK_HEADER_POLL_BUDGET;
+    while (budget > 0 && stream_->available() > 0) {
+        int c = stream_->read();
+        if (c < 0) {
+            break;
+        }
+        receive(static_cast<char>(c));
+        last_data_ms_ = now_ms;
+        budget--;
+    }
+
+    if (budget > 0 && !http_.connected()) {
+        Serial.printf("Block header stream closed\n");
+        disconnect(now_ms);
+    } else if (now_ms - last_data_ms_ > BLOCK_HEADER_STALL_MS) {
+        Serial.printf("Block header stream stalled\n");
+        disconnect(now_ms);
+    }
+}
+
+void BlockHeaderSubscription::stop()
+{
+    if (connected_) {
+        http_.end();
+        connected_ = false;
+    }
+    next_attempt_ms_ = millis();
+}
+
+bool BlockHeaderSubscription::connect(unsigned long now_ms)
+{
+    http_.begin(url_);
+    http_.addHeader("Accept", "text/event-stream");
+    static const char *collectedHeaders[] = {"Transfer-Encoding"};
+    http_.collectHeaders(collectedHeaders, 1);
+    // GET() blocks until the headers arrive, so bound the stall it puts on the caller's loop
+    http_.setConnectTimeout(BLOCK_HEADER_CONNECT_TIMEOUT_MS);
+    http_.setTimeout(BLOCK_HEADER_CONNECT_TIMEOUT_MS);
+
+    reconnects_++;
+    int code = http_.GET();
+    if (code != 200) {
+        Serial.printf("Block header stream connect failed: %d\n", code);
+        http_.end();
+        disconnect(now_ms);
+        return false;
+    }
+
+    stream_ = http_.getStreamPtr();
+    chunked_ = http_.header("Transfer-Encoding") == "chunked";
+    chunk_state_ = ChunkState::SIZE;
+    chunk_remaining_ = 0;
+    parser_.reset();
+    connected_ = stream_ != nullptr;
+    last_data_ms_ = now_ms;
+    return connected_;
+}
+
+void BlockHeaderSubscription::disconnect(unsigned long now_ms)
+{
+    if (connected_) {
+        http_.end();
+        connected_ = false;
+    }
+    next_attempt_ms_ = now_ms + retry_delay_ms_;
+    retry_delay_ms_ = retry_delay_ms_ * 2 < BLOCK_HEADER_RECONNECT_MAX_MS ? retry_delay_ms_ * 2 : BLOCK_HEADER_RECONNECT_MAX_MS;
+}
+
+void BlockHeaderSubscription::receive(char c)
+{
+    if (!chunked_) {
+        parser_.feed(c);
+        return;
+    }
+
+    // HTTPClient hands over the raw socket, so chunked transfer framing is removed here
+    switch (chunk_state_) {
+    case ChunkState::SIZE:
+        if (isxdigit(static_cast<unsigned char>(c))) {
+            chunk_remaining_ = chunk_remaining_ * 16 + (isdigit(static_cast<unsigned char>(c)) ? c - '0' : (c | 0x20) - 'a' + 10);
+        } else if (c == ';') {
+            chunk_state_ = ChunkState::EXTENSION;
+        } else if (c == '\n') {
+            chunk_state_ = chunk_remaining_ > 0 ? ChunkState::DATA : ChunkState::SIZE;
+        }
+        break;
+    case ChunkState::EXTENSION:
+        if (c == '\n') {
+            chunk_state_ = chunk_remaining_ > 0 ? ChunkState::DATA : ChunkState::SIZE;
+        }
+        break;
+    case ChunkState::DATA:
+        parser_.feed(c);
+        if (--chunk_remaining_ == 0) {
+            chunk_state_ = ChunkState::DATA_END;
+        }
+        break;
+    case ChunkState::DATA_END:
+        if (c == '\n') {
+            chunk_state_ = ChunkState::SIZE;
+        }
+        break;
+    }
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include <Arduino.h>
+#ifndef UNIT_TEST
+  #include <HTTPClient.h>
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Largest event payload kept; Chainweb header updates are about 1 KiB. Longer events are dropped.
+#define BLOCK_HEADER_EVENT_SIZE 1536
+
+// Reconnect delay, doubled after every failed or dropped connection and reset by the next event
+#define BLOCK_HEADER_RECONNECT_MIN_MS 1000
+#define BLOCK_HEADER_RECONNECT_MAX_MS 60000
+
+// Across all chains a header arrives every couple of seconds, so this much silence means a dead connection
+#define BLOCK_HEADER_STALL_MS 90000
+
+// Bound on each blocking step of a (re)connect: the TCP connect, then the response headers
+#ifndef BLOCK_HEADER_CONNECT_TIMEOUT_MS
+#define BLOCK_HEADER_CONNECT_TIMEOUT_MS 2000
+#endif
+
+// Bytes consumed per poll(), so a burst of events does not starve the caller's loop
+#define BLOCK_HEADER_POLL_BUDGET 2048
+
+/**
+ * Receives the chain and height of every new block header.
+ */
+using BlockHeaderCallback = std::function<void(uint8_t chain_id, uint32_t height)>;
+
+/**
+ * Incremental parser for the server-sent events of Chainweb's block header stream.
+ *
+ * Bytes may arrive in any split. Memory is fixed: the current event's data and the line being
+ * read share one BLOCK_HEADER_EVENT_SIZE buffer, and only "header.chainId" and "header.height"
+ * are extracted from each "BlockHeader" event.
+ */
+class BlockHeaderEventParser
+{
+  public:
+    explicit BlockHeaderEventParser(BlockHeaderCallback callback = nullptr) : callback_(callback) {}
+
+    void setCallback(BlockHeaderCallback callback) { callback_ = callback; }
+
+    void feed(char c);
+    void feed(const char *data, size_t length);
+
+    /**
+     * Discards any partially received event, e.g. after a reconnect.
+     */
+    void reset();
+
+    /**
+     * Returns the reconnect delay requested by the server through a "retry:" field, or 0.
+     */
+    uint32_t retryMs() const { return retry_ms_; }
+
+    /**
+     * Returns the number of block headers delivered to the callback.
+     */
+    uint32_t events() const { return events_; }
+
+  private:
+    void endLine();
+    void dispatch();
+
+    BlockHeaderCallback callback_;
+    char buffer_[BLOCK_HEADER_EVENT_SIZE];
+    size_t data_length_ = 0;     ///< Accumulated event data at the start of buffer_.
+    size_t line_length_ = 0;     ///< Current line, stored right after the data.
+    bool overflow_ = false;      ///< The current event did not fit and is dropped.
+    bool line_overflow_ = false; ///< The current line did not fit.
+    bool after_cr_ = false;
+    char event_[16] = "";
+    uint32_t retry_ms_ = 0;
+    uint32_t events_ = 0;
+};
+
+/**
+ * Keeps a reconnecting subscription to Chainweb's block header stream ("<network>/header/updates").
+ *
+ * poll() is called from the application loop; it connects when due, reads what has arrived
+ * without blocking and forwards each header to the listener. Dropped or stalled connections are
+ * retried with exponential backoff between BLOCK_HEADER_RECONNECT_MIN_MS and _MAX_MS.
+ *
+ * A poll() that (re)connects does block: HTTPClient has no asynchronous GET, so the TCP connect
+ * and the wait for the response headers each stall the caller for up to
+ * BLOCK_HEADER_CONNECT_TIMEOUT_MS. The backoff keeps an unreachable node from costing more than
+ * that once per retry delay. Polls on an open connection never block.
+ */
+class BlockHeaderSubscription
+{
+  public:
+    /**
+     * @param network_url The network base URL, without the "/chain/<id>/..." suffix.
+     */
+    BlockHeaderSubscription(const String &network_url = "http://kda.crankk.org/chainweb/0.0/mainnet01");
+
+    /**
+     * Sets the function receiving headers, e.g. forwarding to BlockchainHandler::onBlockHeader.
+     */
+    void setListener(BlockHeaderCallback listener) { listener_ = listener; }
+
+    void poll();
+    void poll(unsigned long now_ms);
+
+    /**
+     * Closes the connection. The next poll() reconnects.
+     */
+    void stop();
+
+    bool connected() const { return connected_; }
+    uint32_t reconnects() const { return reconnects_; }
+    uint32_t events() const { return parser_.events(); }
+
+  private:
+    enum class ChunkState : uint8_t { SIZE, EXTENSION, DATA, DATA_END };
+
+    bool connect(unsigned long now_ms);
+    void disconnect(unsigned long now_ms);
+    void receive(char c);
+
+    String url_;
+    HTTPClient http_;
+    Stream *stream_ = nullptr;
+    BlockHeaderEventParser parser_;
+    BlockHeaderCallback listener_;
+    bool connected_ = false;
+    bool chunked_ = false;
+    ChunkState chunk_state_ = ChunkState::SIZE;
+    size_t chunk_remaining_ = 0;
+    unsigned long next_attempt_ms_ = 0;
+    unsigned long last_data_ms_ = 0;
+    uint32_t retry_delay_ms_ = BLOCK_HEADER_RECONNECT_MIN_MS;
+    uint32_t reconnects_ = 0;
+};
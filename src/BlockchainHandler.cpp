@@ -1,4 +1,7 @@
 #include "BlockchainHandler.h"
+#include "Inflate.h"
+#include "MeshRelay.h"
+#include "NonceGenerator.h"
 #include "mbedtls/aes.h"
 #include "mbedtls/ctr_drbg.h"
 #include "mbedtls/entropy.h"
@@ -7,8 +10,10 @@
 #include "utils.h"
 #include <ArduinoJson.h>
 #include <cstdio>
+#include <cstring>
 #include <ctime>
 #include <sstream>
+#include <vector>
 
 // Redefine strptime to avoid IRAM issue when using the HTTPClient functions
 char *strptime(const char *str, const char *format, struct tm *tm)
@@ -21,21 +26,122 @@ char *strptime(const char *str, const char *format, struct tm *tm)
     return NULL;
 }
 
+// Collects an HTTP response body into arena memory, growing the newest arena block in place
+class ArenaResponseWriter : public Stream
+{
+  public:
+    explicit ArenaResponseWriter(Arena &arena) : arena_(arena) {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        if (!data_) {
+            data_ = static_cast<char *>(arena_.allocate(size + 1));
+            if (!data_) {
+                return 0;
+            }
+        } else if (!arena_.extend(data_, length_ + size + 1)) {
+            return 0;
+        }
+        memcpy(data_ + length_, buffer, size);
+        length_ += size;
+        data_[length_] = '\0';
+        return size;
+    }
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+
+    const char *data() const { return data_ ? data_ : ""; }
+    size_t length() const { return length_; }
+
+  private:
+    Arena &arena_;
+    char *data_ = nullptr;
+    size_t length_ = 0;
+};
+
+// Extracts the chain id from a ".../chain/<id>/..." endpoint URL; a URL without the segment uses the
+// default chain, while a segment that is not a chain number fails
+static bool chainIdFromUrl(const String &url, uint8_t &chainId)
+{
+    chainId = DEFAULT_CHAIN_ID;
+    int pos = url.indexOf("/chain/");
+    if (pos < 0) {
+        return true;
+    }
+    const char *start = url.c_str() + pos + 7;
+    char *end;
+    unsigned long value = strtoul(start, &end, 10);
+    if (!isdigit(static_cast<unsigned char>(*start)) || (*end != '/' && *end != '\0') ||
+        value >= KADENA_CHAIN_COUNT) {
+        return false;
+    }
+    chainId = static_cast<uint8_t>(value);
+    return true;
+}
+
+// Rewrites the "/chain/<id>/" segment of an endpoint URL to another chain
+static String serverUrlForChain(const String &url, uint8_t chainId)
+{
+    int pos = url.indexOf("/chain/");
+    if (pos < 0) {
+        return url;
+    }
+    const char *end = strchr(url.c_str() + pos + 7, '/');
+    if (!end) {
+        return url;
+    }
+    String rewritten = url.substring(0, pos + 7);
+    rewritten += String(chainId);
+    rewritten += end;
+    return rewritten;
+}
+
 BlockchainHandler::BlockchainHandler(const std::string& public_key, 
                                    const std::string& private_key,
                                    bool is_wallet_enabled,
-                                   const String& server_url)
+                                   const String& server_url,
+                                   Arena* arena)
     : public_key_(public_key)
     , private_key_(private_key)
     , is_wallet_enabled_(is_wallet_enabled)
+    , arena_(arena)
+    , json_allocator_(arena)
 {
     kda_server_ = server_url;
-    encryptionHandler_ = std::unique_ptr<EncryptionHandler>(new EncryptionHandler());
+    server_url_valid_ = chainIdFromUrl(server_url, chain_id_);
+    if (!server_url_valid_) {
+        // Sharding a misconfigured handler onto some chain would hide the mistake
+        Serial.printf("Invalid chain in server URL: %s\n", server_url.c_str());
+    }
+    chain_id_str_ = String(chain_id_);
+    encryptionHandler_.setArena(arena);
+}
+
+BlockchainHandler::BlockchainHandler(const std::string& public_key,
+                                   const std::string& private_key,
+                                   bool is_wallet_enabled,
+                                   ChainRouter& router,
+                                   Arena* arena)
+    : public_key_(public_key)
+    , private_key_(private_key)
+    , is_wallet_enabled_(is_wallet_enabled)
+    , router_(&router)
+    , arena_(arena)
+    , json_allocator_(arena)
+{
+    chain_id_ = router.chainFor(public_key);
+    chain_id_str_ = String(chain_id_);
+    kda_server_ = router.serverUrlFor(chain_id_);
+    encryptionHandler_.setArena(arena);
 }
 
 bool BlockchainHandler::isWalletConfigValid()
 {
-    return is_wallet_enabled_ && public_key_.length() == 64 && private_key_.length() == 64;
+    return is_wallet_enabled_ && server_url_valid_ && public_key_.length() == 64 && private_key_.length() == 64;
 }
 
 int32_t BlockchainHandler::performNodeSync(const std::string& node_id,
@@ -43,12 +149,50 @@ int32_t BlockchainHandler::performNodeSync(const std::string& node_id,
                                            SecretCallback onSecretGen) {
     Serial.printf("\nWallet public key: %s\n", public_key_.data());
 
-    if (!isWalletConfigValid() || !isWifiAvailable()) {
+    if (!isWalletConfigValid()) {
         return 300000; // Every 5 minutes.
     }
+    if (!isWifiAvailable()) {
+        // The due state can't be queried over the mesh, so relaying needs the director key and a
+        // due state from earlier syncs; a relay that isn't due would only pay for a rejected update
+        if (relay_pending_ && ++relay_wait_syncs_ > MESH_RELAY_ACK_TIMEOUT_SYNCS) {
+            // The command or its ack was lost; the node is still due, so relay it again
+            Serial.printf("No ack for the relayed update, relaying again\n");
+            relay_pending_ = false;
+        }
+        if (relay_sender_ && !director_pubkeyd_.empty() && !relay_pending_ && knownDue()) {
+            uint32_t packetId = packetIdGen ? packetIdGen() : 0;
+            String secret = encryptPayload(String(packetId, HEX).c_str());
+            if (relayCommand(PactCall::UPDATE_SENT, secret)) {
+                // The beacon waits for the gateway's ack (see onRelayAck); the node stays due until
+                // then, so a reboot or a lost ack leads to another relay rather than silence
+                relay_pending_ = true;
+                relay_wait_syncs_ = 0;
+                relay_packet_id_ = packetId;
+                relay_on_secret_ = onSecretGen;
+                Serial.printf("Update relayed over the mesh with packet id: %d\n", packetId);
+            }
+        }
+        return 300000;
+    }
+
+    // With a beacon interval, an accepted beacon fixes when the node is due again, so the signed
+    // /local waits for that time however many blocks land meanwhile
+    sync_wanted_ = false;
+    if (due_at_known_ && !knownDue()) {
+        Serial.printf("Not due for another %lu s\n", (due_at_ms_ - millis()) / 1000);
+        return 300000;
+    }
+    // Without a due time, whether a node is due only changes when a block lands, so while the
+    // header feed is live /local is skipped until the chain moves past the last NOT_DUE height
+    if (not_due_height_ != 0 && chain_height_ <= not_due_height_ && headerFeedLive()) {
+        Serial.printf("No new block since NOT_DUE at height %u\n", (unsigned)not_due_height_);
+        return 300000;
+    }
 
-    BlockchainStatus status = executeBlockchainCommand("local", "(free.mesh03.get-my-node)");
+    BlockchainStatus status = executeBlockchainCommand(PactCall::GET_MY_NODE);
     Serial.printf("Response: %s\n", blockchainStatusToString(status).c_str());
+    not_due_height_ = status == BlockchainStatus::NOT_DUE ? chain_height_.load() : 0;
 
     // node exists, due for sending
     if (status == BlockchainStatus::READY) {
@@ -58,8 +202,9 @@ int32_t BlockchainHandler::performNodeSync(const std::string& node_id,
         }
         String secret_hex = String(packetId, HEX);
         String secret = encryptPayload(secret_hex.c_str());
-        status = executeBlockchainCommand("send", "(free.mesh03.update-sent \"" + secret + "\")");
+        status = executeBlockchainCommand(PactCall::UPDATE_SENT, secret);
         if (status == BlockchainStatus::SUCCESS) {
+            onBeaconAccepted();
             // Only send the radio beacon if the update-sent command is successful
             if (onSecretGen) {
                 onSecretGen(packetId);
@@ -69,37 +214,50 @@ int32_t BlockchainHandler::performNodeSync(const std::string& node_id,
             Serial.printf("Update sent failed: %s\n", blockchainStatusToString(status).c_str());
         }
     } else if (status == BlockchainStatus::NODE_NOT_FOUND) { // node doesn't exist, insert it
-        status = executeBlockchainCommand("send", "(free.mesh03.insert-my-node \"" + String(node_id.c_str()) + "\")");
+        status = executeBlockchainCommand(PactCall::INSERT_MY_NODE, node_id.c_str());
         Serial.printf("Node insert local response: %s\n", blockchainStatusToString(status).c_str());
     } else if (status == BlockchainStatus::NOT_DUE) { // node exists, not due for sending
         Serial.printf("DON'T SEND beacon\n");
     } else {
         Serial.printf("Error occurred: %s\n", blockchainStatusToString(status).c_str());
     }
+    if (arena_) {
+        arena_->reset();
+    }
     return 300000; // Every 5 minutes. That should be enough for previous txn to be complete
 }
 
-JsonDocument BlockchainHandler::createCommandObject(const String &command)
+JsonDocument BlockchainHandler::createCommandObject(const String &command, uint32_t gasLimit)
+{
+    char nonce[NONCE_BUFFER_SIZE];
+    NonceGenerator::shared().next(nonce);
+    return createCommandObject(command, public_key_, chain_id_str_, clock_skew_.chainTime(getCurrentUnixTime()), nonce,
+                               gasLimit);
+}
+
+JsonDocument BlockchainHandler::createCommandObject(const String &command, const std::string &publicKey,
+                                                    const String &chainId, uint32_t creationTime, const char *nonce,
+                                                    uint32_t gasLimit)
 {
-    JsonDocument cmdObject;
+    JsonDocument cmdObject = newDocument();
 
     // Create signers array
     JsonArray signers = cmdObject["signers"].to<JsonArray>();
     JsonObject signer = signers.add<JsonObject>();
     signer["scheme"] = "ED25519";
-    signer["pubKey"] = public_key_;
-    signer["addr"] = public_key_;
+    signer["pubKey"] = publicKey;
+    signer["addr"] = publicKey;
 
     // Create meta object
     JsonObject meta = cmdObject["meta"].to<JsonObject>();
-    meta["creationTime"] = getCurrentUnixTime();
+    meta["creationTime"] = creationTime;
     meta["ttl"] = 28800;
-    meta["chainId"] = "19";
+    meta["chainId"] = chainId;
     meta["gasPrice"] = 0.00001;
-    meta["gasLimit"] = 1000;
-    meta["sender"] = "k:" + public_key_;
+    meta["gasLimit"] = gasLimit;
+    meta["sender"] = "k:" + publicKey;
 
-    cmdObject["nonce"] = getCurrentTimestamp();
+    cmdObject["nonce"] = nonce;
     cmdObject["networkId"] = "mainnet01";
 
     // Create payload object
@@ -113,110 +271,850 @@ JsonDocument BlockchainHandler::createCommandObject(const String &command)
 
 JsonDocument BlockchainHandler::preparePostObject(const JsonDocument &cmdObject, const String &commandType)
 {
-    JsonDocument postObject;
+    JsonDocument postObject = newDocument();
 
     // Serialize cmdObject to a string first
-    String cmdString;
-    serializeJson(cmdObject, cmdString);
-    postObject["cmd"] = cmdString;
+    String cmdFallback;
+    const char *cmdString = serializeDocument(cmdObject, cmdFallback);
+    if (!cmdString) {
+        return postObject;
+    }
+
+    HashVector vector{"Test1", cmdString};
 
-    HashVector vector{"Test1", cmdString.c_str()};
+    uint8_t *hashBin = encryptionHandler_.Binhash(&vector);
+    String hash = encryptionHandler_.KDAhash(hashBin);
+    String signHex = encryptionHandler_.generateSignature(public_key_, private_key_, hashBin);
 
-    uint8_t *hashBin = encryptionHandler_->Binhash(&vector);
-    String hash = encryptionHandler_->KDAhash(&vector);
-    String signHex = encryptionHandler_->generateSignature(public_key_, private_key_, hashBin);
+    fillPostObject(postObject.to<JsonObject>(), cmdString, hash, signHex);
+    return postObject;
+}
 
+void BlockchainHandler::fillPostObject(JsonObject postObject, const char *cmdString, const String &hash,
+                                       const String &signHex)
+{
+    postObject["cmd"] = cmdString;
     postObject["hash"] = hash;
     JsonArray sigs = postObject["sigs"].to<JsonArray>();
     JsonObject sigObject = sigs.add<JsonObject>();
     sigObject["sig"] = signHex;
+}
 
-    return postObject;
+// Builds the ArduinoJson filter for a result shape once, so only the fields its decoder reads are stored
+static const JsonDocument &responseFilter(PactResultShape shape)
+{
+    static const JsonDocument filters[] = {
+        []() {
+            JsonDocument filter;
+            filter["result"]["status"] = true;
+            filter["metaData"]["blockTime"] = true;
+            filter["metaData"]["blockHeight"] = true;
+            return filter;
+        }(),
+        []() {
+            JsonDocument filter;
+            filter["result"]["status"] = true;
+            filter["result"]["data"]["send"] = true;
+            filter["result"]["data"]["pubkeyd"] = true;
+            filter["metaData"]["blockTime"] = true;
+            filter["metaData"]["blockHeight"] = true;
+            return filter;
+        }(),
+        []() {
+            JsonDocument filter;
+            filter["result"]["status"] = true;
+            filter["result"]["data"]["pubkeyd"] = true;
+            filter["metaData"]["blockTime"] = true;
+            filter["metaData"]["blockHeight"] = true;
+            return filter;
+        }(),
+        []() {
+            // Element 0 of an array filter applies to every element
+            JsonDocument filter;
+            filter["result"]["status"] = true;
+            filter["result"]["data"][0]["send"] = true;
+            filter["result"]["data"][0]["pubkeyd"] = true;
+            filter["metaData"]["blockTime"] = true;
+            filter["metaData"]["blockHeight"] = true;
+            return filter;
+        }(),
+    };
+    return filters[static_cast<size_t>(shape)];
 }
 
-BlockchainStatus BlockchainHandler::parseBlockchainResponse(const String &response, const String &command)
+BlockchainStatus BlockchainHandler::parseBlockchainResponse(const char *response, size_t length, PactCall call,
+                                                            bool compressed)
 {
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, response);
+    const PactCommand &descriptor = pactCommand(call);
+    JsonDocument doc = newDocument();
+    DeserializationOption::Filter filter(responseFilter(descriptor.shape));
+    DeserializationError error;
+
+    if (compressed) {
+        // Inflate straight into the parser; only the fixed window is held, never the whole document
+        std::unique_ptr<uint8_t[]> windowFallback;
+        uint8_t *window;
+        if (arena_) {
+            window = static_cast<uint8_t *>(arena_->allocate(INFLATE_WINDOW_SIZE));
+        } else {
+            windowFallback.reset(new uint8_t[INFLATE_WINDOW_SIZE]);
+            window = windowFallback.get();
+        }
+        if (!window) {
+            return BlockchainStatus::OUT_OF_MEMORY;
+        }
+        Inflater inflater(reinterpret_cast<const uint8_t *>(response), length, window, INFLATE_WINDOW_SIZE);
+        error = deserializeJson(doc, inflater, filter);
+        if (inflater.error()) {
+            inflate_window_exceeded_ = inflater.windowExceeded();
+            Serial.printf("Response inflate failed after %u bytes\n", (unsigned)inflater.totalOut());
+            return BlockchainStatus::PARSING_ERROR;
+        }
+    } else {
+        error = deserializeJson(doc, response, length, filter);
+    }
 
+    if (arena_ && arena_->exhausted()) {
+        return BlockchainStatus::OUT_OF_MEMORY;
+    }
     if (error) {
         Serial.printf("JSON parsing failed: %s\n", error.c_str());
         return BlockchainStatus::PARSING_ERROR;
     }
 
+    // The block the /local call was evaluated on is a direct sample of chain time
+    JsonVariant blockTime = doc["metaData"]["blockTime"];
+    if (blockTime.is<double>()) {
+        clock_skew_.addBlockTime(blockTime.as<double>(), getCurrentUnixTime());
+    }
+    uint32_t blockHeight = doc["metaData"]["blockHeight"] | 0u;
+    if (blockHeight > chain_height_) {
+        chain_height_ = blockHeight;
+    }
+
     JsonObject resultObject = doc["result"];
-    JsonObject dataObject = resultObject["data"];
-    const char* status = resultObject["status"];
+    const char *status = resultObject["status"];
+    bool succeeded = status && status[0] == 's';
+
+    switch (descriptor.shape) {
+    case PactResultShape::NODE_STATUS:
+        return decodeNodeStatus(succeeded, resultObject["data"]);
+    case PactResultShape::SENDER_DETAILS:
+        return decodeSenderDetails(succeeded, resultObject["data"]);
+    case PactResultShape::NODE_STATUS_LIST:
+        return decodeNodeStatusList(succeeded, resultObject["data"]);
+    case PactResultShape::STATUS_ONLY:
+    default:
+        return succeeded ? BlockchainStatus::SUCCESS : BlockchainStatus::FAILURE;
+    }
+}
 
-    BlockchainStatus returnStatus = 
-        command.indexOf("get-my-node") > 0 ? BlockchainStatus::NODE_NOT_FOUND : BlockchainStatus::FAILURE;
+BlockchainStatus BlockchainHandler::decodeNodeStatus(bool succeeded, JsonObject data)
+{
+    // A failed get-my-node means the node is not registered yet
+    if (!succeeded) {
+        return BlockchainStatus::NODE_NOT_FOUND;
+    }
+    if (data["pubkeyd"].is<const char *>()) {
+        director_pubkeyd_ = data["pubkeyd"].as<const char *>();
+    }
+    bool sendValue = data["send"];
+    // The contract's answer supersedes a relayed update still waiting for its ack
+    due_ready_ = sendValue;
+    relay_pending_ = false;
+    return sendValue ? BlockchainStatus::READY : BlockchainStatus::NOT_DUE;
+}
 
-    if (String(status).startsWith("s")) {
-        if (dataObject["pubkeyd"].is<const char*>()) {
-            director_pubkeyd_ = dataObject["pubkeyd"].as<std::string>();
-        }
+BlockchainStatus BlockchainHandler::decodeSenderDetails(bool succeeded, JsonObject data)
+{
+    if (!succeeded) {
+        return BlockchainStatus::FAILURE;
+    }
+    if (data["pubkeyd"].is<const char *>()) {
+        director_pubkeyd_ = data["pubkeyd"].as<const char *>();
+    }
+    return BlockchainStatus::SUCCESS;
+}
 
-        if (command.indexOf("get-my-node") > 0) {
-            bool sendValue = dataObject["send"];
-            returnStatus = sendValue ? BlockchainStatus::READY : BlockchainStatus::NOT_DUE;
-        } else if (command.indexOf("get-sender-details") > 0) {
-            returnStatus = BlockchainStatus::SUCCESS;
+BlockchainStatus BlockchainHandler::decodeNodeStatusList(bool succeeded, JsonArray data)
+{
+    if (!succeeded) {
+        return BlockchainStatus::FAILURE;
+    }
+    if (!node_query_ || data.size() != node_query_count_) {
+        return BlockchainStatus::PARSING_ERROR;
+    }
+    // An unregistered node comes back as false, which the object filter leaves as null
+    NodeQueryResult *result = node_query_;
+    for (JsonObject entry : data) {
+        if (entry.isNull()) {
+            result->status = BlockchainStatus::NODE_NOT_FOUND;
+            result->directorKey.clear();
+        } else {
+            result->status = entry["send"].as<bool>() ? BlockchainStatus::READY : BlockchainStatus::NOT_DUE;
+            const char *directorKey = entry["pubkeyd"];
+            result->directorKey = directorKey ? directorKey : "";
         }
+        result++;
     }
-    return returnStatus;
+    return BlockchainStatus::SUCCESS;
+}
+
+BlockchainStatus BlockchainHandler::executeBlockchainCommand(PactCall call, const String &argument)
+{
+    return executePactCode(call, pactEndpointPath(pactCommand(call).endpoint), buildPactCode(call, argument));
 }
 
 BlockchainStatus BlockchainHandler::executeBlockchainCommand(const String &commandType, const String &command)
 {
+    return executePactCode(pactCallFromCode(command), commandType, command);
+}
+
+BlockchainStatus BlockchainHandler::executeBlockchainCommand(PactCall call, const String &commandType,
+                                                             const String &command)
+{
+    return executePactCode(call, commandType, command);
+}
+
+BlockchainStatus BlockchainHandler::executePactCode(PactCall call, const String &commandType, const String &command,
+                                                    uint32_t gasLimit)
+{
+    if (!server_url_valid_) {
+        return BlockchainStatus::FAILURE;
+    }
     if (!isWifiAvailable()) {
         return BlockchainStatus::NO_WIFI;
     }
 
-    HTTPClient http;
-    http.begin(kda_server_ + commandType);
-    http.addHeader("Content-Type", "application/json");
+    // Every command starts from an empty arena; nothing allocated there outlives a command
+    if (arena_) {
+        arena_->reset();
+    }
+
+    trace_ = TraceRecord();
+    trace_.timestampMs = millis();
+    trace_.code = command.c_str();
+    trace_.codeLength = command.length();
 
-    JsonDocument cmdObject = createCommandObject(command);
+    unsigned long stageStart = micros();
+    JsonDocument cmdObject = createCommandObject(command, gasLimit);
+    trace_.stageUs[TRACE_STAGE_BUILD] = micros() - stageStart;
+    stageStart = micros();
     JsonDocument postObject = preparePostObject(cmdObject, commandType);
+    trace_.stageUs[TRACE_STAGE_SIGN] = micros() - stageStart;
+    return submitPostObject(call, kda_server_, chain_id_, commandType, postObject);
+}
+
+BlockchainStatus BlockchainHandler::submitBeaconBatch(BeaconBatch &batch)
+{
+    if (batch.size() == 0) {
+        return BlockchainStatus::FAILURE;
+    }
+    String root = encryptionHandler_.KDAhash(batch.root());
+    return executePactCode(PactCall::RAW, pactEndpointPath(PactEndpoint::SEND),
+                           buildBeaconBatchCode(root, batch.publicKeys()), batch.gasLimit());
+}
+
+BlockchainStatus BlockchainHandler::queryNodeStatuses(const std::vector<std::string> &nodeIds,
+                                                      std::vector<NodeQueryResult> &results, size_t maxCodeSize)
+{
+    results.assign(nodeIds.size(), NodeQueryResult());
+    BlockchainStatus overall = BlockchainStatus::SUCCESS;
+    size_t first = 0;
+    while (first < nodeIds.size()) {
+        size_t count;
+        String code = buildNodeQueryCode(nodeIds, first, maxCodeSize, count);
+        BlockchainStatus status;
+        if (count == 0) {
+            // A key too long to query on its own
+            Serial.printf("Node id %u does not fit in a query\n", (unsigned)first);
+            count = 1;
+            status = BlockchainStatus::FAILURE;
+        } else {
+            node_query_ = &results[first];
+            node_query_count_ = count;
+            status = executePactCode(PactCall::GET_NODES, pactEndpointPath(PactEndpoint::LOCAL), code,
+                                     PACT_GAS_LIMIT + NODE_QUERY_GAS_PER_NODE * count);
+            node_query_ = nullptr;
+        }
+
+        if (status != BlockchainStatus::SUCCESS) {
+            for (size_t i = first; i < first + count; i++) {
+                results[i].status = status;
+                results[i].directorKey.clear();
+            }
+            if (overall == BlockchainStatus::SUCCESS) {
+                overall = status;
+            }
+        }
+        first += count;
+    }
+    return overall;
+}
 
-    String postRaw;
+BlockchainStatus BlockchainHandler::submitPostObject(PactCall call, const String &serverUrl, uint8_t chainId,
+                                                     const String &commandType, const JsonDocument &postObject)
+{
     if (commandType == "local") {
-        serializeJson(postObject, postRaw);
-    } else {
-        JsonDocument finalDoc;
-        JsonArray cmds = finalDoc["cmds"].to<JsonArray>();
-        cmds.add(postObject.as<JsonObject>());
-        serializeJson(finalDoc, postRaw);
+        return submitRequest(call, serverUrl, chainId, commandType, postObject);
+    }
+    JsonDocument finalDoc = newDocument();
+    JsonArray cmds = finalDoc["cmds"].to<JsonArray>();
+    cmds.add(postObject.as<JsonObject>());
+    return submitRequest(call, serverUrl, chainId, commandType, finalDoc);
+}
+
+BlockchainStatus BlockchainHandler::submitRequest(PactCall call, const String &serverUrl, uint8_t chainId,
+                                                  const String &commandType, const JsonDocument &request)
+{
+    // Serialized and signed once; every attempt sends these exact bytes under the same request key
+    unsigned long stageStart = micros();
+    String postFallback;
+    const char *postRaw = serializeDocument(request, postFallback);
+
+    if (!postRaw || (arena_ && arena_->exhausted())) {
+        Serial.printf("Arena exhausted while building command\n");
+        return BlockchainStatus::OUT_OF_MEMORY;
     }
+    size_t postLength = strlen(postRaw);
+    trace_.stageUs[TRACE_STAGE_SERIALIZE] = micros() - stageStart;
+    logLongString(postRaw, postLength);
+
+    bool send = commandType == "send";
+    uint8_t attempts = retry_policy_.attempts > 0 ? retry_policy_.attempts : 1;
+    uint32_t delayMs = retry_policy_.minDelayMs;
+    // Responses of failed attempts and /poll checks are released before the next request
+    size_t arenaMark = arena_ ? arena_->mark() : 0;
+    for (uint8_t attempt = 1;; attempt++) {
+        int httpCode;
+        uint32_t retryAfterMs;
+        trace_.attempt = attempt;
+        if (arena_) {
+            arena_->rewind(arenaMark);
+        }
+        BlockchainStatus status = postRequest(call, serverUrl, chainId, commandType, postRaw, postLength, attempt > 1,
+                                              httpCode, retryAfterMs);
+        // Only transport errors, 429 and 5xx are worth repeating; any other 4xx will not change
+        bool throttled = httpCode == 429;
+        bool transient = httpCode < 0 || throttled || (httpCode >= 500 && httpCode <= 599);
+        if (!transient || attempt >= attempts) {
+            return status;
+        }
+        // A node asking for a longer pause than the policy allows is left to the caller's cadence
+        // (and the limiter's pause) instead of blocking the sync for it
+        if (retryAfterMs > retry_policy_.maxDelayMs) {
+            Serial.printf("Attempt %u failed with %d, Retry-After %u ms exceeds the retry policy\n", (unsigned)attempt,
+                          httpCode, (unsigned)retryAfterMs);
+            return status;
+        }
 
-    logLongString(postRaw);
+        uint32_t waitMs = retryAfterMs > delayMs ? retryAfterMs : delayMs;
+        Serial.printf("Attempt %u failed with %d, retrying in %u ms\n", (unsigned)attempt, httpCode, (unsigned)waitMs);
+        if (retry_sleep_) {
+            retry_sleep_(waitMs);
+        } else {
+            delay(waitMs);
+        }
+        delayMs = delayMs * 2 < retry_policy_.maxDelayMs ? delayMs * 2 : retry_policy_.maxDelayMs;
+
+        // A failed response does not prove the command was not accepted; if it landed, stop here.
+        // A 429 is turned away before the node looks at the command.
+        if (send && !throttled) {
+            if (arena_) {
+                arena_->rewind(arenaMark);
+            }
+            BlockchainStatus landed = pollRequestKeys(serverUrl, request["cmds"].as<JsonArrayConst>());
+            if (landed == BlockchainStatus::SUCCESS || landed == BlockchainStatus::FAILURE) {
+                Serial.printf("Command landed on an earlier attempt\n");
+                return landed;
+            }
+        }
+    }
+}
+
+BlockchainStatus BlockchainHandler::postRequest(PactCall call, const String &serverUrl, uint8_t chainId,
+                                                const String &commandType, const char *postRaw, size_t postLength,
+                                                bool resubmission, int &httpResponseCode, uint32_t &retryAfterMs)
+{
+    inflate_window_exceeded_ = false;
+    trace_.stageUs[TRACE_STAGE_HTTP] = 0;
+    trace_.stageUs[TRACE_STAGE_PARSE] = 0;
+    HTTPClient http;
+    http.begin(serverUrl + commandType);
+    http.addHeader("Content-Type", "application/json");
+    if (accept_compression_) {
+        http.addHeader("Accept-Encoding", "gzip, deflate");
+    }
+    static const char *collectedHeaders[] = {"Date", "Content-Encoding", "Retry-After"};
+    http.collectHeaders(collectedHeaders, 3);
 
     http.setTimeout(15000);
-    int httpResponseCode = http.POST(postRaw);
-    String response = http.getString();
-    logLongString(response);
+    if (limiter_) {
+        limiter_->acquire();
+    }
+    if (router_) {
+        router_->onSubmit(chainId);
+    }
+    unsigned long stageStart = micros();
+    httpResponseCode = http.POST(reinterpret_cast<uint8_t *>(const_cast<char *>(postRaw)), postLength);
+    if (httpResponseCode > 0) {
+        clock_skew_.addHttpDate(http.header("Date").c_str(), getCurrentUnixTime());
+    }
+
+    String responseFallback;
+    const char *response;
+    size_t responseLength;
+    if (arena_) {
+        ArenaResponseWriter writer(*arena_);
+        http.writeToStream(&writer);
+        response = writer.data();
+        responseLength = writer.length();
+    } else {
+        responseFallback = http.getString();
+        response = responseFallback.c_str();
+        responseLength = responseFallback.length();
+    }
+    trace_.stageUs[TRACE_STAGE_HTTP] = micros() - stageStart;
+    retryAfterMs = 0;
+    if (httpResponseCode == 429 || httpResponseCode == 503) {
+        retryAfterMs = SubmissionLimiter::parseRetryAfterMs(http.header("Retry-After").c_str(),
+                                                            clock_skew_.chainTime(getCurrentUnixTime()));
+    }
+    if (limiter_) {
+        limiter_->release(httpResponseCode, trace_.stageUs[TRACE_STAGE_HTTP] / 1000, retryAfterMs);
+    }
+    String encoding = http.header("Content-Encoding");
+    bool compressed = encoding == "gzip" || encoding == "deflate";
+    if (compressed) {
+        Serial.printf("Compressed response: %u bytes (%s)\n", (unsigned)responseLength, encoding.c_str());
+    } else {
+        logLongString(response, responseLength);
+    }
 
     http.end();
     // Handle HTTP response codes
-    if (httpResponseCode < 0 || (httpResponseCode >= 400 && httpResponseCode <= 599)) {
+    bool httpFailed = httpResponseCode < 0 || (httpResponseCode >= 400 && httpResponseCode <= 599);
+    if (router_) {
+        router_->onComplete(chainId, !httpFailed);
+    }
+
+    BlockchainStatus status;
+    if (resubmission && httpResponseCode == 400 && strstr(response, "already exists")) {
+        // The node rejects a request key it already holds: an earlier attempt was accepted after all
+        Serial.printf("Resubmitted command already accepted\n");
+        status = BlockchainStatus::SUCCESS;
+    } else if (httpFailed) {
+        status = BlockchainStatus::HTTP_ERROR;
+    } else if (httpResponseCode == HTTP_CODE_NO_CONTENT) {
+        status = BlockchainStatus::EMPTY_RESPONSE;
+    } else if (arena_ && arena_->exhausted()) {
+        Serial.printf("Arena exhausted while reading response\n");
+        status = BlockchainStatus::OUT_OF_MEMORY;
+    } else if (commandType == "local") {
+        stageStart = micros();
+        status = parseBlockchainResponse(response, responseLength, call, compressed);
+        trace_.stageUs[TRACE_STAGE_PARSE] = micros() - stageStart;
+    } else {
+        status = BlockchainStatus::SUCCESS;
+    }
+
+    if (trace_writer_) {
+        trace_.call = call;
+        trace_.local = commandType == "local";
+        trace_.compressed = compressed;
+        trace_.httpCode = httpResponseCode;
+        trace_.status = static_cast<uint8_t>(status);
+        trace_.request = reinterpret_cast<const uint8_t *>(postRaw);
+        trace_.requestLength = postLength;
+        trace_.response = reinterpret_cast<const uint8_t *>(response);
+        trace_.responseLength = responseLength;
+        trace_writer_->write(trace_);
+    }
+    // The command was built, signed and serialized once; later records of it only time their own exchange
+    trace_.stageUs[TRACE_STAGE_BUILD] = 0;
+    trace_.stageUs[TRACE_STAGE_SIGN] = 0;
+    trace_.stageUs[TRACE_STAGE_SERIALIZE] = 0;
+
+    // A reply referring further back than INFLATE_WINDOW_SIZE cannot be inflated in the fixed window;
+    // /local has no side effects, so the same bytes are sent again without advertising compression
+    if (inflate_window_exceeded_ && accept_compression_) {
+        Serial.printf("Compressed response exceeds the inflate window, asking again uncompressed\n");
+        accept_compression_ = false;
+        status = postRequest(call, serverUrl, chainId, commandType, postRaw, postLength, resubmission,
+                             httpResponseCode, retryAfterMs);
+        accept_compression_ = true;
+    }
+    return status;
+}
+
+BlockchainStatus BlockchainHandler::pollRequestKeys(const String &serverUrl, JsonArrayConst cmds)
+{
+    JsonDocument request = newDocument();
+    JsonArray requestKeys = request["requestKeys"].to<JsonArray>();
+    JsonDocument filter;
+    for (JsonVariantConst cmd : cmds) {
+        const char *hash = cmd["hash"];
+        requestKeys.add(hash);
+        filter[hash]["result"]["status"] = true;
+    }
+    String requestFallback;
+    const char *requestRaw = serializeDocument(request, requestFallback);
+    if (!requestRaw) {
+        return BlockchainStatus::OUT_OF_MEMORY;
+    }
+
+    HTTPClient http;
+    http.begin(serverUrl + "poll");
+    http.addHeader("Content-Type", "application/json");
+    static const char *collectedHeaders[] = {"Retry-After"};
+    http.collectHeaders(collectedHeaders, 1);
+    http.setTimeout(15000);
+    // A poll loads the node like any other request, so it waits for admission too
+    if (limiter_) {
+        limiter_->acquire();
+    }
+    unsigned long start = micros();
+    int httpResponseCode = http.POST(reinterpret_cast<uint8_t *>(const_cast<char *>(requestRaw)), strlen(requestRaw));
+    String responseFallback;
+    const char *response;
+    size_t responseLength;
+    if (arena_) {
+        ArenaResponseWriter writer(*arena_);
+        http.writeToStream(&writer);
+        response = writer.data();
+        responseLength = writer.length();
+    } else {
+        responseFallback = http.getString();
+        response = responseFallback.c_str();
+        responseLength = responseFallback.length();
+    }
+    if (limiter_) {
+        uint32_t retryAfterMs = 0;
+        if (httpResponseCode == 429 || httpResponseCode == 503) {
+            retryAfterMs = SubmissionLimiter::parseRetryAfterMs(http.header("Retry-After").c_str(),
+                                                                clock_skew_.chainTime(getCurrentUnixTime()));
+        }
+        limiter_->release(httpResponseCode, (micros() - start) / 1000, retryAfterMs);
+    }
+    http.end();
+    if (httpResponseCode != 200) {
         return BlockchainStatus::HTTP_ERROR;
     }
-    if (httpResponseCode == HTTP_CODE_NO_CONTENT) {
-        return BlockchainStatus::EMPTY_RESPONSE;
+
+    // /poll answers only for request keys that made it into a block
+    JsonDocument doc = newDocument();
+    if (deserializeJson(doc, response, responseLength, DeserializationOption::Filter(filter))) {
+        return BlockchainStatus::PARSING_ERROR;
+    }
+    bool succeeded = true;
+    for (JsonVariantConst cmd : cmds) {
+        JsonObject result = doc[cmd["hash"].as<const char *>()]["result"];
+        if (result.isNull()) {
+            return BlockchainStatus::EMPTY_RESPONSE;
+        }
+        const char *status = result["status"];
+        succeeded = succeeded && status && status[0] == 's';
+    }
+    return succeeded ? BlockchainStatus::SUCCESS : BlockchainStatus::FAILURE;
+}
+
+void BlockchainHandler::onBlockHeader(uint8_t chainId, uint32_t height)
+{
+    last_header_ms_ = millis();
+    if (chainId == chain_id_ && height > chain_height_) {
+        chain_height_ = height;
+        sync_wanted_ = true;
+    }
+}
+
+size_t BlockchainHandler::saveSnapshot(uint8_t *out, size_t capacity) const
+{
+    HandlerSnapshot snapshot;
+    handlerSnapshotKeyTag(public_key_, snapshot.keyTag);
+    snapshot.chainId = chain_id_;
+    snapshot.savedAt = getCurrentUnixTime();
+    snapshot.hasClockOffset = clock_skew_.hasEstimate();
+    snapshot.clockOffsetSeconds = clock_skew_.offsetSeconds();
+    snapshot.chainHeight = chain_height_;
+    snapshot.dueReady = due_ready_;
+    if (due_at_known_) {
+        long dueInMs = static_cast<long>(due_at_ms_ - millis());
+        snapshot.dueAt = snapshot.savedAt + (dueInMs > 0 ? (dueInMs + 999) / 1000 : 0);
+    }
+    snapshot.directorKey = director_pubkeyd_;
+    return encodeHandlerSnapshot(snapshot, out, capacity);
+}
+
+bool BlockchainHandler::restoreSnapshot(const uint8_t *data, size_t length)
+{
+    HandlerSnapshot snapshot;
+    uint8_t keyTag[HANDLER_SNAPSHOT_TAG_SIZE];
+    handlerSnapshotKeyTag(public_key_, keyTag);
+    if (!decodeHandlerSnapshot(data, length, snapshot) || snapshot.chainId != chain_id_ ||
+        memcmp(snapshot.keyTag, keyTag, sizeof(keyTag)) != 0) {
+        return false;
+    }
+    uint32_t now = getCurrentUnixTime();
+    if (now < snapshot.savedAt || now - snapshot.savedAt > HANDLER_SNAPSHOT_MAX_AGE_S) {
+        Serial.printf("Ignoring snapshot saved at %u, now %u\n", (unsigned)snapshot.savedAt, (unsigned)now);
+        return false;
+    }
+
+    director_pubkeyd_ = snapshot.directorKey;
+    if (snapshot.hasClockOffset) {
+        clock_skew_.seed(snapshot.clockOffsetSeconds);
+    }
+    if (snapshot.chainHeight > chain_height_) {
+        chain_height_ = snapshot.chainHeight;
     }
+    due_ready_ = snapshot.dueReady;
+    due_at_known_ = beacon_interval_s_ != 0 && snapshot.dueAt != 0;
+    due_at_ms_ = millis() + (snapshot.dueAt > now ? (snapshot.dueAt - now) * 1000UL : 0);
+    return true;
+}
+
+bool BlockchainHandler::headerFeedLive() const
+{
+    unsigned long last = last_header_ms_;
+    return last != 0 && millis() - last < BLOCK_HEADER_STALL_MS;
+}
 
-    return commandType == "local" ? parseBlockchainResponse(response, command) : BlockchainStatus::SUCCESS;
+bool BlockchainHandler::knownDue() const
+{
+    return due_ready_ || (due_at_known_ && static_cast<long>(millis() - due_at_ms_) >= 0);
+}
+
+void BlockchainHandler::onBeaconAccepted()
+{
+    due_ready_ = false;
+    due_at_known_ = beacon_interval_s_ != 0;
+    due_at_ms_ = millis() + beacon_interval_s_ * 1000UL;
+}
+
+void BlockchainHandler::seedRelayState(const std::string &directorKey, bool due)
+{
+    director_pubkeyd_ = directorKey;
+    due_ready_ = due;
+}
+
+bool BlockchainHandler::onRelayAck(const uint8_t *packet, size_t length)
+{
+    uint8_t key[HASH_SIZE];
+    if (!relay_pending_ || !decodeRelayAck(packet, length, key) || memcmp(key, relay_key_, sizeof(key)) != 0) {
+        return false;
+    }
+    relay_pending_ = false;
+    onBeaconAccepted();
+    if (relay_on_secret_) {
+        relay_on_secret_(relay_packet_id_);
+        Serial.printf("Relayed update acknowledged, packet id: %d\n", relay_packet_id_);
+    }
+    return true;
+}
+
+const char *BlockchainHandler::rebuildRelayedCommand(const RelayCommand &relay, String &fallback)
+{
+    char nonce[NONCE_BUFFER_SIZE];
+    NonceGenerator::format(nonce, relay.nonceMs, relay.nonceCounter);
+    std::string publicKey = encryptionHandler_.bytesToHex(relay.publicKey, sizeof(relay.publicKey));
+    JsonDocument cmdObject = createCommandObject(buildPactCode(relay.call, relay.argument), publicKey,
+                                                 String(relay.chainId), relay.creationTime, nonce);
+    return serializeDocument(cmdObject, fallback);
+}
+
+bool BlockchainHandler::relayCommand(PactCall call, const String &argument)
+{
+    if (!relay_sender_ || call >= PactCall::RAW || pactCommand(call).endpoint != PactEndpoint::SEND) {
+        return false;
+    }
+    if (arena_) {
+        arena_->reset();
+    }
+
+    RelayCommand relay;
+    relay.call = call;
+    relay.chainId = chain_id_;
+    relay.creationTime = clock_skew_.chainTime(getCurrentUnixTime());
+    relay.argument = argument;
+    char nonce[NONCE_BUFFER_SIZE];
+    NonceGenerator::shared().next(nonce);
+    NonceGenerator::parse(nonce, relay.nonceMs, relay.nonceCounter);
+
+    JsonDocument cmdObject =
+        createCommandObject(buildPactCode(call, argument), public_key_, chain_id_str_, relay.creationTime, nonce);
+    String cmdFallback;
+    const char *cmdString = serializeDocument(cmdObject, cmdFallback);
+    if (!cmdString) {
+        Serial.printf("Arena exhausted while building relayed command\n");
+        return false;
+    }
+
+    HashVector vector{"Test1", cmdString};
+    uint8_t *hashBin = encryptionHandler_.Binhash(&vector);
+    memcpy(relay.hashCheck, hashBin, sizeof(relay.hashCheck));
+    memcpy(relay_key_, hashBin, sizeof(relay_key_));
+    String signHex = encryptionHandler_.generateSignature(public_key_, private_key_, hashBin);
+    encryptionHandler_.HexToBytes(signHex.c_str(), reinterpret_cast<char *>(relay.signature));
+    encryptionHandler_.HexToBytes(public_key_, reinterpret_cast<char *>(relay.publicKey));
+
+    std::unique_ptr<uint8_t[]> messageFallback;
+    uint8_t *message;
+    if (arena_) {
+        message = static_cast<uint8_t *>(arena_->allocate(MESH_RELAY_MAX_MESSAGE));
+    } else {
+        messageFallback.reset(new uint8_t[MESH_RELAY_MAX_MESSAGE]);
+        message = messageFallback.get();
+    }
+    size_t length = message ? encodeRelayCommand(relay, message, MESH_RELAY_MAX_MESSAGE) : 0;
+
+    // Only relay what the gateway will rebuild byte for byte; anything else would fail signature checks there
+    RelayCommand decoded;
+    String rebuiltFallback;
+    const char *rebuilt = length && decodeRelayCommand(message, length, decoded)
+                              ? rebuildRelayedCommand(decoded, rebuiltFallback)
+                              : nullptr;
+    if (!rebuilt || strcmp(rebuilt, cmdString) != 0) {
+        Serial.printf("Command cannot be relayed over the mesh\n");
+        return false;
+    }
+
+    size_t fragments = fragmentRelayMessage(message, length, relay.nonceCounter & 0xffff, relay_sender_);
+    Serial.printf("Relayed %u byte command (%u byte cmd) in %u fragments\n", (unsigned)length,
+                  (unsigned)strlen(cmdString), (unsigned)fragments);
+    return fragments > 0;
+}
+
+BlockchainStatus BlockchainHandler::submitRelayedCommand(const uint8_t *message, size_t length)
+{
+    return submitRelayedCommands(&message, &length, 1);
+}
+
+BlockchainStatus BlockchainHandler::submitRelayedCommands(const uint8_t *const messages[], const size_t lengths[],
+                                                          size_t count)
+{
+    if (!isWifiAvailable()) {
+        return BlockchainStatus::NO_WIFI;
+    }
+
+    BlockchainStatus result = BlockchainStatus::SUCCESS;
+    std::vector<RelayCommand> relays(count);
+    std::vector<bool> valid(count, false);
+    for (size_t i = 0; i < count; i++) {
+        if (!decodeRelayCommand(messages[i], lengths[i], relays[i]) || relays[i].chainId >= KADENA_CHAIN_COUNT) {
+            result = BlockchainStatus::PARSING_ERROR;
+            continue;
+        }
+        valid[i] = true;
+    }
+
+    std::vector<String> cmdFallbacks(count);
+    std::vector<size_t> chunk;
+    std::vector<HashVector> vectors;
+    for (uint8_t chainId = 0; chainId < KADENA_CHAIN_COUNT; chainId++) {
+        size_t next = 0;
+        for (;;) {
+            // Rebuild the next chunk, until the commands fill their share of the arena; everything
+            // of a chunk is released before the next one
+            if (arena_) {
+                arena_->reset();
+            }
+            chunk.clear();
+            vectors.clear();
+            for (; next < count; next++) {
+                if (!valid[next] || relays[next].chainId != chainId) {
+                    continue;
+                }
+                if (!chunk.empty() && arena_ && arena_->used() > arena_->capacity() / RELAY_ARENA_CHUNK_DIVISOR) {
+                    break;
+                }
+                const char *cmdString = rebuildRelayedCommand(relays[next], cmdFallbacks[next]);
+                if (!cmdString) {
+                    return BlockchainStatus::OUT_OF_MEMORY;
+                }
+                chunk.push_back(next);
+                vectors.push_back(HashVector{"Relay", cmdString});
+            }
+            if (chunk.empty()) {
+                break;
+            }
+
+            // The chunk is hashed together in SIMD lanes, and each hash checked against the signed one
+            encryptionHandler_.Binhashes(vectors.data(), vectors.size());
+            String serverUrl = router_ ? router_->serverUrlFor(chainId) : serverUrlForChain(kda_server_, chainId);
+            JsonDocument request = newDocument();
+            size_t submitted = 0;
+            PactCall call = PactCall::RAW;
+            for (size_t j = 0; j < chunk.size(); j++) {
+                const RelayCommand &relay = relays[chunk[j]];
+                if (memcmp(vectors[j].hash, relay.hashCheck, sizeof(relay.hashCheck)) != 0) {
+                    Serial.printf("Relayed command does not match its hash\n");
+                    valid[chunk[j]] = false;
+                    result = BlockchainStatus::PARSING_ERROR;
+                    continue;
+                }
+                String signHex(encryptionHandler_.bytesToHex(relay.signature, sizeof(relay.signature)).c_str());
+                fillPostObject(request["cmds"].add<JsonObject>(), vectors[j].data, encryptionHandler_.KDAhash(vectors[j].hash), signHex);
+                call = relay.call;
+                submitted++;
+            }
+            if (submitted == 0) {
+                continue;
+            }
+
+            trace_ = TraceRecord();
+            trace_.timestampMs = millis();
+            BlockchainStatus status =
+                submitRequest(call, serverUrl, chainId, pactEndpointPath(PactEndpoint::SEND), request);
+            if (result == BlockchainStatus::SUCCESS) {
+                result = status;
+            }
+
+            // Tell each node its command was accepted, so it can send the matching radio beacon
+            for (size_t j = 0; status == BlockchainStatus::SUCCESS && relay_ack_sender_ && j < chunk.size(); j++) {
+                if (valid[chunk[j]]) {
+                    uint8_t ack[MESH_RELAY_ACK_SIZE];
+                    size_t ackLength =
+                        encodeRelayAck(relays[chunk[j]].nonceCounter & 0xffff, vectors[j].hash, ack, sizeof(ack));
+                    relay_ack_sender_(chunk[j], ack, ackLength);
+                }
+            }
+            for (size_t i : chunk) {
+                cmdFallbacks[i] = String();
+            }
+        }
+    }
+    return result;
 }
 
 String BlockchainHandler::encryptPayload(const std::string &payload)
 {
-    if (!encryptionHandler_) {
-        //LOG_ERROR("Encryption handler is not initialized. Encryption failed.\n");
-        return "";
+    if (arena_) {
+        arena_->reset();
     }
-    return encryptionHandler_->encrypt(director_pubkeyd_, payload);
+    return encryptionHandler_.encrypt(director_pubkeyd_, payload);
 }
 
+JsonDocument BlockchainHandler::newDocument()
+{
+    return arena_ ? JsonDocument(&json_allocator_) : JsonDocument();
+}
+
+const char *BlockchainHandler::serializeDocument(const JsonDocument &doc, String &fallback)
+{
+    if (!arena_) {
+        serializeJson(doc, fallback);
+        return fallback.c_str();
+    }
+    size_t length = measureJson(doc);
+    char *buffer = static_cast<char *>(arena_->allocate(length + 1));
+    if (!buffer) {
+        return nullptr;
+    }
+    serializeJson(doc, buffer, length + 1);
+    return buffer;
+}
+
+
 // Function to convert enum to string
 std::string BlockchainHandler::blockchainStatusToString(BlockchainStatus status)
 {
@@ -239,6 +1137,8 @@ std::string BlockchainHandler::blockchainStatusToString(BlockchainStatus status)
         return "READY";
     case BlockchainStatus::NOT_DUE:
         return "NOT_DUE";
+    case BlockchainStatus::OUT_OF_MEMORY:
+        return "OUT_OF_MEMORY";
     default:
         return "UNKNOWN_STATUS";
     }
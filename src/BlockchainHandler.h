@@ -1,5 +1,6 @@
 #pragma once
 #include <Arduino.h>
+#include <atomic>
 #include <memory>
 #ifndef UNIT_TEST
   #include <WiFi.h>  // For WiFi status checks
@@ -9,7 +10,17 @@
 #include <string>
 #include <functional>
 #include <ArduinoJson.h>
+#include "Arena.h"
+#include "BeaconBatch.h"
+#include "BlockHeaderStream.h"
+#include "ChainRouter.h"
+#include "ClockSkew.h"
 #include "EncryptionHandler.h"
+#include "HandlerSnapshot.h"
+#include "MeshRelay.h"
+#include "PactCommands.h"
+#include "SubmissionLimiter.h"
+#include "Trace.h"
 
 // Define an enumeration for status codes
 enum class BlockchainStatus {
@@ -22,12 +33,54 @@ enum class BlockchainStatus {
     NODE_NOT_FOUND,
     READY,
     NOT_DUE,
+    OUT_OF_MEMORY,
 };
 
 // Meshtastic callbacks
 using PacketIdGenerator = std::function<uint32_t(void)>;
 using SecretCallback = std::function<void(uint32_t packetId)>;
 
+// Waits between retries; delay() unless replaced
+using RetrySleep = std::function<void(uint32_t ms)>;
+
+// Attempts per request and the backoff between them, doubled after every failed attempt
+#define COMMAND_RETRY_ATTEMPTS 3
+#define COMMAND_RETRY_MIN_MS 1000
+#define COMMAND_RETRY_MAX_MS 8000
+
+// Default for setBeaconInterval; 0 makes no assumption about when a node is due again
+#ifndef NODE_BEACON_INTERVAL_S
+#define NODE_BEACON_INTERVAL_S 0
+#endif
+
+// With an arena, a gateway rebuilds relayed /send commands until they fill 1/N of it before submitting
+// them; the request body serialized from them takes about as much again
+#define RELAY_ARENA_CHUNK_DIVISOR 3
+
+// No-WiFi syncs a relayed update-sent may wait for the gateway's ack before it is relayed again
+#ifndef MESH_RELAY_ACK_TIMEOUT_SYNCS
+#define MESH_RELAY_ACK_TIMEOUT_SYNCS 3
+#endif
+
+/**
+ * @struct RetryPolicy
+ * @brief How often and how patiently a request is repeated after a transport error, 429 or 5xx.
+ */
+struct RetryPolicy {
+    uint8_t attempts = COMMAND_RETRY_ATTEMPTS; ///< Total attempts; 1 disables retries.
+    uint32_t minDelayMs = COMMAND_RETRY_MIN_MS; ///< Delay before the first retry.
+    uint32_t maxDelayMs = COMMAND_RETRY_MAX_MS; ///< Upper bound of the doubled delay.
+};
+
+/**
+ * @struct NodeQueryResult
+ * @brief One node's answer to a multi-node status query (see queryNodeStatuses).
+ */
+struct NodeQueryResult {
+    BlockchainStatus status = BlockchainStatus::FAILURE; ///< READY, NOT_DUE or NODE_NOT_FOUND, else why the query failed.
+    std::string directorKey;                              ///< The director key returned for the node, may be empty.
+};
+
 class BlockchainHandler
 {
   public:
@@ -36,12 +89,37 @@ class BlockchainHandler
      *
      * @param public_key The public key to be used for blockchain operations.
      * @param private_key The private key to be used for blockchain operations.
-     * @param server_url The blockchain server URL (optional)
+     * @param server_url The blockchain server URL (optional). The chainId used in command metadata
+     *                   is taken from its "/chain/<id>/" segment. A segment that is not a chain number
+     *                   (0..KADENA_CHAIN_COUNT-1) leaves the handler invalid: every command fails.
+     * @param arena Pre-reserved memory for per-command temporaries (optional). When set, JSON documents,
+     *              request and response bodies and encryption scratch are taken from the arena instead
+     *              of the heap, and a command that does not fit fails with OUT_OF_MEMORY.
+     *              See BLOCKCHAIN_ARENA_MIN_SIZE for the worst-case budget.
      */
     BlockchainHandler(const std::string& public_key, 
                      const std::string& private_key,
                      bool is_wallet_enabled,
-                     const String& server_url = "http://kda.crankk.org/chainweb/0.0/mainnet01/chain/19/pact/api/v1/");
+                     const String& server_url = "http://kda.crankk.org/chainweb/0.0/mainnet01/chain/19/pact/api/v1/",
+                     Arena* arena = nullptr);
+
+    /**
+     * Initializes a new instance of the BlockchainHandler class on the chain a router assigns to it.
+     *
+     * The chainId placed in the command metadata and the endpoint URL are both derived from the
+     * router's assignment for the public key. Submissions are reported to the router so it can
+     * track per-chain throughput and queue depth. The router must outlive the handler.
+     *
+     * @param public_key The public key to be used for blockchain operations.
+     * @param private_key The private key to be used for blockchain operations.
+     * @param router The router used to select the chain and collect statistics.
+     * @param arena Pre-reserved memory for per-command temporaries (optional).
+     */
+    BlockchainHandler(const std::string& public_key,
+                     const std::string& private_key,
+                     bool is_wallet_enabled,
+                     ChainRouter& router,
+                     Arena* arena = nullptr);
 
     /**
      * Destructor for the BlockchainHandler class.
@@ -51,7 +129,8 @@ class BlockchainHandler
     /**
      * Checks if the wallet configuration is valid.
      *
-     * This method verifies if the wallet is enabled and both the public and private keys are of the correct length.
+     * This method verifies if the wallet is enabled, both the public and private keys are of the correct length
+     * and the server URL names a valid chain.
      *
      * @return True if the wallet configuration is valid, otherwise false.
      */
@@ -83,6 +162,30 @@ class BlockchainHandler
      */
     BlockchainStatus executeBlockchainCommand(const String &commandType, const String &command);
 
+    /**
+     * Executes a typed Pact call on the endpoint its descriptor specifies.
+     *
+     * The code is built from the call's template and the response, for /local calls, is decoded
+     * by the decoder matching the call's result shape.
+     *
+     * @param call The Pact call to execute.
+     * @param argument The call's string argument, ignored for calls without one.
+     * @return A BlockchainStatus enumeration value indicating the result of the command execution.
+     */
+    BlockchainStatus executeBlockchainCommand(PactCall call, const String &argument = "");
+
+    /**
+     * Executes ready-made Pact code, decoding the response as the given call.
+     *
+     * Unlike the string overload, the call is not inferred from the code, e.g. when replaying a
+     * recorded command exactly as it was made.
+     *
+     * @param call The call the code invokes, or PactCall::RAW.
+     * @param commandType Identifies the web service for the call.
+     * @param command The Pact code to execute.
+     */
+    BlockchainStatus executeBlockchainCommand(PactCall call, const String &commandType, const String &command);
+
     /**
      * Encrypts a payload.
      *
@@ -112,7 +215,253 @@ class BlockchainHandler
      */
     bool isWifiAvailable() const { return WiFi.status() == WL_CONNECTED; }
 
+    /**
+     * Returns the Chainweb chain this handler submits to.
+     */
+    uint8_t chainId() const { return chain_id_; }
+
+    /**
+     * Returns the estimated offset between chain time and the local clock, in seconds.
+     *
+     * The estimate is refined from the "Date" header of every response and the block time of
+     * every /local result, and is applied to the creationTime of each command built.
+     */
+    int32_t clockOffsetSeconds() const { return clock_skew_.offsetSeconds(); }
+
+    /**
+     * Enables or disables advertising gzip/deflate support to the node (enabled by default).
+     *
+     * Compressed /local responses are inflated through a fixed INFLATE_WINDOW_SIZE window
+     * directly into the JSON parser. A response that refers further back than the window is
+     * requested once more without compression rather than failing.
+     */
+    void setResponseCompression(bool enabled) { accept_compression_ = enabled; }
+
+    /**
+     * Sets the mesh transport used to relay commands when WiFi is unavailable.
+     *
+     * With a relay set, performNodeSync sends update-sent over the mesh instead of giving up,
+     * provided the director key is known from an earlier sync and the node is known to be due:
+     * its last get-my-node answered READY, or the beacon interval set with setBeaconInterval has
+     * passed since its last beacon was accepted. One relayed update-sent is outstanding at a time. Its secret callback
+     * only runs once the gateway acknowledges the submission (see onRelayAck), so no radio beacon
+     * goes out for a command that never reached the chain. Without an ack after
+     * MESH_RELAY_ACK_TIMEOUT_SYNCS further syncs the command or its ack is taken as lost and the
+     * update is relayed again.
+     *
+     * A node that has never had WiFi knows neither the director key nor its due state and does
+     * not relay until they are seeded with seedRelayState. Without a beacon interval, a node that
+     * stays off WiFi relays once per seeded or queried due state.
+     */
+    void setMeshRelay(MeshRelaySender sender) { relay_sender_ = sender; }
+
+    /**
+     * Seeds what relaying needs on a node that cannot query get-my-node itself, e.g. from
+     * provisioning. A later get-my-node answer or restored snapshot replaces it.
+     *
+     * @param directorKey The director's public key the beacon secret is encrypted for.
+     * @param due Whether the node is due; an update-sent relayed when it is not is rejected on chain.
+     */
+    void seedRelayState(const std::string &directorKey, bool due);
+
+    /**
+     * Node side: handles an ack received from the gateway.
+     *
+     * An ack for the pending relayed update-sent counts as an accepted beacon: the packet id is
+     * handed to the secret callback given to performNodeSync, as after an update-sent over WiFi.
+     *
+     * @return True if the packet acknowledged the pending relay.
+     */
+    bool onRelayAck(const uint8_t *packet, size_t length);
+
+    /**
+     * Gateway side: sets how acks are returned to the nodes whose /send commands were accepted
+     * by submitRelayedCommands.
+     */
+    void setRelayAckSender(MeshRelayAckSender sender) { relay_ack_sender_ = sender; }
+
+    /**
+     * Builds and signs a typed call, then sends it over the mesh in its compact binary form.
+     *
+     * Only the variable fields are sent (see RelayCommand); the command is relayed only if the
+     * encoding rebuilds the signed JSON exactly, and is split into MESH_RELAY_PACKET_SIZE fragments.
+     * Only calls submitted to /send can be relayed, as no /local answer comes back over the mesh.
+     *
+     * @return True if the command was handed to the mesh transport.
+     */
+    bool relayCommand(PactCall call, const String &argument = "");
+
+    /**
+     * Gateway side: rebuilds a reassembled relay message into the signed command and submits it.
+     *
+     * The command goes to /send on the chain it was built for. Its hash is recomputed from the
+     * rebuilt JSON and checked against the one the node signed. Messages carrying a /local call
+     * are rejected, so no other node's answer is decoded into this handler's state.
+     *
+     * @param message A complete message, e.g. from MeshRelayReassembler.
+     * @param length The message length in bytes.
+     * @return A BlockchainStatus enumeration value indicating the result of the submission,
+     *         PARSING_ERROR if the message cannot be rebuilt.
+     */
+    BlockchainStatus submitRelayedCommand(const uint8_t *message, size_t length);
+
+    /**
+     * Gateway side: rebuilds and submits a batch of relay messages, e.g. everything reassembled
+     * since the last loop iteration.
+     *
+     * Commands are grouped per chain, so each chain gets one /send request carrying all of its
+     * commands, and are rebuilt and hashed together in SIMD lanes (see
+     * EncryptionHandler::Binhashes). With an arena, a chain's commands are split into chunks
+     * that fill 1/RELAY_ARENA_CHUNK_DIVISOR of it, each rebuilt and submitted from a fresh
+     * arena, so a batch of any size fits. Messages that cannot be rebuilt or do not match their hash are dropped and
+     * the rest are still submitted.
+     *
+     * @param messages Complete messages, e.g. from MeshRelayReassembler.
+     * @param lengths The length of each message in bytes.
+     * @param count The number of messages.
+     * @return SUCCESS if every command was submitted, otherwise the first failure.
+     */
+    BlockchainStatus submitRelayedCommands(const uint8_t *const messages[], const size_t lengths[], size_t count);
+
+    /**
+     * Commits a gateway's collected beacons in one update-sent-batch transaction, signed by this
+     * handler's key, instead of one update-sent per node.
+     *
+     * The transaction carries the batch's Merkle root and node keys. Hand each node's secret to
+     * the director with batch.proof() once this returns SUCCESS; clear the batch afterwards.
+     *
+     * Requires a contract function (update-sent-batch root keys) that the deployed free.mesh03
+     * does not have yet. Until it does, /send still accepts the transaction but it fails on chain,
+     * so no node counts as beaconed.
+     *
+     * @return FAILURE for an empty batch, otherwise the submission status.
+     */
+    BlockchainStatus submitBeaconBatch(BeaconBatch &batch);
+
+    /**
+     * Gateway side: asks for the status of many nodes with one signed /local per chunk instead of
+     * one get-my-node per node.
+     *
+     * Each chunk maps get-node over as many keys as fit in maxCodeSize, bounding the size of the
+     * response, and its result list is decoded in the same filtered streaming pass as any /local
+     * response. Identical director keys are stored once while parsing.
+     *
+     * Requires a contract function (get-node key) answering like get-my-node for any node, which
+     * the deployed free.mesh03 does not have yet. Until it does, every chunk fails and each node
+     * carries that failure.
+     *
+     * @param nodeIds The node keys.
+     * @param results Receives one entry per key, in order.
+     * @param maxCodeSize The longest expression per /local.
+     * @return SUCCESS if every chunk was answered, otherwise the first failure, which is also the
+     *         status of every node in that chunk.
+     */
+    BlockchainStatus queryNodeStatuses(const std::vector<std::string> &nodeIds, std::vector<NodeQueryResult> &results,
+                                       size_t maxCodeSize = NODE_QUERY_MAX_CODE_SIZE);
+
+    /**
+     * Feeds a block header, typically from a BlockHeaderSubscription listener.
+     *
+     * A header on this handler's chain raises chainHeight() and makes syncWanted() true. Headers
+     * on any chain mark the feed as live; while it is, performNodeSync skips the signed /local
+     * query when no block has landed since the node was last reported NOT_DUE. With a beacon
+     * interval set (see setBeaconInterval), /local is also skipped until it has passed since the
+     * last accepted beacon, whatever the feed reports.
+     */
+    void onBlockHeader(uint8_t chainId, uint32_t height);
+
+    /**
+     * Returns true when a block has landed on this chain since the last performNodeSync.
+     *
+     * Polling this from the application loop bounds beacon latency by block time rather
+     * than by the sync interval.
+     */
+    bool syncWanted() const { return sync_wanted_; }
+
+    /**
+     * Returns the latest known height of this chain, from block headers and /local responses.
+     */
+    uint32_t chainHeight() const { return chain_height_; }
+
+    /**
+     * Captures every submitted command to a trace, or stops capturing when writer is nullptr.
+     *
+     * Each record holds the request and response bodies, the HTTP status, the resulting status and
+     * the duration of each TraceStage. Records are written straight from the command's buffers.
+     * The writer must outlive the handler or be detached first.
+     */
+    void setTraceWriter(TraceWriter *writer) { trace_writer_ = writer; }
+
+    /**
+     * Saves what a fresh handler would otherwise re-learn after waking from deep sleep: the
+     * director key, the clock offset, the chain height and the node's due state (see
+     * HandlerSnapshot).
+     *
+     * The buffer can live in RTC memory (RTC_DATA_ATTR) or be written to flash or a file.
+     *
+     * @param out Receives the snapshot; HANDLER_SNAPSHOT_MAX_SIZE bytes always suffice.
+     * @param capacity The size of out.
+     * @return The snapshot length, or 0 if it does not fit.
+     */
+    size_t saveSnapshot(uint8_t *out, size_t capacity) const;
+
+    /**
+     * Restores a snapshot taken by saveSnapshot, typically right after construction at boot.
+     *
+     * With the director key restored, the mesh relay fallback and encryption work before the
+     * first signed /local, and the first command already carries a skew-corrected creationTime.
+     * With a beacon interval set and the due time of an accepted beacon restored, performNodeSync
+     * skips /local on waking until the node is due again.
+     *
+     * @return False, leaving the handler unchanged, if the snapshot is invalid, older than
+     *         HANDLER_SNAPSHOT_MAX_AGE_S or taken by a handler with another key or chain.
+     */
+    bool restoreSnapshot(const uint8_t *data, size_t length);
+
+    /**
+     * Sets how requests are retried after a transport error, a 429 or a 5xx answer.
+     *
+     * A retry resends the bytes signed for the first attempt, so the request key stays the same
+     * and nothing is hashed or signed again. Before resending a /send, /poll is asked whether an
+     * earlier attempt landed despite its failed response; if so, its outcome is returned instead.
+     * A Retry-After answer stretches the wait to what the node asked for, up to maxDelayMs; a
+     * longer one ends the retries and its status is returned. Other 4xx answers are never retried.
+     */
+    void setRetryPolicy(const RetryPolicy &policy) { retry_policy_ = policy; }
+
+    /**
+     * Sets the interval the node assumes the contract enforces between its beacons.
+     *
+     * get-my-node only answers whether the node is due now, so this is an assumption the
+     * application makes about its contract, not something read from the chain. With it set,
+     * performNodeSync skips the signed /local until the interval has passed since the last
+     * accepted beacon. Set longer than the contract's, beacons are delayed by the difference;
+     * set shorter, the node is only asked early and answers NOT_DUE. 0, the default, skips
+     * nothing and asks the contract on every sync.
+     */
+    void setBeaconInterval(uint32_t seconds) { beacon_interval_s_ = seconds; }
+
+    /**
+     * Replaces the blocking delay() between retries, e.g. to yield to other tasks.
+     */
+    void setRetrySleep(RetrySleep sleep) { retry_sleep_ = sleep; }
+
+    /**
+     * Routes every request, including the /poll before a retry, through a limiter, or sends them
+     * unthrottled when limiter is nullptr.
+     *
+     * A gateway shares one limiter between the handlers talking to the same node. Each request
+     * waits for admission and reports its status, latency and Retry-After back, so the limiter
+     * backs off when the node shows overload and recovers the throughput when it does not.
+     * The limiter must outlive the handler or be detached first.
+     */
+    void setSubmissionLimiter(SubmissionLimiter *limiter) { limiter_ = limiter; }
+
   private:
+#ifdef UNIT_TEST
+    friend struct BlockchainHandlerTestAccess;
+#endif
+
     /**
      * Creates a JSON document representing a blockchain command.
      *
@@ -121,9 +470,18 @@ class BlockchainHandler
      * Uses ArduinoJson's JsonDocument for efficient memory management and JSON handling.
      *
      * @param command The blockchain command to be executed.
+     * @param gasLimit The gas limit placed in the metadata.
      * @return A JsonDocument representing the command to be sent to the blockchain.
      */
-    JsonDocument createCommandObject(const String &command);
+    JsonDocument createCommandObject(const String &command, uint32_t gasLimit = PACT_GAS_LIMIT);
+
+    /**
+     * Creates the command JSON from explicit values for every variable field.
+     *
+     * Shared by locally built and relayed commands, so both serialize to identical bytes.
+     */
+    JsonDocument createCommandObject(const String &command, const std::string &publicKey, const String &chainId,
+                                     uint32_t creationTime, const char *nonce, uint32_t gasLimit = PACT_GAS_LIMIT);
 
     /**
      * Prepares a JSON document for POST request based on the command object and command type.
@@ -138,27 +496,164 @@ class BlockchainHandler
      */
     JsonDocument preparePostObject(const JsonDocument &cmdObject, const String &commandType);
 
+    /**
+     * Fills a post object with the serialized command, its hash and its signature.
+     */
+    void fillPostObject(JsonObject postObject, const char *cmdString, const String &hash, const String &signHex);
+
+    /**
+     * Serializes the JSON of a relayed command.
+     *
+     * @return The null-terminated command, or nullptr if the arena is exhausted.
+     */
+    const char *rebuildRelayedCommand(const RelayCommand &relay, String &fallback);
+
+    /**
+     * Returns true if a block header arrived within BLOCK_HEADER_STALL_MS.
+     */
+    bool headerFeedLive() const;
+
+    /**
+     * Returns true if the node is known to be due: get-my-node said so, or the beacon interval
+     * has passed since its last accepted beacon.
+     */
+    bool knownDue() const;
+
+    /**
+     * Records an accepted update-sent: with a beacon interval set, the node is not due again until it passes.
+     */
+    void onBeaconAccepted();
+
     /**
      * Parses the blockchain response received as a string into a more usable form.
      *
      * This method takes a blockchain response in the form of a string, parses it using ArduinoJson,
      * and extracts relevant information, making it easier to handle the response programmatically.
      *
-     * The method first attempts to parse the response string into a JSON document. If the parsing
-     * fails, it returns a PARSING_ERROR status. It then examines the "result" field of the JSON
-     * document to determine the status of the blockchain command. Depending on the command type,
-     * it extracts specific information such as the director's public key and the send status.
+     * The method first attempts to parse the response string into a JSON document, keeping only the
+     * fields the call's result shape needs. If the parsing fails, it returns a PARSING_ERROR status.
+     * It then examines the "result" field of the JSON document and dispatches on the call's result
+     * shape to extract specific information such as the director's public key and the send status.
      *
      * @param response The blockchain response as a raw string.
-     * @param command The blockchain command that was executed, used to determine the context of the response.
+     * @param length The length of the response in bytes.
+     * @param call The Pact call that was executed, selecting the decoder.
+     * @param compressed Whether the response is gzip or deflate encoded.
      * @return A BlockchainStatus enum value representing the status of the parsed response.
      */
-    BlockchainStatus parseBlockchainResponse(const String &response, const String &command);
+    BlockchainStatus parseBlockchainResponse(const char *response, size_t length, PactCall call, bool compressed = false);
+
+    /**
+     * Decodes a get-my-node result: READY or NOT_DUE from "send", caching the director key.
+     */
+    BlockchainStatus decodeNodeStatus(bool succeeded, JsonObject data);
+
+    /**
+     * Decodes a get-sender-details result, caching the director key.
+     */
+    BlockchainStatus decodeSenderDetails(bool succeeded, JsonObject data);
+
+    /**
+     * Decodes a multi-node query result into node_query_, one entry per queried node.
+     */
+    BlockchainStatus decodeNodeStatusList(bool succeeded, JsonArray data);
+
+    /**
+     * Builds, signs and submits Pact code, decoding /local responses as the given call.
+     *
+     * @param call The call the code invokes, or PactCall::RAW.
+     * @param commandType The endpoint path the command is posted to.
+     * @param command The Pact code to execute.
+     * @param gasLimit The gas limit of the command.
+     */
+    BlockchainStatus executePactCode(PactCall call, const String &commandType, const String &command,
+                                     uint32_t gasLimit = PACT_GAS_LIMIT);
+
+    /**
+     * Posts a signed command to a chain endpoint, decoding /local responses as the given call.
+     *
+     * @param serverUrl The Pact API base URL of the chain.
+     * @param chainId The chain, for router statistics.
+     * @param commandType The endpoint path the command is posted to; "send" wraps it in "cmds".
+     */
+    BlockchainStatus submitPostObject(PactCall call, const String &serverUrl, uint8_t chainId,
+                                      const String &commandType, const JsonDocument &postObject);
+
+    /**
+     * Posts a complete request body as it is, e.g. a "cmds" array holding several commands,
+     * retrying it according to the RetryPolicy.
+     */
+    BlockchainStatus submitRequest(PactCall call, const String &serverUrl, uint8_t chainId, const String &commandType,
+                                   const JsonDocument &request);
+
+    /**
+     * Makes a single attempt at posting a serialized request.
+     *
+     * @param resubmission Whether an earlier attempt sent the same bytes, so a node answering
+     *                     that it already holds the request key means success.
+     * @param httpResponseCode Receives the HTTP status, or a negative transport error.
+     * @param retryAfterMs Receives the delay requested by a Retry-After header, or 0.
+     */
+    BlockchainStatus postRequest(PactCall call, const String &serverUrl, uint8_t chainId, const String &commandType,
+                                 const char *postRaw, size_t postLength, bool resubmission, int &httpResponseCode,
+                                 uint32_t &retryAfterMs);
+
+    /**
+     * Asks /poll whether the commands of a /send landed.
+     *
+     * @return SUCCESS or FAILURE with the outcome once every command is in a block, EMPTY_RESPONSE
+     *         if one is not, or an error if the poll itself failed.
+     */
+    BlockchainStatus pollRequestKeys(const String &serverUrl, JsonArrayConst cmds);
+
+    /**
+     * Creates an empty JSON document backed by the arena when one is attached, otherwise by the heap.
+     */
+    JsonDocument newDocument();
+
+    /**
+     * Serializes a JSON document into arena memory, or into the fallback String when no arena is attached.
+     *
+     * @return The null-terminated serialized document, or nullptr if the arena is exhausted.
+     */
+    const char *serializeDocument(const JsonDocument &doc, String &fallback);
 
     std::string public_key_;
     std::string private_key_;
     bool is_wallet_enabled_;
     String kda_server_;
+    uint8_t chain_id_;
+    bool server_url_valid_ = true; // False when the URL's chain segment is not a chain number
+    String chain_id_str_;
+    ChainRouter* router_ = nullptr;
+    Arena* arena_ = nullptr;
+    ArenaJsonAllocator json_allocator_;
     std::string director_pubkeyd_;
-    std::unique_ptr<EncryptionHandler> encryptionHandler_;
+    ClockSkewEstimator clock_skew_;
+    bool accept_compression_ = true;
+    bool inflate_window_exceeded_ = false; // Set by parseBlockchainResponse for a reply the window could not hold
+    MeshRelaySender relay_sender_;
+    MeshRelayAckSender relay_ack_sender_;
+    bool due_ready_ = false;        // The last get-my-node answered READY and no beacon has gone out since
+    uint32_t beacon_interval_s_ = NODE_BEACON_INTERVAL_S;
+    bool due_at_known_ = false;     // due_at_ms_ follows an accepted beacon
+    unsigned long due_at_ms_ = 0;   // millis() at which the node is due again
+    bool relay_pending_ = false;    // A relayed update-sent awaits the gateway's ack
+    uint8_t relay_wait_syncs_ = 0;  // No-WiFi syncs since the pending relay went out
+    uint8_t relay_key_[HASH_SIZE];  // Hash of the last relayed command
+    uint32_t relay_packet_id_ = 0;
+    SecretCallback relay_on_secret_;
+    std::atomic<uint32_t> chain_height_{0};
+    std::atomic<unsigned long> last_header_ms_{0};
+    std::atomic<bool> sync_wanted_{false};
+    uint32_t not_due_height_ = 0;
+    TraceWriter *trace_writer_ = nullptr;
+    TraceRecord trace_;
+    RetryPolicy retry_policy_;
+    RetrySleep retry_sleep_;
+    SubmissionLimiter *limiter_ = nullptr;
+    // Where decodeNodeStatusList writes, set only while queryNodeStatuses runs a chunk
+    NodeQueryResult *node_query_ = nullptr;
+    size_t node_query_count_ = 0;
+    EncryptionHandler encryptionHandler_;
 };
\ No newline at end of file
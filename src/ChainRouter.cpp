@@ -0,0 +1,102 @@
+#include "ChainRouter.h"
+
+// FNV-1a, stable across builds and platforms so an identity always lands on the same chain
+static uint32_t fnv1a(const std::string &value)
+{
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : value) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+ChainRouter::ChainRouter(const String &network_url, uint8_t chain_count)
+    : network_url_(network_url)
+    , chain_count_(chain_count == 0 || chain_count > KADENA_CHAIN_COUNT ? KADENA_CHAIN_COUNT : chain_count)
+    , stats_since_ms_(millis())
+{
+    // Accept a base URL with or without the trailing slash
+    if (network_url_.length() > 0 && network_url_[network_url_.length() - 1] == '/') {
+        network_url_ = network_url_.substring(0, network_url_.length() - 1);
+    }
+}
+
+void ChainRouter::assignChain(const std::string &public_key, uint8_t chain_id)
+{
+    if (chain_id >= KADENA_CHAIN_COUNT) {
+        return;
+    }
+    assignments_[public_key] = chain_id;
+}
+
+uint8_t ChainRouter::chainFor(const std::string &public_key) const
+{
+    auto it = assignments_.find(public_key);
+    if (it != assignments_.end()) {
+        return it->second;
+    }
+    return fnv1a(public_key) % chain_count_;
+}
+
+String ChainRouter::serverUrlFor(uint8_t chain_id) const
+{
+    return network_url_ + "/chain/" + String(chain_id) + "/pact/api/v1/";
+}
+
+void ChainRouter::onSubmit(uint8_t chain_id)
+{
+    if (chain_id >= KADENA_CHAIN_COUNT) {
+        return;
+    }
+    counters_[chain_id].submitted++;
+    counters_[chain_id].inFlight++;
+}
+
+void ChainRouter::onComplete(uint8_t chain_id, bool success)
+{
+    if (chain_id >= KADENA_CHAIN_COUNT) {
+        return;
+    }
+    Counters &c = counters_[chain_id];
+    if (success) {
+        c.succeeded++;
+    } else {
+        c.failed++;
+    }
+    c.inFlight--;
+}
+
+uint32_t ChainRouter::queueDepth(uint8_t chain_id) const
+{
+    return chain_id < KADENA_CHAIN_COUNT ? counters_[chain_id].inFlight.load() : 0;
+}
+
+ChainStats ChainRouter::stats(uint8_t chain_id) const
+{
+    ChainStats result = {0, 0, 0, 0, 0.0f};
+    if (chain_id >= KADENA_CHAIN_COUNT) {
+        return result;
+    }
+    const Counters &c = counters_[chain_id];
+    result.submitted = c.submitted;
+    result.succeeded = c.succeeded;
+    result.failed = c.failed;
+    result.inFlight = c.inFlight;
+
+    unsigned long elapsed = millis() - stats_since_ms_;
+    if (elapsed > 0) {
+        result.throughput = (result.succeeded + result.failed) * 1000.0f / elapsed;
+    }
+    return result;
+}
+
+void ChainRouter::resetStats()
+{
+    for (Counters &c : counters_) {
+        c.submitted = c.inFlight.load();
+        c.succeeded = 0;
+        c.failed = 0;
+    }
+    stats_since_ms_ = millis();
+}
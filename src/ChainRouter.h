@@ -0,0 +1,97 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <map>
+#include <string>
+
+#define KADENA_CHAIN_COUNT 20
+#define DEFAULT_CHAIN_ID 19
+
+/**
+ * @struct ChainStats
+ * @brief Snapshot of the submission counters kept for a single chain.
+ */
+struct ChainStats {
+    uint32_t submitted;  ///< Commands handed to the transport for this chain.
+    uint32_t succeeded;  ///< Commands that completed with a non-error HTTP status.
+    uint32_t failed;     ///< Commands that failed at the transport or HTTP level.
+    uint32_t inFlight;   ///< Commands submitted but not yet completed (queue depth).
+    float throughput;    ///< Completed commands per second since the last reset.
+};
+
+/**
+ * Maps wallet identities onto Chainweb chains and keeps per-chain load counters.
+ *
+ * A gateway driving many nodes creates one router and passes it to every BlockchainHandler.
+ * Each identity is placed on a chain either through an explicit assignment or, by default,
+ * through a stable hash of its public key, so the chainId in the command metadata and the
+ * chain segment of the endpoint URL are always derived from the same value.
+ */
+class ChainRouter
+{
+  public:
+    /**
+     * @param network_url The network base URL, without the "/chain/<id>/..." suffix.
+     * @param chain_count The number of chains identities are spread across (1..KADENA_CHAIN_COUNT).
+     */
+    ChainRouter(const String &network_url = "http://kda.crankk.org/chainweb/0.0/mainnet01",
+                uint8_t chain_count = KADENA_CHAIN_COUNT);
+
+    /**
+     * Pins an identity to a specific chain, overriding the hash-based mapping.
+     * Assignments are expected to be made during setup, before handlers are created.
+     */
+    void assignChain(const std::string &public_key, uint8_t chain_id);
+
+    /**
+     * Returns the chain an identity is assigned to.
+     */
+    uint8_t chainFor(const std::string &public_key) const;
+
+    /**
+     * Builds the Pact API endpoint URL for a chain, e.g. ".../chain/19/pact/api/v1/".
+     */
+    String serverUrlFor(uint8_t chain_id) const;
+
+    /**
+     * Records that a command was handed to the transport for a chain.
+     */
+    void onSubmit(uint8_t chain_id);
+
+    /**
+     * Records the completion of a command previously reported through onSubmit.
+     */
+    void onComplete(uint8_t chain_id, bool success);
+
+    /**
+     * Returns the number of commands currently in flight for a chain.
+     */
+    uint32_t queueDepth(uint8_t chain_id) const;
+
+    /**
+     * Returns a snapshot of the counters for a chain.
+     */
+    ChainStats stats(uint8_t chain_id) const;
+
+    /**
+     * Clears the completion counters and restarts the throughput window.
+     * In-flight counts are kept so outstanding commands are still accounted for.
+     */
+    void resetStats();
+
+    uint8_t chainCount() const { return chain_count_; }
+
+  private:
+    struct Counters {
+        std::atomic<uint32_t> submitted{0};
+        std::atomic<uint32_t> succeeded{0};
+        std::atomic<uint32_t> failed{0};
+        std::atomic<uint32_t> inFlight{0};
+    };
+
+    String network_url_;
+    uint8_t chain_count_;
+    std::map<std::string, uint8_t> assignments_;
+    Counters counters_[KADENA_CHAIN_COUNT];
+    unsigned long stats_since_ms_;
+};
@@ -0,0 +1,103 @@
+#include "ClockSkew.h"
+#include <cmath>
+#include <cstring>
+
+static const double SAMPLE_WEIGHT = 0.25;
+
+// Days since 1970-01-01 for a proleptic Gregorian date (Howard Hinnant's days_from_civil)
+static int64_t daysFromCivil(int64_t year, unsigned month, unsigned day)
+{
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(year - era * 400);
+    const unsigned doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+static bool parseNumber(const char *&p, int digits, int &value)
+{
+    value = 0;
+    for (int i = 0; i < digits; i++, p++) {
+        if (*p < '0' || *p > '9') {
+            return false;
+        }
+        value = value * 10 + (*p - '0');
+    }
+    return true;
+}
+
+bool ClockSkewEstimator::parseHttpDate(const char *date, int64_t &unix_s)
+{
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    if (!date) {
+        return false;
+    }
+
+    // Skip the day name: "Sun, 06 Nov 1994 08:49:37 GMT"
+    const char *p = strchr(date, ',');
+    if (!p || strlen(p) < 26) {
+        return false;
+    }
+    p += 2;
+
+    int day, year, hour, minute, second;
+    if (!parseNumber(p, 2, day) || *p++ != ' ') {
+        return false;
+    }
+    int month = 0;
+    while (month < 12 && strncmp(months + month * 3, p, 3) != 0) {
+        month++;
+    }
+    if (month == 12) {
+        return false;
+    }
+    p += 3;
+    if (*p++ != ' ' || !parseNumber(p, 4, year) || *p++ != ' ' || !parseNumber(p, 2, hour) || *p++ != ':' ||
+        !parseNumber(p, 2, minute) || *p++ != ':' || !parseNumber(p, 2, second)) {
+        return false;
+    }
+
+    unix_s = daysFromCivil(year, month + 1, day) * 86400 + hour * 3600 + minute * 60 + second;
+    return true;
+}
+
+void ClockSkewEstimator::addSample(int64_t remote_unix_s, int64_t local_unix_s)
+{
+    double sample = static_cast<double>(remote_unix_s - local_unix_s);
+    if (samples_ == 0 || std::fabs(sample - offset_) > CLOCK_SKEW_RESEED_SECONDS) {
+        offset_ = sample;
+    } else {
+        offset_ += SAMPLE_WEIGHT * (sample - offset_);
+    }
+    samples_++;
+}
+
+bool ClockSkewEstimator::addHttpDate(const char *date, int64_t local_unix_s)
+{
+    int64_t remote;
+    if (!parseHttpDate(date, remote)) {
+        return false;
+    }
+    addSample(remote, local_unix_s);
+    return true;
+}
+
+void ClockSkewEstimator::addBlockTime(double block_time_us, int64_t local_unix_s)
+{
+    if (block_time_us <= 0) {
+        return;
+    }
+    addSample(static_cast<int64_t>(block_time_us / 1000000.0) + CLOCK_SKEW_BLOCK_AGE_SECONDS, local_unix_s);
+}
+
+int32_t ClockSkewEstimator::offsetSeconds() const
+{
+    return static_cast<int32_t>(std::lround(offset_));
+}
+
+void ClockSkewEstimator::seed(int32_t offset_s)
+{
+    offset_ = offset_s;
+    samples_ = samples_ > 0 ? samples_ : 1;
+}
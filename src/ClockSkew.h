@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+
+// Samples further than this from the current estimate replace it instead of being averaged in,
+// so a node whose RTC gets set (or jumps) converges immediately.
+#define CLOCK_SKEW_RESEED_SECONDS 300
+
+// Mean age of the block a /local result was evaluated on: half of Chainweb's 30 s block time
+#define CLOCK_SKEW_BLOCK_AGE_SECONDS 15
+
+/**
+ * Estimates the offset between the local clock and chain time.
+ *
+ * Samples come from HTTP "Date" headers returned by the Chainweb node and from the block time
+ * reported in /local response metadata. They are combined with an exponentially weighted moving
+ * average (weight 1/4 for each new sample) so a single slow response does not move the estimate much.
+ */
+class ClockSkewEstimator
+{
+  public:
+    /**
+     * Adds a sample pairing a chain-side time with the local time it was observed at.
+     *
+     * @param remote_unix_s Chain-side time in seconds since the Unix epoch.
+     * @param local_unix_s Local time in seconds since the Unix epoch when the sample was taken.
+     */
+    void addSample(int64_t remote_unix_s, int64_t local_unix_s);
+
+    /**
+     * Adds a sample from an HTTP "Date" header value (IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT").
+     *
+     * @return True if the header could be parsed, otherwise false.
+     */
+    bool addHttpDate(const char *date, int64_t local_unix_s);
+
+    /**
+     * Adds a sample from a Chainweb block time, in microseconds since the Unix epoch.
+     *
+     * The block was mined before the response, so it is aged by CLOCK_SKEW_BLOCK_AGE_SECONDS
+     * rather than taken as the current chain time.
+     */
+    void addBlockTime(double block_time_us, int64_t local_unix_s);
+
+    /**
+     * Returns the current offset estimate in seconds (chain time minus local time).
+     */
+    int32_t offsetSeconds() const;
+
+    /**
+     * Returns true once at least one sample has been added.
+     */
+    bool hasEstimate() const { return samples_ > 0; }
+
+    /**
+     * Converts a local Unix time to estimated chain time.
+     */
+    uint32_t chainTime(uint32_t local_unix_s) const { return local_unix_s + offsetSeconds(); }
+
+    /**
+     * Restores a previously observed offset, e.g. after a restart.
+     */
+    void seed(int32_t offset_s);
+
+    /**
+     * Parses an IMF-fixdate HTTP date into seconds since the Unix epoch.
+     *
+     * @return True on success, otherwise false.
+     */
+    static bool parseHttpDate(const char *date, int64_t &unix_s);
+
+  private:
+    double offset_ = 0.0;
+    uint32_t samples_ = 0;
+};
@@ -0,0 +1,558 @@
+#include "Ed25519Fast.h"
+#include "Crypto.h"
+#include "SHA512.h"
+#include <cstring>
+
+#if ED25519_BASE_TABLE_ROWS != 32 && ED25519_BASE_TABLE_ROWS != 16 && ED25519_BASE_TABLE_ROWS != 8 && ED25519_BASE_TABLE_ROWS != 4
+  #error "ED25519_BASE_TABLE_ROWS must be 32, 16, 8 or 4"
+#endif
+
+#include "Ed25519BaseTable.h"
+
+// Field elements modulo p = 2^255 - 19. Every operation returns limbs carried back to (about) their
+// nominal width, so any result can feed a multiplication without overflowing its accumulators.
+#if ED25519_FIELD_51
+
+static const int LIMBS = 5;
+static const uint64_t MASK51 = (1ULL << 51) - 1;
+
+struct Fe {
+    uint64_t v[LIMBS];
+};
+
+static inline int limbBits(int) { return 51; }
+
+static inline void feCarry(Fe &h)
+{
+    uint64_t carry = 0;
+    for (int i = 0; i < LIMBS; i++) {
+        h.v[i] += carry;
+        carry = h.v[i] >> 51;
+        h.v[i] &= MASK51;
+    }
+    h.v[0] += 19 * carry;
+}
+
+static inline void feAdd(Fe &h, const Fe &f, const Fe &g)
+{
+    for (int i = 0; i < LIMBS; i++) {
+        h.v[i] = f.v[i] + g.v[i];
+    }
+    feCarry(h);
+}
+
+static inline void feSub(Fe &h, const Fe &f, const Fe &g)
+{
+    // Adding 2p keeps every limb non-negative
+    h.v[0] = f.v[0] + 0xfffffffffffdaULL - g.v[0];
+    for (int i = 1; i < LIMBS; i++) {
+        h.v[i] = f.v[i] + 0xffffffffffffeULL - g.v[i];
+    }
+    feCarry(h);
+}
+
+static void feMul(Fe &h, const Fe &f, const Fe &g)
+{
+    typedef unsigned __int128 uint128_t;
+    uint64_t g19[LIMBS];
+    for (int i = 0; i < LIMBS; i++) {
+        g19[i] = 19 * g.v[i];
+    }
+
+    // Products wrapping past 2^255 fold back multiplied by 19
+    uint128_t t[LIMBS] = {};
+    for (int i = 0; i < LIMBS; i++) {
+        for (int j = 0; j < LIMBS; j++) {
+            if (i + j < LIMBS) {
+                t[i + j] += static_cast<uint128_t>(f.v[i]) * g.v[j];
+            } else {
+                t[i + j - LIMBS] += static_cast<uint128_t>(f.v[i]) * g19[j];
+            }
+        }
+    }
+
+    uint64_t carry = 0;
+    for (int i = 0; i < LIMBS; i++) {
+        t[i] += carry;
+        carry = static_cast<uint64_t>(t[i] >> 51);
+        h.v[i] = static_cast<uint64_t>(t[i]) & MASK51;
+    }
+    h.v[0] += 19 * carry;
+    h.v[1] += h.v[0] >> 51;
+    h.v[0] &= MASK51;
+}
+
+// Reduces to the canonical representative in [0, p)
+static void feReduce(Fe &h)
+{
+    feCarry(h);
+    feCarry(h);
+    // h is now below 2^255; adding 19 carries out of bit 255 exactly when h >= p
+    h.v[0] += 19;
+    feCarry(h);
+    h.v[0] += (1ULL << 51) - 19;
+    for (int i = 1; i < LIMBS; i++) {
+        h.v[i] += (1ULL << 51) - 1;
+    }
+    for (int i = 0; i < LIMBS - 1; i++) {
+        h.v[i + 1] += h.v[i] >> 51;
+        h.v[i] &= MASK51;
+    }
+    h.v[LIMBS - 1] &= MASK51;
+}
+
+static inline void feCmov(Fe &f, const Fe &g, uint8_t b)
+{
+    uint64_t mask = 0 - static_cast<uint64_t>(b);
+    for (int i = 0; i < LIMBS; i++) {
+        f.v[i] ^= (f.v[i] ^ g.v[i]) & mask;
+    }
+}
+
+#else
+
+static const int LIMBS = 10;
+
+struct Fe {
+    int32_t v[LIMBS];
+};
+
+// Limbs alternate between 26 and 25 bits
+static inline int limbBits(int i) { return 26 - (i & 1); }
+
+static inline void feCarry(Fe &h)
+{
+    int32_t carry = 0;
+    for (int i = 0; i < LIMBS; i++) {
+        h.v[i] += carry;
+        carry = h.v[i] >> limbBits(i);
+        h.v[i] -= carry * (1 << limbBits(i));
+    }
+    h.v[0] += 19 * carry;
+}
+
+static inline void feAdd(Fe &h, const Fe &f, const Fe &g)
+{
+    for (int i = 0; i < LIMBS; i++) {
+        h.v[i] = f.v[i] + g.v[i];
+    }
+    feCarry(h);
+}
+
+static inline void feSub(Fe &h, const Fe &f, const Fe &g)
+{
+    for (int i = 0; i < LIMBS; i++) {
+        h.v[i] = f.v[i] - g.v[i];
+    }
+    feCarry(h);
+}
+
+static void feMul(Fe &h, const Fe &f, const Fe &g)
+{
+    // Two odd limbs carry half a bit each, so their product is doubled; products wrapping past
+    // 2^255 fold back multiplied by 19
+    int64_t t[LIMBS] = {};
+    for (int i = 0; i < LIMBS; i++) {
+        for (int j = 0; j < LIMBS; j++) {
+            int64_t product = static_cast<int64_t>(f.v[i]) * g.v[j] * (1 + (i & j & 1));
+            if (i + j < LIMBS) {
+                t[i + j] += product;
+            } else {
+                t[i + j - LIMBS] += 19 * product;
+            }
+        }
+    }
+
+    int64_t carry = 0;
+    for (int i = 0; i < LIMBS; i++) {
+        t[i] += carry;
+        carry = t[i] >> limbBits(i);
+        t[i] -= carry * (1 << limbBits(i));
+    }
+    t[0] += 19 * carry;
+    carry = t[0] >> 26;
+    t[0] -= carry * (1 << 26);
+    t[1] += carry;
+    for (int i = 0; i < LIMBS; i++) {
+        h.v[i] = static_cast<int32_t>(t[i]);
+    }
+}
+
+// Reduces to the canonical representative in [0, p)
+static void feReduce(Fe &h)
+{
+    feCarry(h);
+    // q is 1 exactly when h >= p
+    int32_t q = (19 * h.v[9] + (1 << 24)) >> 25;
+    for (int i = 0; i < LIMBS; i++) {
+        q = (h.v[i] + q) >> limbBits(i);
+    }
+    h.v[0] += 19 * q;
+    for (int i = 0; i < LIMBS - 1; i++) {
+        int32_t carry = h.v[i] >> limbBits(i);
+        h.v[i + 1] += carry;
+        h.v[i] -= carry * (1 << limbBits(i));
+    }
+    h.v[LIMBS - 1] &= (1 << 25) - 1;
+}
+
+static inline void feCmov(Fe &f, const Fe &g, uint8_t b)
+{
+    int32_t mask = -static_cast<int32_t>(b);
+    for (int i = 0; i < LIMBS; i++) {
+        f.v[i] ^= (f.v[i] ^ g.v[i]) & mask;
+    }
+}
+
+#endif
+
+static inline void feZero(Fe &h) { memset(&h, 0, sizeof(h)); }
+
+static inline void feOne(Fe &h)
+{
+    feZero(h);
+    h.v[0] = 1;
+}
+
+static inline void feSq(Fe &h, const Fe &f) { feMul(h, f, f); }
+
+static void feSqN(Fe &h, const Fe &f, int n)
+{
+    feSq(h, f);
+    for (int i = 1; i < n; i++) {
+        feSq(h, h);
+    }
+}
+
+static void feFromBytes(Fe &h, const uint8_t s[32])
+{
+    // The top bit (the sign of x in an encoded point) is ignored
+    uint64_t acc = 0;
+    int bits = 0;
+    int byte = 0;
+    for (int i = 0; i < LIMBS; i++) {
+        int width = limbBits(i);
+        while (bits < width && byte < 32) {
+            acc |= static_cast<uint64_t>(s[byte++]) << bits;
+            bits += 8;
+        }
+        h.v[i] = acc & ((1ULL << width) - 1);
+        acc >>= width;
+        bits -= width;
+    }
+}
+
+static void feToBytes(uint8_t s[32], const Fe &f)
+{
+    Fe h = f;
+    feReduce(h);
+    uint64_t acc = 0;
+    int bits = 0;
+    int byte = 0;
+    for (int i = 0; i < LIMBS; i++) {
+        acc |= static_cast<uint64_t>(h.v[i]) << bits;
+        bits += limbBits(i);
+        while (bits >= 8) {
+            s[byte++] = static_cast<uint8_t>(acc);
+            acc >>= 8;
+            bits -= 8;
+        }
+    }
+    s[byte] = static_cast<uint8_t>(acc);
+}
+
+// z^(p - 2)
+static void feInvert(Fe &out, const Fe &z)
+{
+    Fe t0, t1, t2, t3;
+    feSq(t0, z);              // 2
+    feSqN(t1, t0, 2);         // 8
+    feMul(t1, z, t1);         // 9
+    feMul(t0, t0, t1);        // 11
+    feSq(t2, t0);             // 22
+    feMul(t1, t1, t2);        // 2^5 - 1
+    feSqN(t2, t1, 5);
+    feMul(t1, t2, t1);        // 2^10 - 1
+    feSqN(t2, t1, 10);
+    feMul(t2, t2, t1);        // 2^20 - 1
+    feSqN(t3, t2, 20);
+    feMul(t2, t3, t2);        // 2^40 - 1
+    feSqN(t2, t2, 10);
+    feMul(t1, t2, t1);        // 2^50 - 1
+    feSqN(t2, t1, 50);
+    feMul(t2, t2, t1);        // 2^100 - 1
+    feSqN(t3, t2, 100);
+    feMul(t2, t3, t2);        // 2^200 - 1
+    feSqN(t2, t2, 50);
+    feMul(t1, t2, t1);        // 2^250 - 1
+    feSqN(t1, t1, 5);         // 2^255 - 32
+    feMul(out, t1, t0);       // 2^255 - 21
+}
+
+// Points in extended (X:Y:Z:T), projective (X:Y:Z) and completed ((X:Z),(Y:T)) coordinates, and
+// table entries in affine (y + x, y - x, 2dxy) form
+struct GeP2 {
+    Fe X, Y, Z;
+};
+
+struct GeP3 {
+    Fe X, Y, Z, T;
+};
+
+struct GeP1P1 {
+    Fe X, Y, Z, T;
+};
+
+struct GePrecomp {
+    Fe yplusx, yminusx, xy2d;
+};
+
+static void p1p1ToP2(GeP2 &r, const GeP1P1 &p)
+{
+    feMul(r.X, p.X, p.T);
+    feMul(r.Y, p.Y, p.Z);
+    feMul(r.Z, p.Z, p.T);
+}
+
+static void p1p1ToP3(GeP3 &r, const GeP1P1 &p)
+{
+    feMul(r.X, p.X, p.T);
+    feMul(r.Y, p.Y, p.Z);
+    feMul(r.Z, p.Z, p.T);
+    feMul(r.T, p.X, p.Y);
+}
+
+static void p2Double(GeP1P1 &r, const GeP2 &p)
+{
+    Fe t0;
+    feSq(r.X, p.X);
+    feSq(r.Z, p.Y);
+    feSq(r.T, p.Z);
+    feAdd(r.T, r.T, r.T);
+    feAdd(r.Y, p.X, p.Y);
+    feSq(t0, r.Y);
+    feAdd(r.Y, r.Z, r.X);
+    feSub(r.Z, r.Z, r.X);
+    feSub(r.X, t0, r.Y);
+    feSub(r.T, r.T, r.Z);
+}
+
+static void mixedAdd(GeP1P1 &r, const GeP3 &p, const GePrecomp &q)
+{
+    Fe t0;
+    feAdd(r.X, p.Y, p.X);
+    feSub(r.Y, p.Y, p.X);
+    feMul(r.Z, r.X, q.yplusx);
+    feMul(r.Y, r.Y, q.yminusx);
+    feMul(r.T, q.xy2d, p.T);
+    feAdd(t0, p.Z, p.Z);
+    feSub(r.X, r.Z, r.Y);
+    feAdd(r.Y, r.Z, r.Y);
+    feAdd(r.Z, t0, r.T);
+    feSub(r.T, t0, r.T);
+}
+
+static void encodePoint(uint8_t s[32], const GeP3 &p)
+{
+    Fe recip, x, y;
+    uint8_t xBytes[32];
+    feInvert(recip, p.Z);
+    feMul(x, p.X, recip);
+    feMul(y, p.Y, recip);
+    feToBytes(s, y);
+    feToBytes(xBytes, x);
+    s[31] ^= (xBytes[0] & 1) << 7;
+}
+
+static inline uint8_t equal(uint8_t b, uint8_t c)
+{
+    uint32_t y = static_cast<uint8_t>(b ^ c);
+    y -= 1;
+    return y >> 31;
+}
+
+// Loads |b| * row multiple of B, negated when b < 0, reading every entry of the row
+static void selectEntry(GePrecomp &t, int row, int8_t b)
+{
+    uint8_t negative = static_cast<uint8_t>(b) >> 7;
+    uint8_t babs = b - ((-negative & b) * 2);
+
+    uint8_t entry[96] = {1};
+    entry[32] = 1;
+    for (int j = 0; j < 8; j++) {
+        uint8_t mask = -equal(babs, j + 1);
+        for (int k = 0; k < 96; k++) {
+            entry[k] ^= (entry[k] ^ ED25519_BASE_TABLE[row][j][k]) & mask;
+        }
+    }
+    feFromBytes(t.yplusx, entry);
+    feFromBytes(t.yminusx, entry + 32);
+    feFromBytes(t.xy2d, entry + 64);
+
+    // -(x, y) swaps y + x with y - x and negates 2dxy
+    Fe yplusx = t.yplusx, minusXy2d, zero;
+    feZero(zero);
+    feSub(minusXy2d, zero, t.xy2d);
+    feCmov(t.yplusx, t.yminusx, negative);
+    feCmov(t.yminusx, yplusx, negative);
+    feCmov(t.xy2d, minusXy2d, negative);
+}
+
+// h = a * B for a scalar a < 2^255
+static void scalarMultBase(GeP3 &h, const uint8_t a[32])
+{
+    // Signed radix-16 digits in [-8, 8]
+    int8_t e[64];
+    for (int i = 0; i < 32; i++) {
+        e[2 * i] = a[i] & 15;
+        e[2 * i + 1] = (a[i] >> 4) & 15;
+    }
+    int8_t carry = 0;
+    for (int i = 0; i < 63; i++) {
+        e[i] += carry;
+        carry = (e[i] + 8) >> 4;
+        e[i] -= carry * 16;
+    }
+    e[63] += carry;
+
+    // Row r holds multiples of 16^(passes * r) * B, so digit passes * r + pass is added from row r
+    // and the passes are combined Horner-style with four doublings in between
+    const int passes = 64 / ED25519_BASE_TABLE_ROWS;
+    feZero(h.X);
+    feOne(h.Y);
+    feOne(h.Z);
+    feZero(h.T);
+    GeP1P1 r;
+    GeP2 s;
+    GePrecomp t;
+    for (int pass = passes - 1; pass >= 0; pass--) {
+        if (pass != passes - 1) {
+            s.X = h.X;
+            s.Y = h.Y;
+            s.Z = h.Z;
+            for (int i = 0; i < 3; i++) {
+                p2Double(r, s);
+                p1p1ToP2(s, r);
+            }
+            p2Double(r, s);
+            p1p1ToP3(h, r);
+        }
+        for (int row = 0; row < ED25519_BASE_TABLE_ROWS; row++) {
+            selectEntry(t, row, e[passes * row + pass]);
+            mixedAdd(r, h, t);
+            p1p1ToP3(h, r);
+        }
+    }
+}
+
+// Group order L = 2^252 + 27742317777372353535851937790883648493, little-endian
+static const int64_t ORDER[32] = {0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7,
+                                  0xa2, 0xde, 0xf9, 0xde, 0x14, 0,    0,    0,    0,    0,    0,
+                                  0,    0,    0,    0,    0,    0,    0,    0,    0,    0x10};
+
+// r = x mod L for x given as 64 signed byte-sized digits (TweetNaCl's modL)
+static void reduceModOrder(uint8_t r[32], int64_t x[64])
+{
+    int64_t carry;
+    for (int i = 63; i >= 32; i--) {
+        carry = 0;
+        int j;
+        for (j = i - 32; j < i - 12; j++) {
+            x[j] += carry - 16 * x[i] * ORDER[j - (i - 32)];
+            carry = (x[j] + 128) >> 8;
+            x[j] -= carry * 256;
+        }
+        x[j] += carry;
+        x[i] = 0;
+    }
+    carry = 0;
+    for (int j = 0; j < 32; j++) {
+        x[j] += carry - (x[31] >> 4) * ORDER[j];
+        carry = x[j] >> 8;
+        x[j] &= 255;
+    }
+    for (int j = 0; j < 32; j++) {
+        x[j] -= carry * ORDER[j];
+    }
+    for (int i = 0; i < 32; i++) {
+        x[i + 1] += x[i] >> 8;
+        r[i] = x[i] & 255;
+    }
+}
+
+static void reduceHash(uint8_t r[32], const uint8_t hash[64])
+{
+    int64_t x[64];
+    for (int i = 0; i < 64; i++) {
+        x[i] = hash[i];
+    }
+    reduceModOrder(r, x);
+    clean(x, sizeof(x));
+}
+
+// SHA-512 of the private key, with the scalar half clamped
+static void expandPrivateKey(uint8_t az[64], const uint8_t privateKey[32])
+{
+    SHA512 hash;
+    hash.update(privateKey, 32);
+    hash.finalize(az, 64);
+    az[0] &= 248;
+    az[31] &= 127;
+    az[31] |= 64;
+}
+
+void Ed25519Fast::sign(uint8_t signature[64], const uint8_t privateKey[32], const uint8_t publicKey[32], const void *message,
+                       size_t len)
+{
+    uint8_t az[64];
+    uint8_t digest[64];
+    uint8_t r[32];
+    uint8_t k[32];
+    GeP3 R;
+    expandPrivateKey(az, privateKey);
+
+    // r = H(prefix || M) mod L, R = rB
+    SHA512 hash;
+    hash.update(az + 32, 32);
+    hash.update(message, len);
+    hash.finalize(digest, sizeof(digest));
+    reduceHash(r, digest);
+    scalarMultBase(R, r);
+    encodePoint(signature, R);
+
+    // S = (r + H(R || A || M) * a) mod L
+    hash.reset();
+    hash.update(signature, 32);
+    hash.update(publicKey, 32);
+    hash.update(message, len);
+    hash.finalize(digest, sizeof(digest));
+    reduceHash(k, digest);
+
+    int64_t x[64] = {};
+    for (int i = 0; i < 32; i++) {
+        x[i] = r[i];
+    }
+    for (int i = 0; i < 32; i++) {
+        for (int j = 0; j < 32; j++) {
+            x[i + j] += static_cast<int64_t>(k[i]) * az[j];
+        }
+    }
+    reduceModOrder(signature + 32, x);
+
+    clean(az, sizeof(az));
+    clean(digest, sizeof(digest));
+    clean(r, sizeof(r));
+    clean(x, sizeof(x));
+    clean(&R, sizeof(R));
+}
+
+void Ed25519Fast::derivePublicKey(uint8_t publicKey[32], const uint8_t privateKey[32])
+{
+    uint8_t az[64];
+    GeP3 A;
+    expandPrivateKey(az, privateKey);
+    scalarMultBase(A, az);
+    encodePoint(publicKey, A);
+    clean(az, sizeof(az));
+    clean(&A, sizeof(A));
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Rows of the precomputed fixed-base table: 32 (24 KiB of flash), 16, 8 or 4 (3 KiB). Each halving
+// saves half the table at the cost of more doublings per scalar multiplication.
+#ifndef ED25519_BASE_TABLE_ROWS
+  #define ED25519_BASE_TABLE_ROWS 32
+#endif
+
+// 64-bit targets use a radix-2^51 field (five limbs, 128-bit products); others, e.g. the ESP32,
+// use radix-2^25.5 (ten limbs, 64-bit products).
+#if defined(__SIZEOF_INT128__) && !defined(ED25519_FIELD_32BIT)
+  #define ED25519_FIELD_51 1
+#else
+  #define ED25519_FIELD_51 0
+#endif
+
+/**
+ * RFC 8032 Ed25519 signing with a precomputed fixed-base table.
+ *
+ * A drop-in replacement for rweather's Ed25519::sign and Ed25519::derivePublicKey producing
+ * identical output. The base point multiplication uses signed radix-16 digits added from the table
+ * (64 additions and at most 60 doublings) with constant-time table lookups, instead of a generic
+ * double-and-add over all 255 bits.
+ */
+class Ed25519Fast
+{
+  public:
+    /**
+     * Signs a message.
+     *
+     * @param signature Receives the 64-byte signature.
+     * @param privateKey The 32-byte private key (seed).
+     * @param publicKey The 32-byte public key belonging to privateKey.
+     * @param message The message to sign.
+     * @param len The length of the message.
+     */
+    static void sign(uint8_t signature[64], const uint8_t privateKey[32], const uint8_t publicKey[32], const void *message,
+                     size_t len);
+
+    /**
+     * Derives the public key belonging to a private key.
+     */
+    static void derivePublicKey(uint8_t publicKey[32], const uint8_t privateKey[32]);
+
+  private:
+    Ed25519Fast() = delete;
+};
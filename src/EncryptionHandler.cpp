@@ -1,4 +1,6 @@
 #include "EncryptionHandler.h"
+#include "Arena.h"
+#include "Blake2bBatch.h"
 #include "utils.h"
 #include <memory>
 #include <string>
@@ -26,10 +28,13 @@ String EncryptionHandler::KDAhash(const struct HashVector *test)
     hash.reset(32);
     hash.update(test->data, size);
     hash.finalize(value, sizeof(value));
+    return KDAhash(value);
+}
 
-    auto inputLength = sizeof(value);
-    char output[base64::encodeLength(inputLength)];
-    base64::encode(value, inputLength, output);
+String EncryptionHandler::KDAhash(const uint8_t *hash)
+{
+    char output[base64::encodeLength(HASH_SIZE)];
+    base64::encode(hash, HASH_SIZE, output);
     String hashString = String(output);
     hashString.replace("+", "-");
     hashString.replace("/", "_");
@@ -37,6 +42,24 @@ String EncryptionHandler::KDAhash(const struct HashVector *test)
     return hashString;
 }
 
+void EncryptionHandler::Binhashes(struct HashVector *vectors, size_t count)
+{
+    const uint8_t *messages[BINHASH_BATCH_CHUNK];
+    size_t lengths[BINHASH_BATCH_CHUNK];
+    uint8_t hashes[BINHASH_BATCH_CHUNK][HASH_SIZE];
+    for (size_t start = 0; start < count; start += BINHASH_BATCH_CHUNK) {
+        size_t chunk = count - start < BINHASH_BATCH_CHUNK ? count - start : BINHASH_BATCH_CHUNK;
+        for (size_t i = 0; i < chunk; i++) {
+            messages[i] = reinterpret_cast<const uint8_t *>(vectors[start + i].data);
+            lengths[i] = strlen(vectors[start + i].data);
+        }
+        blake2b256Batch(messages, lengths, chunk, hashes);
+        for (size_t i = 0; i < chunk; i++) {
+            memcpy(vectors[start + i].hash, hashes[i], HASH_SIZE);
+        }
+    }
+}
+
 void EncryptionHandler::HexToBytes(const std::string &hex, char *out)
 {
     for (unsigned int i = 0; i < hex.length(); i += 2) {
@@ -67,7 +90,11 @@ String EncryptionHandler::generateSignature(const std::string &public_key, const
     HexToBytes(private_key, privateKey);
 
     uint8_t signature[64];
-    Ed25519::sign(signature, (uint8_t *)privateKey, (uint8_t *)publicKey, hashBin, HASH_SIZE);
+    if (signature_backend_ == SignatureBackend::FAST) {
+        Ed25519Fast::sign(signature, (uint8_t *)privateKey, (uint8_t *)publicKey, hashBin, HASH_SIZE);
+    } else {
+        Ed25519::sign(signature, (uint8_t *)privateKey, (uint8_t *)publicKey, hashBin, HASH_SIZE);
+    }
 
     // Convert bytes to hex string
     String signHex = "";
@@ -77,10 +104,13 @@ String EncryptionHandler::generateSignature(const std::string &public_key, const
     return signHex;
 }
 
-void EncryptionHandler::add_pkcs7_padding(std::vector<unsigned char> &data, size_t block_size)
+unsigned char *EncryptionHandler::scratch(std::vector<unsigned char> &fallback, size_t size)
 {
-    size_t padding_size = block_size - (data.size() % block_size);
-    data.insert(data.end(), padding_size, static_cast<unsigned char>(padding_size));
+    if (arena_) {
+        return static_cast<unsigned char *>(arena_->allocate(size));
+    }
+    fallback.resize(size);
+    return fallback.data();
 }
 
 void EncryptionHandler::EvpKDF(const unsigned char *password, size_t password_len, const unsigned char *salt, size_t salt_len,
@@ -95,39 +125,48 @@ void EncryptionHandler::EvpKDF(const unsigned char *password, size_t password_le
         return;
     }
 
+    // Derived material and digest blocks live on the stack; MD5/SHA-256 output fits in one block
     size_t block_size = mbedtls_md_get_size(mbedtls_md_info_from_type(md_type));
-    std::vector<unsigned char> block(block_size);
-    std::vector<unsigned char> derivedKey;
+    unsigned char block[MBEDTLS_MD_MAX_SIZE];
+    unsigned char derivedKey[EVP_KDF_MAX_OUTPUT + MBEDTLS_MD_MAX_SIZE];
+    size_t derived_size = 0;
 
     size_t total_size = key_size + iv_size;
+    if (total_size > EVP_KDF_MAX_OUTPUT) {
+        mbedtls_md_free(&md_ctx);
+        fprintf(stderr, "EvpKDF output too large\n");
+        return;
+    }
 
-    while (derivedKey.size() < total_size) {
+    while (derived_size < total_size) {
         mbedtls_md_starts(&md_ctx);
-        if (!derivedKey.empty()) {
-            mbedtls_md_update(&md_ctx, block.data(), block.size());
+        if (derived_size > 0) {
+            mbedtls_md_update(&md_ctx, block, block_size);
         }
         mbedtls_md_update(&md_ctx, password, password_len);
         mbedtls_md_update(&md_ctx, salt, salt_len); // Incorporate salt
-        mbedtls_md_finish(&md_ctx, block.data());   // Finalize the block
+        mbedtls_md_finish(&md_ctx, block);          // Finalize the block
 
         for (int i = 1; i < iterations; i++) {
             mbedtls_md_starts(&md_ctx);
-            mbedtls_md_update(&md_ctx, block.data(), block_size);
-            mbedtls_md_finish(&md_ctx, block.data()); // Correctly finalize the block once per iteration
+            mbedtls_md_update(&md_ctx, block, block_size);
+            mbedtls_md_finish(&md_ctx, block); // Correctly finalize the block once per iteration
         }
 
-        derivedKey.insert(derivedKey.end(), block.begin(), block.end());
+        memcpy(derivedKey + derived_size, block, block_size);
+        derived_size += block_size;
     }
 
     mbedtls_md_free(&md_ctx);
 
-    // Ensure the derivedKey is long enough
-    if (derivedKey.size() > total_size) {
-        derivedKey.resize(total_size);
-    }
+    memcpy(pOutKey, derivedKey, key_size);
+    memcpy(pOutIV, derivedKey + key_size, iv_size);
+}
 
-    memcpy(pOutKey, derivedKey.data(), key_size);
-    memcpy(pOutIV, derivedKey.data() + key_size, iv_size);
+void EncryptionHandler::deriveSecretKey(const unsigned char *symKey, size_t symKeyLength, const unsigned char *salt,
+                                        unsigned char *key, unsigned char *iv)
+{
+    EvpKDF(symKey, symKeyLength, salt, SECRET_SALT_SIZE, key, SECRET_AES_KEY_SIZE, iv, SECRET_IV_SIZE, MBEDTLS_MD_MD5, 1);
 }
 
 String EncryptionHandler::encrypt(const std::string &base64PublicKey, const std::string &payload)
@@ -145,23 +184,36 @@ String EncryptionHandler::encrypt(const std::string &base64PublicKey, const std:
     mbedtls_aes_init(&aes);
     mbedtls_pk_init(&pk);
 
+    auto cleanup = [&]() {
+        mbedtls_aes_free(&aes);
+        mbedtls_pk_free(&pk);
+        mbedtls_ctr_drbg_free(&ctr_drbg);
+        mbedtls_entropy_free(&entropy);
+    };
+
     // Seed the random number generator
     if (mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy, nullptr, 0) != 0) {
         Serial.printf("Failed to initialize RNG\n");
+        cleanup();
         return "";
     }
 
-    // Decode Base64 public key to binary
+    // Decode Base64 public key to a null-terminated PEM buffer, as mbedtls_pk_parse_public_key expects
     size_t decodedKeyLength = base64::decodeLength(base64PublicKey.c_str());
-    std::vector<uint8_t> binaryKey(decodedKeyLength);
-    base64::decode(base64PublicKey.c_str(), binaryKey.data());
-    std::string decodedKey(binaryKey.begin(), binaryKey.end());
+    std::vector<unsigned char> keyFallback;
+    unsigned char *publicKey = scratch(keyFallback, decodedKeyLength + 1);
+    if (!publicKey) {
+        Serial.printf("Out of scratch memory\n");
+        cleanup();
+        return "";
+    }
+    base64::decode(base64PublicKey.c_str(), publicKey);
+    publicKey[decodedKeyLength] = '\0';
 
-    // Convert std::string to const unsigned char*
-    const unsigned char *publicKey = reinterpret_cast<const unsigned char *>(decodedKey.c_str());
-    size_t publicKeyLen = decodedKey.size() + 1;
+    size_t publicKeyLen = decodedKeyLength + 1;
     if (int err = mbedtls_pk_parse_public_key(&pk, publicKey, publicKeyLen) != 0) {
         Serial.printf("Failed to parse public key: -%04x\n", -err);
+        cleanup();
         return "";
     }
 
@@ -173,88 +225,81 @@ String EncryptionHandler::encrypt(const std::string &base64PublicKey, const std:
     mbedtls_ctr_drbg_random(&ctr_drbg, aesKey, sizeof(aesKey));
 
     // Convert symmetric key to hex-encoded string
-    char symKeyHex[33];
+    char symKeyHex[SECRET_SYM_KEY_SIZE];
     for (int i = 0; i < 16; i++) {
         sprintf(&symKeyHex[i * 2], "%02x", aesKey[i]);
     }
     symKeyHex[32] = '\0';
 
     // Encrypt the symmetric key using RSA-OAEP with SHA-256
-    unsigned char buffer[512];
+    unsigned char buffer[SECRET_RSA_MAX_SIZE];
     size_t olen;
     if (mbedtls_rsa_rsaes_oaep_encrypt(rsa, mbedtls_ctr_drbg_random, &ctr_drbg, MBEDTLS_RSA_PUBLIC, nullptr, 0, sizeof(symKeyHex),
                                        reinterpret_cast<const unsigned char *>(symKeyHex), buffer) != 0) {
         Serial.printf("RSA encryption failed\n");
+        cleanup();
         return "";
     }
     olen = mbedtls_rsa_get_len(rsa);
 
     // Generate a random 8-byte salt
-    unsigned char salt[8];
+    unsigned char salt[SECRET_SALT_SIZE];
     mbedtls_ctr_drbg_random(&ctr_drbg, salt, sizeof(salt));
-    unsigned char derivedKey[32], derivedIV[16];
-    std::string symKeyString = std::string(symKeyHex);
-    //LOG_DEBUG("KEY: %s\n", symKeyString.c_str());
+    unsigned char derivedKey[SECRET_AES_KEY_SIZE], derivedIV[SECRET_IV_SIZE];
 
     // IMPORTANT: SymKeyHex must be 33 bytes (counting the null terminator), otherwise key derivation will differ from CryptoJS
-    EvpKDF(reinterpret_cast<const unsigned char *>(symKeyHex), 33, salt, 8, derivedKey, 32, derivedIV, 16, MBEDTLS_MD_MD5, 1);
-
-    std::string saltHex = bytesToHex(salt, 8);
-    //LOG_DEBUG("Salt: %s\n", saltHex.c_str());
-
-    std::string ivHex = bytesToHex(derivedIV, 16);
-    //LOG_DEBUG("Derived IV: %s\n", ivHex.c_str());
-
-    std::string keyHex = bytesToHex(derivedKey, 32);
-    //LOG_DEBUG("Derived KEY: %s\n", keyHex.c_str());
+    deriveSecretKey(reinterpret_cast<const unsigned char *>(symKeyHex), sizeof(symKeyHex), salt, derivedKey, derivedIV);
 
     // Set key length to 256 bits
     mbedtls_aes_setkey_enc(&aes, derivedKey, 256); // Using 256-bit encryption key
 
+    // Lay out "Salted__" + salt + ciphertext in one buffer; the padded payload is staged right after it
+    const char *prefix = SECRET_SALT_PREFIX;
+    size_t paddedSize = (payload.size() / 16 + 1) * 16;
+    size_t combinedSize = 16 + paddedSize;
+    std::vector<unsigned char> dataFallback;
+    unsigned char *combinedData = scratch(dataFallback, combinedSize + paddedSize);
+    if (!combinedData) {
+        Serial.printf("Out of scratch memory\n");
+        cleanup();
+        return "";
+    }
+    unsigned char *paddedPayload = combinedData + combinedSize;
+
     // Add PKCS7 padding to the payload
-    std::vector<unsigned char> paddedPayload(payload.begin(), payload.end());
-    add_pkcs7_padding(paddedPayload, 16);
+    memcpy(paddedPayload, payload.data(), payload.size());
+    memset(paddedPayload + payload.size(), static_cast<int>(paddedSize - payload.size()), paddedSize - payload.size());
 
     // Encrypt the payload using AES-CBC
-    std::vector<unsigned char> encryptedData(paddedPayload.size());
+    memcpy(combinedData, prefix, 8);
+    memcpy(combinedData + 8, salt, sizeof(salt));
     unsigned char derivedIVCopy[16];
     memcpy(derivedIVCopy, derivedIV, sizeof(derivedIVCopy));
-    mbedtls_aes_crypt_cbc(&aes, MBEDTLS_AES_ENCRYPT, paddedPayload.size(), derivedIVCopy, paddedPayload.data(),
-                          encryptedData.data());
-
-    std::string encryptedDataHex = bytesToHex(encryptedData.data(), encryptedData.size());
-    //LOG_DEBUG("Encrypted Data: %s\n", encryptedDataHex.c_str());
+    mbedtls_aes_crypt_cbc(&aes, MBEDTLS_AES_ENCRYPT, paddedSize, derivedIVCopy, paddedPayload, combinedData + 16);
 
-    // Combine prefix, salt and encryptedData
-    std::vector<unsigned char> combinedData;
-    const char *prefix = "Salted__";
-    combinedData.insert(combinedData.end(), prefix, prefix + 8);
-    combinedData.insert(combinedData.end(), salt, salt + sizeof(salt));
-    combinedData.insert(combinedData.end(), encryptedData.begin(), encryptedData.end());
-
-    // Base64 encode the encrypted AES key
+    // Base64 encode the encrypted AES key and the combined data
+    std::vector<unsigned char> base64Fallback;
     size_t encryptedKeyBase64Len = base64::encodeLength(olen);
-    std::vector<char> encryptedKeyBase64(encryptedKeyBase64Len);
-    base64::encode(buffer, olen, encryptedKeyBase64.data());
-
-    // Base64 encode the combined data
-    size_t combinedDataBase64Len = base64::encodeLength(combinedData.size());
-    std::vector<char> combinedDataBase64(combinedDataBase64Len);
-    base64::encode(combinedData.data(), combinedData.size(), combinedDataBase64.data());
-
-    std::string encryptedCombinedDataStr(combinedDataBase64.begin(), combinedDataBase64.end());
-    std::string encryptedKeyStr(encryptedKeyBase64.begin(), encryptedKeyBase64.end());
+    size_t combinedDataBase64Len = base64::encodeLength(combinedSize);
+    char *encryptedKeyBase64 = reinterpret_cast<char *>(scratch(base64Fallback, encryptedKeyBase64Len + combinedDataBase64Len));
+    if (!encryptedKeyBase64) {
+        Serial.printf("Out of scratch memory\n");
+        cleanup();
+        return "";
+    }
+    char *combinedDataBase64 = encryptedKeyBase64 + encryptedKeyBase64Len;
+    base64::encode(buffer, olen, encryptedKeyBase64);
+    base64::encode(combinedData, combinedSize, combinedDataBase64);
 
     // Concatenate the encoded strings with a delimiter
-    String result = String(encryptedCombinedDataStr.c_str()) + ";;;;;" + String(encryptedKeyStr.c_str());
-    //LOG_DEBUG("+++++++++ RESULT OF ENCRYPT!!!:\n");
-    //logLongString(result);
+    String result;
+    result.reserve(strlen(combinedDataBase64) + 5 + strlen(encryptedKeyBase64));
+    result += combinedDataBase64;
+    result += SECRET_SEPARATOR;
+    result += encryptedKeyBase64;
 
     // Cleanup
-    mbedtls_aes_free(&aes);
-    mbedtls_pk_free(&pk);
-    mbedtls_ctr_drbg_free(&ctr_drbg);
-    mbedtls_entropy_free(&entropy);
+    cleanup();
 
     return result;
 }
\ No newline at end of file
@@ -8,12 +8,39 @@
 #include "mbedtls/pkcs5.h"
 
 #include "Ed25519.h"
+#include "Ed25519Fast.h"
 #include "arduino_base64.hpp"
 
 #include <string>
 #include <vector>
 
 #define HASH_SIZE 32
+// Vectors hashed per blake2b256Batch call by Binhashes, bounding its stack use
+#define BINHASH_BATCH_CHUNK 16
+#define EVP_KDF_MAX_OUTPUT 64
+
+// Secret format written by encrypt and read by SecretDecryptor:
+// base64("Salted__" + salt + AES-256-CBC(payload)) + SECRET_SEPARATOR + base64(RSA-OAEP(symmetric key))
+#define SECRET_SEPARATOR ";;;;;"
+#define SECRET_SALT_PREFIX "Salted__"
+#define SECRET_SALT_SIZE 8
+#define SECRET_HEADER_SIZE 16
+#define SECRET_AES_KEY_SIZE 32
+#define SECRET_IV_SIZE 16
+// The hex symmetric key with its null terminator; CryptoJS-compatible derivation hashes all 33 bytes
+#define SECRET_SYM_KEY_SIZE 33
+// Largest RSA modulus handled, in bytes (4096 bits)
+#define SECRET_RSA_MAX_SIZE 512
+
+class Arena;
+
+/**
+ * Ed25519 implementations available to generateSignature. Both produce identical signatures.
+ */
+enum class SignatureBackend : uint8_t {
+    REFERENCE, ///< rweather's Ed25519: no tables, generic double-and-add.
+    FAST,      ///< Ed25519Fast: precomputed base-point table, see ED25519_BASE_TABLE_ROWS.
+};
 
 /**
  * @struct HashVector
@@ -51,6 +78,25 @@ class EncryptionHandler
      */
     String KDAhash(const struct HashVector *test);
 
+    /**
+     * Hashes several HashVectors at once, storing each result in its hash field.
+     *
+     * The messages are hashed in parallel SIMD lanes where the CPU has them (see blake2b256Batch);
+     * each hash equals what Binhash returns for the same data.
+     *
+     * @param vectors The vectors to hash.
+     * @param count The number of vectors.
+     */
+    void Binhashes(struct HashVector *vectors, size_t count);
+
+    /**
+     * Encodes a binary hash as a Kadena hash (unpadded base64url), e.g. one computed by Binhashes.
+     *
+     * @param hash The HASH_SIZE-byte binary hash.
+     * @return A String containing the Kadena hash.
+     */
+    String KDAhash(const uint8_t *hash);
+
     /**
 
      * Converts a hexadecimal string to a byte array.
@@ -83,6 +129,11 @@ class EncryptionHandler
      * @return A String containing the hexadecimal representation of the digital signature.
      */
     String generateSignature(const std::string &public_key, const std::string &private_key, const uint8_t *hashBin);
+
+    /**
+     * Selects the Ed25519 implementation used by generateSignature (FAST by default).
+     */
+    void setSignatureBackend(SignatureBackend backend) { signature_backend_ = backend; }
     /**
      * Encrypts a payload using a given public key.
      *
@@ -96,14 +147,34 @@ class EncryptionHandler
      */
     String encrypt(const std::string &publicKey, const std::string &payload);
 
+    /**
+     * Routes encryption scratch buffers to an arena instead of the heap.
+     *
+     * @param arena The arena to allocate from, or nullptr to use the heap.
+     */
+    void setArena(Arena *arena) { arena_ = arena; }
+
+    /**
+     * Derives the AES key and IV of a secret from its symmetric key and salt, as CryptoJS does.
+     *
+     * @param symKey The symmetric key as carried in the RSA block (SECRET_SYM_KEY_SIZE bytes when written by encrypt).
+     * @param symKeyLength The length of symKey.
+     * @param salt The SECRET_SALT_SIZE-byte salt following "Salted__".
+     * @param key The output SECRET_AES_KEY_SIZE-byte key.
+     * @param iv The output SECRET_IV_SIZE-byte IV.
+     */
+    static void deriveSecretKey(const unsigned char *symKey, size_t symKeyLength, const unsigned char *salt,
+                                unsigned char *key, unsigned char *iv);
+
   private:
     /**
-     * Adds PKCS7 padding to the given data.
+     * Returns scratch memory from the arena when one is attached, otherwise from the fallback vector.
      *
-     * @param data The data to which padding will be added.
-     * @param block_size The block size to use for padding.
+     * @param fallback Heap storage used, and kept alive by the caller, when no arena is attached.
+     * @param size The number of bytes required.
+     * @return A pointer to the scratch memory, or nullptr if the arena is exhausted.
      */
-    void add_pkcs7_padding(std::vector<unsigned char> &data, size_t block_size);
+    unsigned char *scratch(std::vector<unsigned char> &fallback, size_t size);
 
     /**
      * Derives a key and IV using the EVP Key Derivation Function (KDF).
@@ -123,7 +194,10 @@ class EncryptionHandler
      * @param md_type The message digest type to use.
      * @param iterations The number of iterations to use for key derivation.
      */
-    void EvpKDF(const unsigned char *password, size_t password_len, const unsigned char *salt, size_t salt_len,
+    static void EvpKDF(const unsigned char *password, size_t password_len, const unsigned char *salt, size_t salt_len,
                 unsigned char *pOutKey, size_t key_size, unsigned char *pOutIV, size_t iv_size, mbedtls_md_type_t md_type,
                 int iterations);
+
+    Arena *arena_ = nullptr;
+    SignatureBackend signature_backend_ = SignatureBackend::FAST;
 };
\ No newline at end of file
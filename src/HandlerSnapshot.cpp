@@ -0,0 +1,101 @@
+#include "HandlerSnapshot.h"
+#include "BLAKE2b.h"
+#include <cstring>
+
+// Magic, version, flags, chain, key tag, saved at, clock offset, height, due time and director key length
+static const size_t FIXED_SIZE = 4 + 1 + 1 + 1 + HANDLER_SNAPSHOT_TAG_SIZE + 4 + 4 + 4 + 4 + 2;
+static const size_t CHECKSUM_SIZE = 8;
+
+static const uint8_t FLAG_CLOCK_OFFSET = 0x01;
+static const uint8_t FLAG_DUE_READY = 0x02;
+
+static void checksum(const uint8_t *data, size_t length, uint8_t out[CHECKSUM_SIZE])
+{
+    BLAKE2b hash;
+    hash.reset(CHECKSUM_SIZE);
+    hash.update(data, length);
+    hash.finalize(out, CHECKSUM_SIZE);
+}
+
+static uint8_t *writeInteger(uint8_t *p, uint32_t value, int size)
+{
+    for (int i = 0; i < size; i++) {
+        *p++ = static_cast<uint8_t>(value >> (8 * i));
+    }
+    return p;
+}
+
+static uint32_t readInteger(const uint8_t *&p, int size)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < size; i++) {
+        value |= static_cast<uint32_t>(*p++) << (8 * i);
+    }
+    return value;
+}
+
+void handlerSnapshotKeyTag(const std::string &public_key, uint8_t tag[HANDLER_SNAPSHOT_TAG_SIZE])
+{
+    BLAKE2b hash;
+    hash.reset(HANDLER_SNAPSHOT_TAG_SIZE);
+    hash.update(public_key.data(), public_key.size());
+    hash.finalize(tag, HANDLER_SNAPSHOT_TAG_SIZE);
+}
+
+size_t encodeHandlerSnapshot(const HandlerSnapshot &snapshot, uint8_t *out, size_t capacity)
+{
+    size_t length = FIXED_SIZE + snapshot.directorKey.size() + CHECKSUM_SIZE;
+    if (length > capacity || snapshot.directorKey.size() > 0xffff) {
+        return 0;
+    }
+
+    uint8_t *p = out;
+    memcpy(p, HANDLER_SNAPSHOT_MAGIC, 4);
+    p += 4;
+    p = writeInteger(p, HANDLER_SNAPSHOT_VERSION, 1);
+    p = writeInteger(p, (snapshot.hasClockOffset ? FLAG_CLOCK_OFFSET : 0) | (snapshot.dueReady ? FLAG_DUE_READY : 0), 1);
+    p = writeInteger(p, snapshot.chainId, 1);
+    memcpy(p, snapshot.keyTag, HANDLER_SNAPSHOT_TAG_SIZE);
+    p += HANDLER_SNAPSHOT_TAG_SIZE;
+    p = writeInteger(p, snapshot.savedAt, 4);
+    p = writeInteger(p, static_cast<uint32_t>(snapshot.clockOffsetSeconds), 4);
+    p = writeInteger(p, snapshot.chainHeight, 4);
+    p = writeInteger(p, snapshot.dueAt, 4);
+    p = writeInteger(p, snapshot.directorKey.size(), 2);
+    memcpy(p, snapshot.directorKey.data(), snapshot.directorKey.size());
+    p += snapshot.directorKey.size();
+    checksum(out, p - out, p);
+    return length;
+}
+
+bool decodeHandlerSnapshot(const uint8_t *data, size_t length, HandlerSnapshot &snapshot)
+{
+    if (length < FIXED_SIZE + CHECKSUM_SIZE || memcmp(data, HANDLER_SNAPSHOT_MAGIC, 4) != 0 ||
+        data[4] != HANDLER_SNAPSHOT_VERSION) {
+        return false;
+    }
+    size_t keyLength = data[FIXED_SIZE - 2] | (data[FIXED_SIZE - 1] << 8);
+    if (length != FIXED_SIZE + keyLength + CHECKSUM_SIZE) {
+        return false;
+    }
+    uint8_t expected[CHECKSUM_SIZE];
+    checksum(data, length - CHECKSUM_SIZE, expected);
+    if (memcmp(expected, data + length - CHECKSUM_SIZE, CHECKSUM_SIZE) != 0) {
+        return false;
+    }
+
+    const uint8_t *p = data + 5;
+    uint8_t flags = readInteger(p, 1);
+    snapshot.hasClockOffset = flags & FLAG_CLOCK_OFFSET;
+    snapshot.dueReady = flags & FLAG_DUE_READY;
+    snapshot.chainId = readInteger(p, 1);
+    memcpy(snapshot.keyTag, p, HANDLER_SNAPSHOT_TAG_SIZE);
+    p += HANDLER_SNAPSHOT_TAG_SIZE;
+    snapshot.savedAt = readInteger(p, 4);
+    snapshot.clockOffsetSeconds = static_cast<int32_t>(readInteger(p, 4));
+    snapshot.chainHeight = readInteger(p, 4);
+    snapshot.dueAt = readInteger(p, 4);
+    p += 2;
+    snapshot.directorKey.assign(reinterpret_cast<const char *>(p), keyLength);
+    return true;
+}
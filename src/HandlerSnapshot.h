@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#define HANDLER_SNAPSHOT_MAGIC "KDSS"
+#define HANDLER_SNAPSHOT_VERSION 3
+
+// Fits a 2048-bit director key (base64 PEM, about 570 bytes); small enough for RTC slow memory
+// (RTC_DATA_ATTR) on the ESP32
+#define HANDLER_SNAPSHOT_MAX_SIZE 1024
+
+#define HANDLER_SNAPSHOT_TAG_SIZE 8
+
+// Older snapshots are ignored on restore; a long sleep is better served by a fresh sync
+#define HANDLER_SNAPSHOT_MAX_AGE_S 86400
+
+/**
+ * @struct HandlerSnapshot
+ * @brief BlockchainHandler state worth keeping across deep sleep.
+ *
+ * Secrets are deliberately left out: the private key stays wherever the application keeps it
+ * (decoding it costs microseconds), and no DRBG state is saved because restoring the same state
+ * twice, e.g. after a crash before the next save, would repeat "random" AES keys and salts.
+ */
+struct HandlerSnapshot {
+    uint8_t keyTag[HANDLER_SNAPSHOT_TAG_SIZE] = {}; ///< Identifies the public key the state belongs to.
+    uint8_t chainId = 0;
+    uint32_t savedAt = 0;                           ///< Local Unix time of the save.
+    bool hasClockOffset = false;
+    int32_t clockOffsetSeconds = 0;                 ///< Chain time minus local time.
+    uint32_t chainHeight = 0;                       ///< Latest known height of the chain.
+    bool dueReady = false;                          ///< The last get-my-node answered READY, no beacon since.
+    uint32_t dueAt = 0;                             ///< Local Unix time the node is due again, or 0 if unknown.
+    std::string directorKey;                        ///< Cached director public key (base64), may be empty.
+};
+
+/**
+ * Computes the tag binding a snapshot to a public key (a truncated BLAKE2b of the key).
+ */
+void handlerSnapshotKeyTag(const std::string &public_key, uint8_t tag[HANDLER_SNAPSHOT_TAG_SIZE]);
+
+/**
+ * Serializes a snapshot: magic, version, little-endian fields and a trailing BLAKE2b checksum.
+ *
+ * @return The encoded length, or 0 if it does not fit in capacity.
+ */
+size_t encodeHandlerSnapshot(const HandlerSnapshot &snapshot, uint8_t *out, size_t capacity);
+
+/**
+ * Parses a snapshot, rejecting other versions and anything corrupted, truncated or uninitialized
+ * (as RTC memory is after a power loss).
+ */
+bool decodeHandlerSnapshot(const uint8_t *data, size_t length, HandlerSnapshot &snapshot);
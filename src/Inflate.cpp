@@ -0,0 +1,362 @@
+#include "Inflate.h"
+#include <cstring>
+
+// Base lengths and extra bits for length symbols 257..285 (RFC 1951 section 3.2.5)
+static const uint16_t LENGTH_BASE[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                         31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+// Base distances and extra bits for distance symbols 0..29
+static const uint16_t DISTANCE_BASE[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                           193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Order in which code length code lengths are transmitted
+static const uint8_t CODE_LENGTH_ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+Inflater::Inflater(const uint8_t *input, size_t length, uint8_t *window, size_t window_size)
+    : input_(input)
+    , length_(length)
+    , window_(window)
+    , window_mask_(window_size - 1)
+{
+    if (!window || window_size == 0 || (window_size & window_mask_) != 0) {
+        state_ = State::ERROR;
+    }
+}
+
+int Inflater::nextByte()
+{
+    return position_ < length_ ? input_[position_++] : -1;
+}
+
+int Inflater::bits(int need)
+{
+    while (bit_count_ < need) {
+        int byte = nextByte();
+        if (byte < 0) {
+            state_ = State::ERROR;
+            return -1;
+        }
+        bit_buffer_ |= static_cast<uint32_t>(byte) << bit_count_;
+        bit_count_ += 8;
+    }
+    int value = bit_buffer_ & ((1u << need) - 1);
+    bit_buffer_ >>= need;
+    bit_count_ -= need;
+    return value;
+}
+
+uint8_t Inflater::emit(uint8_t byte)
+{
+    window_[total_out_ & window_mask_] = byte;
+    total_out_++;
+    return byte;
+}
+
+bool Inflater::readStreamHeader()
+{
+    if (length_ >= 10 && input_[0] == 0x1f && input_[1] == 0x8b) {
+        // gzip: ID1 ID2 CM FLG MTIME(4) XFL OS, then optional fields selected by FLG
+        if (input_[2] != 8) {
+            return false;
+        }
+        uint8_t flags = input_[3];
+        position_ = 10;
+        if (flags & 0x04) { // FEXTRA
+            if (position_ + 2 > length_) {
+                return false;
+            }
+            position_ += 2 + (input_[position_] | (input_[position_ + 1] << 8));
+        }
+        static const uint8_t terminatedFields[] = {0x08, 0x10}; // FNAME, FCOMMENT: null-terminated
+        for (uint8_t flag : terminatedFields) {
+            if (flags & flag) {
+                while (position_ < length_ && input_[position_] != 0) {
+                    position_++;
+                }
+                position_++;
+            }
+        }
+        if (flags & 0x02) { // FHCRC
+            position_ += 2;
+        }
+        return position_ <= length_;
+    }
+
+    if (length_ >= 2 && (input_[0] & 0x0f) == 8 && ((input_[0] << 8) | input_[1]) % 31 == 0) {
+        // zlib: CMF FLG; preset dictionaries are not used over HTTP
+        if (input_[1] & 0x20) {
+            return false;
+        }
+        position_ = 2;
+        return true;
+    }
+
+    // Anything else is treated as a raw DEFLATE stream
+    position_ = 0;
+    return true;
+}
+
+int Inflater::buildHuffman(Huffman &huffman, const uint8_t *lengths, int n)
+{
+    uint16_t offsets[16];
+    memset(huffman.count, 0, sizeof(huffman.count));
+    for (int symbol = 0; symbol < n; symbol++) {
+        huffman.count[lengths[symbol]]++;
+    }
+    if (huffman.count[0] == n) {
+        return 0;
+    }
+
+    // Reject over-subscribed code sets; incomplete ones are allowed as RFC 1951 permits a single distance code
+    int left = 1;
+    for (int length = 1; length < 16; length++) {
+        left <<= 1;
+        left -= huffman.count[length];
+        if (left < 0) {
+            return left;
+        }
+    }
+
+    offsets[1] = 0;
+    for (int length = 1; length < 15; length++) {
+        offsets[length + 1] = offsets[length] + huffman.count[length];
+    }
+    for (int symbol = 0; symbol < n; symbol++) {
+        if (lengths[symbol] != 0) {
+            huffman.symbol[offsets[lengths[symbol]]++] = symbol;
+        }
+    }
+    return left;
+}
+
+int Inflater::decode(const Huffman &huffman)
+{
+    // Canonical decoding one bit at a time: codes of each length are consecutive integers
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (int length = 1; length < 16; length++) {
+        int bit = bits(1);
+        if (bit < 0) {
+            return -1;
+        }
+        code |= bit;
+        int count = huffman.count[length];
+        if (code - count < first) {
+            return huffman.symbol[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+bool Inflater::buildDynamicTables()
+{
+    uint8_t lengths[320];
+    int literal_count = bits(5) + 257;
+    int distance_count = bits(5) + 1;
+    int code_length_count = bits(4) + 4;
+    if (state_ == State::ERROR || literal_count > 286 || distance_count > 30) {
+        return false;
+    }
+
+    memset(lengths, 0, 19);
+    for (int i = 0; i < code_length_count; i++) {
+        int length = bits(3);
+        if (length < 0) {
+            return false;
+        }
+        lengths[CODE_LENGTH_ORDER[i]] = length;
+    }
+    if (buildHuffman(length_code_, lengths, 19) != 0) {
+        return false;
+    }
+
+    int index = 0;
+    while (index < literal_count + distance_count) {
+        int symbol = decode(length_code_);
+        if (symbol < 0) {
+            return false;
+        }
+        if (symbol < 16) {
+            lengths[index++] = symbol;
+            continue;
+        }
+        int length = 0;
+        int repeat;
+        if (symbol == 16) {
+            if (index == 0) {
+                return false;
+            }
+            length = lengths[index - 1];
+            repeat = 3 + bits(2);
+        } else if (symbol == 17) {
+            repeat = 3 + bits(3);
+        } else {
+            repeat = 11 + bits(7);
+        }
+        if (state_ == State::ERROR || index + repeat > literal_count + distance_count) {
+            return false;
+        }
+        while (repeat--) {
+            lengths[index++] = length;
+        }
+    }
+
+    // The end-of-block code must be present
+    if (lengths[256] == 0) {
+        return false;
+    }
+    int left = buildHuffman(length_code_, lengths, literal_count);
+    if (left < 0 || (left > 0 && literal_count - length_code_.count[0] != 1)) {
+        return false;
+    }
+    left = buildHuffman(distance_code_, lengths + literal_count, distance_count);
+    return !(left < 0 || (left > 0 && distance_count - distance_code_.count[0] != 1));
+}
+
+bool Inflater::readBlockHeader()
+{
+    last_block_ = bits(1) == 1;
+    int type = bits(2);
+    if (state_ == State::ERROR) {
+        return false;
+    }
+
+    if (type == 0) {
+        // Stored block: skip to a byte boundary, then LEN and its complement
+        bit_buffer_ = 0;
+        bit_count_ = 0;
+        if (position_ + 4 > length_) {
+            return false;
+        }
+        uint16_t len = input_[position_] | (input_[position_ + 1] << 8);
+        uint16_t nlen = input_[position_ + 2] | (input_[position_ + 3] << 8);
+        position_ += 4;
+        if (len != static_cast<uint16_t>(~nlen)) {
+            return false;
+        }
+        stored_remaining_ = len;
+        state_ = State::STORED;
+        return true;
+    }
+
+    if (type == 1) {
+        uint8_t lengths[288 + 30];
+        memset(lengths, 8, 144);
+        memset(lengths + 144, 9, 112);
+        memset(lengths + 256, 7, 24);
+        memset(lengths + 280, 8, 8);
+        buildHuffman(length_code_, lengths, 288);
+        memset(lengths, 5, 30);
+        buildHuffman(distance_code_, lengths, 30);
+        state_ = State::HUFFMAN;
+        return true;
+    }
+
+    if (type == 2 && buildDynamicTables()) {
+        state_ = State::HUFFMAN;
+        return true;
+    }
+    return false;
+}
+
+int Inflater::read()
+{
+    while (true) {
+        if (copy_remaining_ > 0) {
+            copy_remaining_--;
+            return emit(window_[(total_out_ - copy_distance_) & window_mask_]);
+        }
+
+        switch (state_) {
+        case State::HEADER:
+            if (!readStreamHeader()) {
+                state_ = State::ERROR;
+                return -1;
+            }
+            state_ = State::BLOCK_HEADER;
+            break;
+
+        case State::BLOCK_HEADER:
+            if (!readBlockHeader()) {
+                state_ = State::ERROR;
+                return -1;
+            }
+            break;
+
+        case State::STORED: {
+            if (stored_remaining_ == 0) {
+                state_ = last_block_ ? State::DONE : State::BLOCK_HEADER;
+                break;
+            }
+            int byte = nextByte();
+            if (byte < 0) {
+                state_ = State::ERROR;
+                return -1;
+            }
+            stored_remaining_--;
+            return emit(byte);
+        }
+
+        case State::HUFFMAN: {
+            int symbol = decode(length_code_);
+            if (symbol < 0) {
+                state_ = State::ERROR;
+                return -1;
+            }
+            if (symbol < 256) {
+                return emit(symbol);
+            }
+            if (symbol == 256) {
+                state_ = last_block_ ? State::DONE : State::BLOCK_HEADER;
+                break;
+            }
+
+            symbol -= 257;
+            if (symbol >= 29) {
+                state_ = State::ERROR;
+                return -1;
+            }
+            int length = LENGTH_BASE[symbol] + bits(LENGTH_EXTRA[symbol]);
+            int distance_symbol = decode(distance_code_);
+            if (distance_symbol < 0 || distance_symbol >= 30) {
+                state_ = State::ERROR;
+                return -1;
+            }
+            size_t distance = DISTANCE_BASE[distance_symbol] + bits(DISTANCE_EXTRA[distance_symbol]);
+            if (state_ == State::ERROR || distance > total_out_ || distance > window_mask_ + 1) {
+                window_exceeded_ = state_ != State::ERROR && distance <= total_out_;
+                state_ = State::ERROR;
+                return -1;
+            }
+            copy_remaining_ = length;
+            copy_distance_ = distance;
+            break;
+        }
+
+        case State::DONE:
+        case State::ERROR:
+        default:
+            return -1;
+        }
+    }
+}
+
+size_t Inflater::readBytes(char *buffer, size_t length)
+{
+    size_t count = 0;
+    while (count < length) {
+        int byte = read();
+        if (byte < 0) {
+            break;
+        }
+        buffer[count++] = static_cast<char>(byte);
+    }
+    return count;
+}
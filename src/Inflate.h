@@ -0,0 +1,93 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// History kept for back-references. Must be a power of two; a stream referring further back
+// than this fails with an error instead of producing corrupt output.
+#ifndef INFLATE_WINDOW_SIZE
+#define INFLATE_WINDOW_SIZE 4096
+#endif
+
+/**
+ * Streaming DEFLATE decoder for gzip (RFC 1952), zlib (RFC 1950) and raw (RFC 1951) data.
+ *
+ * Output is produced one byte at a time on demand, so the decoder can be handed straight to
+ * deserializeJson() as a custom reader and the inflated document is never materialised.
+ * Memory use is fixed: the caller-provided window plus about 1.2 KiB of Huffman tables.
+ */
+class Inflater
+{
+  public:
+    /**
+     * @param input The compressed data. Must outlive the decoder.
+     * @param length The size of the compressed data in bytes.
+     * @param window History buffer of window_size bytes.
+     * @param window_size The size of the window, a power of two.
+     */
+    Inflater(const uint8_t *input, size_t length, uint8_t *window, size_t window_size);
+
+    /**
+     * Returns the next decompressed byte, or -1 at the end of the stream or on error.
+     */
+    int read();
+
+    /**
+     * Reads up to length decompressed bytes into buffer.
+     *
+     * @return The number of bytes read.
+     */
+    size_t readBytes(char *buffer, size_t length);
+
+    /**
+     * Returns true if the stream was malformed or used an unsupported feature.
+     */
+    bool error() const { return state_ == State::ERROR; }
+
+    /**
+     * Returns true if the stream failed only because a back-reference reached further than the
+     * window; the data is valid DEFLATE and decodes with a larger window (up to 32 KiB).
+     */
+    bool windowExceeded() const { return window_exceeded_; }
+
+    /**
+     * Returns the number of decompressed bytes produced so far.
+     */
+    size_t totalOut() const { return total_out_; }
+
+  private:
+    enum class State : uint8_t { HEADER, BLOCK_HEADER, STORED, HUFFMAN, DONE, ERROR };
+
+    struct Huffman {
+        uint16_t count[16];  ///< Number of codes of each length.
+        uint16_t symbol[288]; ///< Symbols ordered by code.
+    };
+
+    bool readStreamHeader();
+    bool readBlockHeader();
+    bool buildDynamicTables();
+    static int buildHuffman(Huffman &huffman, const uint8_t *lengths, int n);
+    int decode(const Huffman &huffman);
+    int bits(int need);
+    int nextByte();
+    uint8_t emit(uint8_t byte);
+
+    const uint8_t *input_;
+    size_t length_;
+    size_t position_ = 0;
+    uint32_t bit_buffer_ = 0;
+    int bit_count_ = 0;
+
+    uint8_t *window_;
+    size_t window_mask_;
+    size_t total_out_ = 0;
+
+    State state_ = State::HEADER;
+    bool window_exceeded_ = false;
+    bool last_block_ = false;
+    size_t stored_remaining_ = 0;
+    size_t copy_remaining_ = 0;
+    size_t copy_distance_ = 0;
+
+    Huffman length_code_;
+    Huffman distance_code_;
+};
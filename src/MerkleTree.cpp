@@ -0,0 +1,187 @@
+#include "MerkleTree.h"
+#include "Blake2bBatch.h"
+#include <cstring>
+
+// Interior nodes hashed per blake2b256Batch call, bounding the scratch buffer
+static const size_t PAIR_CHUNK = 16;
+static const size_t PAIR_SIZE = 1 + 2 * MERKLE_HASH_SIZE;
+
+static void hashPair(const uint8_t left[MERKLE_HASH_SIZE], const uint8_t right[MERKLE_HASH_SIZE],
+                     uint8_t out[MERKLE_HASH_SIZE])
+{
+    uint8_t pair[PAIR_SIZE];
+    pair[0] = MERKLE_NODE_TAG;
+    memcpy(pair + 1, left, MERKLE_HASH_SIZE);
+    memcpy(pair + 1 + MERKLE_HASH_SIZE, right, MERKLE_HASH_SIZE);
+    const uint8_t *message = pair;
+    size_t length = sizeof(pair);
+    blake2b256Batch(&message, &length, 1, reinterpret_cast<uint8_t(*)[32]>(out));
+}
+
+void MerkleTree::reserve(size_t leaf_count)
+{
+    if (levels_.empty()) {
+        levels_.emplace_back();
+    }
+    levels_[0].reserve(leaf_count * MERKLE_HASH_SIZE);
+}
+
+void MerkleTree::append(const uint8_t hashes[][MERKLE_HASH_SIZE], size_t count)
+{
+    if (levels_.empty()) {
+        levels_.emplace_back();
+    }
+    const uint8_t *data = hashes[0];
+    levels_[0].insert(levels_[0].end(), data, data + count * MERKLE_HASH_SIZE);
+}
+
+void MerkleTree::appendData(const uint8_t *const messages[], const size_t lengths[], size_t count)
+{
+    if (levels_.empty()) {
+        levels_.emplace_back();
+    }
+    std::vector<uint8_t> &leaves = levels_[0];
+    size_t start = leaves.size();
+    leaves.resize(start + count * MERKLE_HASH_SIZE);
+    blake2b256Batch(messages, lengths, count, reinterpret_cast<uint8_t(*)[32]>(&leaves[start]));
+}
+
+const uint8_t *MerkleTree::root()
+{
+    update();
+    if (leafCount() == 0) {
+        return nullptr;
+    }
+    return levels_[height_ - 1].data();
+}
+
+void MerkleTree::update()
+{
+    size_t leaves = leafCount();
+    if (leaves == clean_leaves_) {
+        return;
+    }
+
+    const uint8_t *messages[PAIR_CHUNK];
+    size_t lengths[PAIR_CHUNK];
+    uint8_t scratch[PAIR_CHUNK][PAIR_SIZE];
+    for (size_t i = 0; i < PAIR_CHUNK; i++) {
+        messages[i] = scratch[i];
+        lengths[i] = PAIR_SIZE;
+        scratch[i][0] = MERKLE_NODE_TAG;
+    }
+
+    // Only parents of nodes from index dirty onwards change; a carried-up odd node gets its partner
+    size_t dirty = clean_leaves_;
+    size_t level = 0;
+    for (size_t count = leaves; count > 1; count = (count + 1) / 2, level++) {
+        if (levels_.size() <= level + 1) {
+            levels_.emplace_back();
+        }
+        const std::vector<uint8_t> &children = levels_[level];
+        std::vector<uint8_t> &parents = levels_[level + 1];
+        size_t pairs = count / 2;
+        parents.resize((count + 1) / 2 * MERKLE_HASH_SIZE);
+
+        for (size_t first = dirty / 2; first < pairs; first += PAIR_CHUNK) {
+            size_t chunk = pairs - first < PAIR_CHUNK ? pairs - first : PAIR_CHUNK;
+            for (size_t i = 0; i < chunk; i++) {
+                memcpy(scratch[i] + 1, &children[(first + i) * 2 * MERKLE_HASH_SIZE], 2 * MERKLE_HASH_SIZE);
+            }
+            blake2b256Batch(messages, lengths, chunk,
+                            reinterpret_cast<uint8_t(*)[32]>(&parents[first * MERKLE_HASH_SIZE]));
+        }
+        if (count % 2 == 1) {
+            memcpy(&parents[pairs * MERKLE_HASH_SIZE], &children[(count - 1) * MERKLE_HASH_SIZE], MERKLE_HASH_SIZE);
+        }
+        dirty /= 2;
+    }
+    height_ = level + 1;
+    clean_leaves_ = leaves;
+}
+
+bool MerkleTree::proof(size_t index, MerkleProof &proof)
+{
+    update();
+    size_t leaves = leafCount();
+    if (index >= leaves) {
+        return false;
+    }
+    proof.index = index;
+    proof.leafCount = leaves;
+    proof.depth = 0;
+    for (size_t level = 0; level + 1 < height_; level++, index /= 2) {
+        size_t sibling = index ^ 1;
+        if (sibling < levels_[level].size() / MERKLE_HASH_SIZE) {
+            memcpy(proof.siblings[proof.depth++], &levels_[level][sibling * MERKLE_HASH_SIZE], MERKLE_HASH_SIZE);
+        }
+    }
+    return true;
+}
+
+void MerkleTree::clear()
+{
+    for (std::vector<uint8_t> &level : levels_) {
+        level.clear();
+    }
+    height_ = 0;
+    clean_leaves_ = 0;
+}
+
+bool MerkleTree::verify(const uint8_t leaf[MERKLE_HASH_SIZE], const MerkleProof &proof,
+                        const uint8_t root[MERKLE_HASH_SIZE])
+{
+    if (proof.index >= proof.leafCount || proof.depth > MERKLE_MAX_DEPTH) {
+        return false;
+    }
+    uint8_t hash[MERKLE_HASH_SIZE];
+    memcpy(hash, leaf, MERKLE_HASH_SIZE);
+    uint8_t used = 0;
+    size_t index = proof.index;
+    for (size_t count = proof.leafCount; count > 1; count = (count + 1) / 2, index /= 2) {
+        if ((index ^ 1) >= count) {
+            continue;
+        }
+        if (used >= proof.depth) {
+            return false;
+        }
+        if (index & 1) {
+            hashPair(proof.siblings[used], hash, hash);
+        } else {
+            hashPair(hash, proof.siblings[used], hash);
+        }
+        used++;
+    }
+    return used == proof.depth && memcmp(hash, root, MERKLE_HASH_SIZE) == 0;
+}
+
+size_t MerkleProof::encode(uint8_t *out, size_t capacity) const
+{
+    size_t length = 9 + static_cast<size_t>(depth) * MERKLE_HASH_SIZE;
+    if (length > capacity || depth > MERKLE_MAX_DEPTH) {
+        return 0;
+    }
+    for (int i = 0; i < 4; i++) {
+        out[i] = static_cast<uint8_t>(index >> (8 * i));
+        out[4 + i] = static_cast<uint8_t>(leafCount >> (8 * i));
+    }
+    out[8] = depth;
+    memcpy(out + 9, siblings, depth * MERKLE_HASH_SIZE);
+    return length;
+}
+
+bool MerkleProof::decode(const uint8_t *data, size_t length)
+{
+    if (length < 9 || data[8] > MERKLE_MAX_DEPTH || length != 9 + static_cast<size_t>(data[8]) * MERKLE_HASH_SIZE) {
+        return false;
+    }
+    index = 0;
+    leafCount = 0;
+    for (int i = 0; i < 4; i++) {
+        index |= static_cast<uint32_t>(data[i]) << (8 * i);
+        leafCount |= static_cast<uint32_t>(data[4 + i]) << (8 * i);
+    }
+    depth = data[8];
+    memcpy(siblings, data + 9, depth * MERKLE_HASH_SIZE);
+    return true;
+}
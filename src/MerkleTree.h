@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define MERKLE_HASH_SIZE 32
+
+// Enough for 2^32 leaves
+#define MERKLE_MAX_DEPTH 32
+
+// Domain tags: leaf data starts with MERKLE_LEAF_TAG and interior nodes hash MERKLE_NODE_TAG || left || right,
+// so a leaf can never be passed off as an interior node
+#define MERKLE_LEAF_TAG 0x00
+#define MERKLE_NODE_TAG 0x01
+
+/**
+ * @struct MerkleProof
+ * @brief The sibling hashes linking one leaf to the root.
+ */
+struct MerkleProof {
+    uint32_t index = 0;     ///< Position of the leaf.
+    uint32_t leafCount = 0; ///< Leaves in the tree, which fixes where levels have no sibling.
+    uint8_t depth = 0;      ///< Siblings used.
+    uint8_t siblings[MERKLE_MAX_DEPTH][MERKLE_HASH_SIZE]; ///< Siblings from the leaf level upwards.
+
+    /**
+     * Serializes the proof: index, leaf count (little-endian), depth and the siblings.
+     *
+     * @return The encoded length, or 0 if it does not fit in capacity.
+     */
+    size_t encode(uint8_t *out, size_t capacity) const;
+
+    /**
+     * Parses a proof written by encode.
+     */
+    bool decode(const uint8_t *data, size_t length);
+};
+
+/**
+ * A BLAKE2b-256 Merkle tree built by appending leaf hashes.
+ *
+ * Each level is one contiguous array of hashes. An odd node at the end of a level is carried up
+ * unchanged rather than paired with itself. Appending only marks the tree dirty; root() and
+ * proof() then rehash just the parents of new nodes, one level at a time, handing every pair
+ * of a level to blake2b256Batch at once. Building a tree of n leaves costs n - 1 compressions
+ * in total, however it is split into appends.
+ */
+class MerkleTree
+{
+  public:
+    /**
+     * Reserves room for leaf_count leaves, avoiding reallocation while appending.
+     */
+    void reserve(size_t leaf_count);
+
+    /**
+     * Appends leaves given as hashes of data starting with MERKLE_LEAF_TAG.
+     */
+    void append(const uint8_t hashes[][MERKLE_HASH_SIZE], size_t count);
+
+    /**
+     * Hashes leaf data in BLAKE2b lanes and appends the results.
+     *
+     * Each message must start with MERKLE_LEAF_TAG.
+     */
+    void appendData(const uint8_t *const messages[], const size_t lengths[], size_t count);
+
+    size_t leafCount() const { return levels_.empty() ? 0 : levels_[0].size() / MERKLE_HASH_SIZE; }
+
+    /**
+     * Returns the root, or nullptr for an empty tree. Valid until the next append or clear.
+     */
+    const uint8_t *root();
+
+    /**
+     * Fills the inclusion proof of a leaf.
+     *
+     * @return False if index is out of range.
+     */
+    bool proof(size_t index, MerkleProof &proof);
+
+    /**
+     * Removes every leaf, keeping the allocated memory for the next tree.
+     */
+    void clear();
+
+    /**
+     * Checks that a leaf hash and a proof lead to a root.
+     */
+    static bool verify(const uint8_t leaf[MERKLE_HASH_SIZE], const MerkleProof &proof,
+                       const uint8_t root[MERKLE_HASH_SIZE]);
+
+  private:
+    void update();
+
+    // levels_[0] holds the leaves and levels_[height_ - 1] the root; levels above are spare capacity
+    std::vector<std::vector<uint8_t>> levels_;
+    size_t height_ = 0;
+    // Leaves already reflected in the upper levels
+    size_t clean_leaves_ = 0;
+};
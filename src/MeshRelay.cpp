@@ -0,0 +1,317 @@
+#include "MeshRelay.h"
+#include "arduino_base64.hpp"
+#include <cstring>
+#include <string>
+
+// Separator EncryptionHandler::encrypt places between the ciphertext and the encrypted key
+static const char ENCRYPTED_SEPARATOR[] = ";;;;;";
+
+// How the argument follows the fixed header, stored in the high nibble of the call byte
+enum class ArgumentEncoding : uint8_t {
+    NONE = 0,
+    TEXT = 1,       ///< Length-prefixed UTF-8.
+    ENCRYPTED = 2,  ///< Two length-prefixed binary blobs, base64-encoded and joined by ";;;;;".
+};
+
+// version, call|encoding, chainId, creationTime, nonce time (48 bits), nonce counter, key, signature, hash check
+static const size_t HEADER_SIZE = 1 + 1 + 1 + 4 + 6 + 4 + 32 + 64 + MESH_RELAY_HASH_CHECK_SIZE;
+
+class RelayWriter
+{
+  public:
+    RelayWriter(uint8_t *out, size_t capacity) : out_(out), capacity_(capacity) {}
+
+    void bytes(const void *data, size_t length)
+    {
+        if (length_ + length > capacity_) {
+            overflow_ = true;
+            return;
+        }
+        memcpy(out_ + length_, data, length);
+        length_ += length;
+    }
+
+    void integer(uint64_t value, int size)
+    {
+        uint8_t buffer[8];
+        for (int i = 0; i < size; i++) {
+            buffer[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+        bytes(buffer, size);
+    }
+
+    void varint(size_t value)
+    {
+        do {
+            uint8_t byte = value & 0x7f;
+            value >>= 7;
+            if (value) {
+                byte |= 0x80;
+            }
+            bytes(&byte, 1);
+        } while (value);
+    }
+
+    size_t length() const { return overflow_ ? 0 : length_; }
+
+  private:
+    uint8_t *out_;
+    size_t capacity_;
+    size_t length_ = 0;
+    bool overflow_ = false;
+};
+
+class RelayReader
+{
+  public:
+    RelayReader(const uint8_t *data, size_t length) : data_(data), length_(length) {}
+
+    const uint8_t *bytes(size_t length)
+    {
+        if (failed_ || position_ + length > length_) {
+            failed_ = true;
+            return nullptr;
+        }
+        const uint8_t *p = data_ + position_;
+        position_ += length;
+        return p;
+    }
+
+    uint64_t integer(int size)
+    {
+        const uint8_t *p = bytes(size);
+        uint64_t value = 0;
+        for (int i = 0; p && i < size; i++) {
+            value |= static_cast<uint64_t>(p[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    size_t varint()
+    {
+        size_t value = 0;
+        for (int shift = 0; shift < 28; shift += 7) {
+            const uint8_t *p = bytes(1);
+            if (!p) {
+                return 0;
+            }
+            value |= static_cast<size_t>(*p & 0x7f) << shift;
+            if (!(*p & 0x80)) {
+                return value;
+            }
+        }
+        failed_ = true;
+        return 0;
+    }
+
+    bool ok() const { return !failed_ && position_ == length_; }
+
+  private:
+    const uint8_t *data_;
+    size_t length_;
+    size_t position_ = 0;
+    bool failed_ = false;
+};
+
+static std::string encodeBase64(const uint8_t *data, size_t length)
+{
+    std::string encoded(base64::encodeLength(length), '\0');
+    base64::encode(data, length, &encoded[0]);
+    encoded.resize(strlen(encoded.c_str()));
+    return encoded;
+}
+
+// Decodes a base64 segment, accepting it only if re-encoding reproduces it byte for byte
+static bool decodeCanonicalBase64(const std::string &segment, std::string &decoded)
+{
+    if (segment.empty() || segment.size() % 4 != 0) {
+        return false;
+    }
+    decoded.assign(base64::decodeLength(segment.c_str()), '\0');
+    base64::decode(segment.c_str(), reinterpret_cast<uint8_t *>(&decoded[0]));
+    return encodeBase64(reinterpret_cast<const uint8_t *>(decoded.data()), decoded.size()) == segment;
+}
+
+size_t encodeRelayCommand(const RelayCommand &command, uint8_t *out, size_t capacity)
+{
+    const std::string argument(command.argument.c_str(), command.argument.length());
+    std::string ciphertext, encryptedKey;
+    ArgumentEncoding encoding = argument.empty() ? ArgumentEncoding::NONE : ArgumentEncoding::TEXT;
+    size_t separator = argument.find(ENCRYPTED_SEPARATOR);
+    if (separator != std::string::npos &&
+        decodeCanonicalBase64(argument.substr(0, separator), ciphertext) &&
+        decodeCanonicalBase64(argument.substr(separator + strlen(ENCRYPTED_SEPARATOR)), encryptedKey)) {
+        encoding = ArgumentEncoding::ENCRYPTED;
+    }
+
+    RelayWriter writer(out, capacity);
+    writer.integer(MESH_RELAY_VERSION, 1);
+    writer.integer(static_cast<uint8_t>(command.call) | (static_cast<uint8_t>(encoding) << 4), 1);
+    writer.integer(command.chainId, 1);
+    writer.integer(command.creationTime, 4);
+    writer.integer(command.nonceMs, 6);
+    writer.integer(command.nonceCounter, 4);
+    writer.bytes(command.publicKey, sizeof(command.publicKey));
+    writer.bytes(command.signature, sizeof(command.signature));
+    writer.bytes(command.hashCheck, sizeof(command.hashCheck));
+
+    if (encoding == ArgumentEncoding::ENCRYPTED) {
+        writer.varint(ciphertext.size());
+        writer.bytes(ciphertext.data(), ciphertext.size());
+        writer.varint(encryptedKey.size());
+        writer.bytes(encryptedKey.data(), encryptedKey.size());
+    } else if (encoding == ArgumentEncoding::TEXT) {
+        writer.varint(argument.size());
+        writer.bytes(argument.data(), argument.size());
+    }
+    return writer.length();
+}
+
+bool decodeRelayCommand(const uint8_t *message, size_t length, RelayCommand &command)
+{
+    if (length < HEADER_SIZE || message[0] != MESH_RELAY_VERSION) {
+        return false;
+    }
+
+    RelayReader reader(message + 1, length - 1);
+    uint8_t callByte = reader.integer(1);
+    uint8_t call = callByte & 0x0f;
+    // Only /send calls are relayed: no /local answer could find its way back to the node
+    if (call > static_cast<uint8_t>(PactCall::RAW) || pactCommand(static_cast<PactCall>(call)).endpoint != PactEndpoint::SEND) {
+        return false;
+    }
+    command.call = static_cast<PactCall>(call);
+    command.chainId = reader.integer(1);
+    command.creationTime = reader.integer(4);
+    command.nonceMs = reader.integer(6);
+    command.nonceCounter = reader.integer(4);
+    memcpy(command.publicKey, reader.bytes(sizeof(command.publicKey)), sizeof(command.publicKey));
+    memcpy(command.signature, reader.bytes(sizeof(command.signature)), sizeof(command.signature));
+    memcpy(command.hashCheck, reader.bytes(sizeof(command.hashCheck)), sizeof(command.hashCheck));
+
+    command.argument = "";
+    switch (static_cast<ArgumentEncoding>(callByte >> 4)) {
+    case ArgumentEncoding::NONE:
+        break;
+    case ArgumentEncoding::TEXT: {
+        size_t size = reader.varint();
+        const uint8_t *text = reader.bytes(size);
+        if (text) {
+            command.argument = String(std::string(reinterpret_cast<const char *>(text), size).c_str());
+        }
+        break;
+    }
+    case ArgumentEncoding::ENCRYPTED: {
+        size_t ciphertextSize = reader.varint();
+        const uint8_t *ciphertext = reader.bytes(ciphertextSize);
+        size_t keySize = reader.varint();
+        const uint8_t *key = reader.bytes(keySize);
+        if (ciphertext && key) {
+            std::string argument = encodeBase64(ciphertext, ciphertextSize) + ENCRYPTED_SEPARATOR + encodeBase64(key, keySize);
+            command.argument = String(argument.c_str());
+        }
+        break;
+    }
+    default:
+        return false;
+    }
+    return reader.ok();
+}
+
+size_t fragmentRelayMessage(const uint8_t *message, size_t length, uint16_t message_id, const MeshRelaySender &send)
+{
+    size_t count = (length + MESH_RELAY_FRAGMENT_PAYLOAD - 1) / MESH_RELAY_FRAGMENT_PAYLOAD;
+    if (count == 0 || count > MESH_RELAY_MAX_FRAGMENTS) {
+        return 0;
+    }
+
+    uint8_t packet[MESH_RELAY_PACKET_SIZE];
+    for (size_t index = 0; index < count; index++) {
+        size_t offset = index * MESH_RELAY_FRAGMENT_PAYLOAD;
+        size_t size = length - offset < MESH_RELAY_FRAGMENT_PAYLOAD ? length - offset : MESH_RELAY_FRAGMENT_PAYLOAD;
+        packet[0] = message_id & 0xff;
+        packet[1] = message_id >> 8;
+        packet[2] = (index << 4) | (count - 1);
+        memcpy(packet + MESH_RELAY_FRAGMENT_HEADER, message + offset, size);
+        send(packet, MESH_RELAY_FRAGMENT_HEADER + size);
+    }
+    return count;
+}
+
+size_t encodeRelayAck(uint16_t message_id, const uint8_t *hash, uint8_t *out, size_t capacity)
+{
+    if (capacity < MESH_RELAY_ACK_SIZE) {
+        return 0;
+    }
+    out[0] = message_id & 0xff;
+    out[1] = message_id >> 8;
+    out[2] = MESH_RELAY_ACK_MARKER;
+    memcpy(out + MESH_RELAY_FRAGMENT_HEADER, hash, MESH_RELAY_ACK_SIZE - MESH_RELAY_FRAGMENT_HEADER);
+    return MESH_RELAY_ACK_SIZE;
+}
+
+bool decodeRelayAck(const uint8_t *packet, size_t length, uint8_t *hash)
+{
+    if (length != MESH_RELAY_ACK_SIZE || packet[2] != MESH_RELAY_ACK_MARKER) {
+        return false;
+    }
+    memcpy(hash, packet + MESH_RELAY_FRAGMENT_HEADER, MESH_RELAY_ACK_SIZE - MESH_RELAY_FRAGMENT_HEADER);
+    return true;
+}
+
+bool MeshRelayReassembler::add(uint32_t sender, const uint8_t *fragment, size_t length)
+{
+    complete_ = nullptr;
+    if (length <= MESH_RELAY_FRAGMENT_HEADER || length > MESH_RELAY_PACKET_SIZE) {
+        return false;
+    }
+    uint16_t messageId = fragment[0] | (fragment[1] << 8);
+    uint8_t index = fragment[2] >> 4;
+    uint8_t count = (fragment[2] & 0x0f) + 1;
+    size_t size = length - MESH_RELAY_FRAGMENT_HEADER;
+    // Every fragment but the last is full, so a short one anywhere else is malformed
+    if (index >= count || count > MESH_RELAY_MAX_FRAGMENTS || (index + 1 < count && size != MESH_RELAY_FRAGMENT_PAYLOAD)) {
+        return false;
+    }
+
+    Slot *slot = nullptr;
+    Slot *oldest = &slots_[0];
+    for (Slot &candidate : slots_) {
+        if (candidate.used && candidate.sender == sender && candidate.messageId == messageId) {
+            slot = &candidate;
+            break;
+        }
+        if (!candidate.used || (oldest->used && candidate.age < oldest->age)) {
+            oldest = &candidate;
+        }
+    }
+    if (slot && slot->count != count) {
+        return false;
+    }
+    if (!slot) {
+        slot = oldest;
+        slot->used = true;
+        slot->sender = sender;
+        slot->messageId = messageId;
+        slot->count = count;
+        slot->received = 0;
+        slot->length = 0;
+    }
+    slot->age = ++clock_;
+
+    if (slot->received & (1u << index)) {
+        return false;
+    }
+    slot->received |= 1u << index;
+    memcpy(slot->data + index * MESH_RELAY_FRAGMENT_PAYLOAD, fragment + MESH_RELAY_FRAGMENT_HEADER, size);
+    if (index + 1 == count) {
+        slot->length = index * MESH_RELAY_FRAGMENT_PAYLOAD + size;
+    }
+
+    if (slot->received != (1u << count) - 1) {
+        return false;
+    }
+    slot->used = false;
+    complete_ = slot;
+    return true;
+}
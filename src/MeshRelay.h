@@ -0,0 +1,139 @@
+#pragma once
+#include <Arduino.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "PactCommands.h"
+
+#define MESH_RELAY_VERSION 1
+
+// Usable Meshtastic payload per packet, and the per-fragment header taking part of it
+#define MESH_RELAY_PACKET_SIZE 230
+#define MESH_RELAY_FRAGMENT_HEADER 3
+#define MESH_RELAY_FRAGMENT_PAYLOAD (MESH_RELAY_PACKET_SIZE - MESH_RELAY_FRAGMENT_HEADER)
+
+// Largest relayed command: an update-sent with a 2048-bit director key needs 2 fragments
+#define MESH_RELAY_MAX_FRAGMENTS 8
+#define MESH_RELAY_MAX_MESSAGE (MESH_RELAY_MAX_FRAGMENTS * MESH_RELAY_FRAGMENT_PAYLOAD)
+
+// Partially received messages a gateway tracks at once; the oldest is dropped when a new one arrives
+#ifndef MESH_RELAY_REASSEMBLY_SLOTS
+#define MESH_RELAY_REASSEMBLY_SLOTS 4
+#endif
+
+#define MESH_RELAY_HASH_CHECK_SIZE 4
+
+// An ack carries the fragment header with this marker in place of the index/count byte, which
+// no fragment can have, followed by the hash (request key) of the command the gateway submitted
+#define MESH_RELAY_ACK_MARKER 0xff
+#define MESH_RELAY_ACK_SIZE (MESH_RELAY_FRAGMENT_HEADER + 32)
+
+/**
+ * Hands one fragment to the mesh transport, e.g. a Meshtastic private-app port packet.
+ */
+using MeshRelaySender = std::function<void(const uint8_t *fragment, size_t length)>;
+
+/**
+ * Sends an ack for messages[index] of a submitted batch back to the node that relayed it.
+ */
+using MeshRelayAckSender = std::function<void(size_t index, const uint8_t *ack, size_t length)>;
+
+/**
+ * The variable fields of a signed command; everything else in the command JSON is a template constant.
+ *
+ * The gateway rebuilds the exact "cmd" bytes from these fields, recomputes the hash and submits
+ * the original signature, so the command verifies as if the node had posted it itself.
+ */
+struct RelayCommand {
+    PactCall call;                                ///< A call submitted to /send (update-sent, insert-my-node).
+    uint8_t chainId;                              ///< Chain the command was built for.
+    uint32_t creationTime;                        ///< meta.creationTime.
+    uint64_t nonceMs;                             ///< Nonce time, milliseconds since the Unix epoch.
+    uint32_t nonceCounter;                        ///< Nonce counter.
+    uint8_t publicKey[32];                        ///< Signer public key.
+    uint8_t signature[64];                        ///< Ed25519 signature over the command hash.
+    uint8_t hashCheck[MESH_RELAY_HASH_CHECK_SIZE]; ///< Leading bytes of the command hash.
+    String argument;                              ///< Call argument.
+};
+
+/**
+ * Encodes a relayed command into its binary form.
+ *
+ * Arguments of the form "<base64>;;;;;<base64>", as produced by EncryptionHandler::encrypt, are
+ * carried as raw bytes when they re-encode identically, which saves a quarter of their size.
+ *
+ * @return The encoded length, or 0 if it does not fit in capacity.
+ */
+size_t encodeRelayCommand(const RelayCommand &command, uint8_t *out, size_t capacity);
+
+/**
+ * Decodes a binary relayed command.
+ *
+ * @return True on success, false if the message is truncated, of an unknown version or carries a
+ *         call that is not submitted to /send.
+ */
+bool decodeRelayCommand(const uint8_t *message, size_t length, RelayCommand &command);
+
+/**
+ * Splits an encoded command into mesh packets.
+ *
+ * Each fragment carries a 3-byte header: the message id (little-endian) and a byte holding the
+ * fragment index in its high nibble and the fragment count minus one in its low nibble.
+ *
+ * @return The number of fragments sent, or 0 if the message needs more than MESH_RELAY_MAX_FRAGMENTS.
+ */
+size_t fragmentRelayMessage(const uint8_t *message, size_t length, uint16_t message_id, const MeshRelaySender &send);
+
+/**
+ * Encodes the ack a gateway returns once the chain's node accepted a relayed command.
+ *
+ * @param message_id The id the command's fragments carried.
+ * @param hash The 32-byte hash of the rebuilt command, i.e. its request key.
+ * @return MESH_RELAY_ACK_SIZE, or 0 if it does not fit in capacity.
+ */
+size_t encodeRelayAck(uint16_t message_id, const uint8_t *hash, uint8_t *out, size_t capacity);
+
+/**
+ * Decodes an ack, copying the acknowledged hash (32 bytes) to hash.
+ *
+ * @return False if the packet is not an ack, e.g. a fragment received on the same port.
+ */
+bool decodeRelayAck(const uint8_t *packet, size_t length, uint8_t *hash);
+
+/**
+ * Gateway-side reassembly of fragmented relay messages from several senders.
+ *
+ * Memory is fixed: MESH_RELAY_REASSEMBLY_SLOTS buffers of MESH_RELAY_MAX_MESSAGE bytes.
+ * Duplicate fragments are ignored, so mesh rebroadcasts are harmless.
+ */
+class MeshRelayReassembler
+{
+  public:
+    /**
+     * Adds a received fragment.
+     *
+     * @param sender The mesh node the fragment came from.
+     * @return True when this fragment completes a message, which is then available from
+     *         message() and length() until the next call.
+     */
+    bool add(uint32_t sender, const uint8_t *fragment, size_t length);
+
+    const uint8_t *message() const { return complete_ ? complete_->data : nullptr; }
+    size_t length() const { return complete_ ? complete_->length : 0; }
+
+  private:
+    struct Slot {
+        bool used = false;
+        uint32_t sender = 0;
+        uint16_t messageId = 0;
+        uint8_t count = 0;
+        uint16_t received = 0; ///< Bitmask of fragments received.
+        size_t length = 0;     ///< Total length, known once the last fragment arrived.
+        uint32_t age = 0;
+        uint8_t data[MESH_RELAY_MAX_MESSAGE];
+    };
+
+    Slot slots_[MESH_RELAY_REASSEMBLY_SLOTS];
+    Slot *complete_ = nullptr;
+    uint32_t clock_ = 0;
+};
@@ -0,0 +1,132 @@
+#include "NonceGenerator.h"
+#include <chrono>
+#include <cstring>
+
+static inline char *writeDigits(char *out, uint32_t value, int width)
+{
+    for (int i = width - 1; i >= 0; i--) {
+        out[i] = '0' + value % 10;
+        value /= 10;
+    }
+    return out + width;
+}
+
+// Converts days since 1970-01-01 to a proleptic Gregorian date (Howard Hinnant's civil_from_days)
+static void civilFromDays(int64_t days, int32_t &year, uint32_t &month, uint32_t &day)
+{
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const uint32_t doe = static_cast<uint32_t>(days - era * 146097);
+    const uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const uint32_t mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = static_cast<int32_t>(yoe + era * 400) + (month <= 2);
+}
+
+size_t NonceGenerator::next(char *out)
+{
+    using namespace std::chrono;
+    uint64_t now = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+    return next(out, now);
+}
+
+size_t NonceGenerator::next(char *out, uint64_t unix_ms)
+{
+    return format(out, unix_ms, counter_.fetch_add(1, std::memory_order_relaxed));
+}
+
+size_t NonceGenerator::format(char *out, uint64_t unix_ms, uint32_t count)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+    uint64_t seconds = unix_ms / 1000;
+    uint32_t millis_part = unix_ms % 1000;
+    uint32_t second_of_day = seconds % 86400;
+    int32_t year;
+    uint32_t month, day;
+    civilFromDays(seconds / 86400, year, month, day);
+
+    char *p = out;
+    p = writeDigits(p, year, 4);
+    *p++ = '-';
+    p = writeDigits(p, month, 2);
+    *p++ = '-';
+    p = writeDigits(p, day, 2);
+    *p++ = ' ';
+    p = writeDigits(p, second_of_day / 3600, 2);
+    *p++ = ':';
+    p = writeDigits(p, (second_of_day / 60) % 60, 2);
+    *p++ = ':';
+    p = writeDigits(p, second_of_day % 60, 2);
+    *p++ = '.';
+    p = writeDigits(p, millis_part, 3);
+    memcpy(p, " UTC-", 5);
+    p += 5;
+    for (int shift = 28; shift >= 0; shift -= 4) {
+        *p++ = hexDigits[(count >> shift) & 0xf];
+    }
+    *p = '\0';
+    return p - out;
+}
+
+static bool readDigits(const char *&p, int width, uint32_t &value)
+{
+    value = 0;
+    for (int i = 0; i < width; i++, p++) {
+        if (*p < '0' || *p > '9') {
+            return false;
+        }
+        value = value * 10 + (*p - '0');
+    }
+    return true;
+}
+
+bool NonceGenerator::parse(const char *nonce, uint64_t &unix_ms, uint32_t &count)
+{
+    if (!nonce || strlen(nonce) != NONCE_LENGTH) {
+        return false;
+    }
+
+    const char *p = nonce;
+    uint32_t year, month, day, hour, minute, second, millis_part;
+    if (!readDigits(p, 4, year) || *p++ != '-' || !readDigits(p, 2, month) || *p++ != '-' ||
+        !readDigits(p, 2, day) || *p++ != ' ' || !readDigits(p, 2, hour) || *p++ != ':' ||
+        !readDigits(p, 2, minute) || *p++ != ':' || !readDigits(p, 2, second) || *p++ != '.' ||
+        !readDigits(p, 3, millis_part) || memcmp(p, " UTC-", 5) != 0) {
+        return false;
+    }
+    p += 5;
+
+    count = 0;
+    for (int i = 0; i < 8; i++, p++) {
+        char c = *p;
+        if (c >= '0' && c <= '9') {
+            count = (count << 4) | (c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            count = (count << 4) | (c - 'a' + 10);
+        } else {
+            return false;
+        }
+    }
+
+    // Days since the epoch for the parsed date (inverse of civilFromDays)
+    int64_t y = static_cast<int64_t>(year) - (month <= 2);
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const uint32_t yoe = static_cast<uint32_t>(y - era * 400);
+    const uint32_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int64_t days = era * 146097 + static_cast<int64_t>(doe) - 719468;
+    unix_ms = (static_cast<uint64_t>(days) * 86400 + hour * 3600 + minute * 60 + second) * 1000 + millis_part;
+
+    // Only canonical nonces round-trip; anything else (e.g. month 13) is rejected
+    char check[NONCE_BUFFER_SIZE];
+    format(check, unix_ms, count);
+    return memcmp(check, nonce, NONCE_LENGTH) == 0;
+}
+
+NonceGenerator &NonceGenerator::shared()
+{
+    static NonceGenerator generator;
+    return generator;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// "YYYY-MM-DD HH:MM:SS.mmm UTC-cccccccc" plus the null terminator
+#define NONCE_LENGTH 36
+#define NONCE_BUFFER_SIZE (NONCE_LENGTH + 1)
+
+/**
+ * Generates unique command nonces without locking or heap allocation.
+ *
+ * Each nonce combines the wall-clock time at millisecond resolution with a monotonic
+ * counter, so commands built within the same millisecond (or with a clock that stands
+ * still) never share a nonce and therefore never hash identically. The counter is a
+ * lock-free atomic, making a single generator safe to share between threads.
+ */
+class NonceGenerator
+{
+  public:
+    NonceGenerator(uint32_t initial_counter = 0) : counter_(initial_counter) {}
+
+    /**
+     * Writes the next nonce into the given buffer using the current time.
+     *
+     * @param out Buffer of at least NONCE_BUFFER_SIZE bytes, null-terminated on return.
+     * @return The number of characters written, excluding the terminator.
+     */
+    size_t next(char *out);
+
+    /**
+     * Writes the next nonce into the given buffer for the specified time.
+     *
+     * @param out Buffer of at least NONCE_BUFFER_SIZE bytes, null-terminated on return.
+     * @param unix_ms Milliseconds since the Unix epoch.
+     * @return The number of characters written, excluding the terminator.
+     */
+    size_t next(char *out, uint64_t unix_ms);
+
+    /**
+     * Returns the value the counter will use for the next nonce.
+     */
+    uint32_t counter() const { return counter_.load(std::memory_order_relaxed); }
+
+    /**
+     * Formats a nonce from its time and counter, without advancing any generator.
+     *
+     * @param out Buffer of at least NONCE_BUFFER_SIZE bytes, null-terminated on return.
+     * @return The number of characters written, excluding the terminator.
+     */
+    static size_t format(char *out, uint64_t unix_ms, uint32_t count);
+
+    /**
+     * Splits a nonce produced by this generator back into its time and counter.
+     *
+     * @return True if the nonce is in the canonical format and format() reproduces it exactly.
+     */
+    static bool parse(const char *nonce, uint64_t &unix_ms, uint32_t &count);
+
+    /**
+     * Returns the process-wide generator shared by all handlers.
+     */
+    static NonceGenerator &shared();
+
+  private:
+    std::atomic<uint32_t> counter_;
+};
@@ -0,0 +1,96 @@
+#include "PactCommands.h"
+#include <cstring>
+
+// Pact string literals use backslash escapes for quotes and backslashes
+static void appendPactString(String &code, const char *value, size_t length)
+{
+    code += '"';
+    for (size_t i = 0; i < length; i++) {
+        char c = value[i];
+        if (c == '"' || c == '\\') {
+            code += '\\';
+        }
+        code += c;
+    }
+    code += '"';
+}
+
+String buildPactCode(PactCall call, const String &argument)
+{
+    const PactCommand &command = pactCommand(call);
+    if (!command.function) {
+        return argument;
+    }
+
+    String code;
+    if (!command.takesArgument) {
+        code.reserve(strlen(command.function) + 1);
+        code += command.function;
+        code += ")";
+        return code;
+    }
+
+    code.reserve(strlen(command.function) + argument.length() + 4);
+    code += command.function;
+    code += " ";
+    appendPactString(code, argument.c_str(), argument.length());
+    code += ")";
+    return code;
+}
+
+PactCall pactCallFromCode(const String &code)
+{
+    for (const PactCommand &command : PACT_COMMANDS) {
+        if (!command.function) {
+            continue;
+        }
+        size_t length = strlen(command.function);
+        // Match the function name only when followed by a separator, so prefixes of longer names don't match
+        if (strncmp(code.c_str(), command.function, length) == 0 &&
+            (code[length] == ')' || code[length] == ' ')) {
+            return command.call;
+        }
+    }
+    return PactCall::RAW;
+}
+
+String buildBeaconBatchCode(const String &root, const std::vector<std::string> &publicKeys)
+{
+    // Keys and root are hex and base64url, so nothing needs escaping
+    String code;
+    code.reserve(64 + root.length() + publicKeys.size() * 68);
+    code += "(" PACT_MODULE ".update-sent-batch \"";
+    code += root;
+    code += "\" [";
+    for (size_t i = 0; i < publicKeys.size(); i++) {
+        code += i == 0 ? "\"" : ", \"";
+        code += publicKeys[i].c_str();
+        code += "\"";
+    }
+    code += "])";
+    return code;
+}
+
+String buildNodeQueryCode(const std::vector<std::string> &nodeIds, size_t first, size_t maxLength, size_t &count)
+{
+    static const char prefix[] = "(map (lambda (id) (try false (" PACT_MODULE ".get-node id))) [";
+    String code;
+    code.reserve(maxLength);
+    code += prefix;
+    count = 0;
+    for (size_t i = first; i < nodeIds.size(); i++) {
+        size_t mark = code.length();
+        if (count > 0) {
+            code += ", ";
+        }
+        appendPactString(code, nodeIds[i].data(), nodeIds[i].size());
+        // Room for the closing "])"
+        if (code.length() + 2 > maxLength) {
+            code.remove(mark);
+            break;
+        }
+        count++;
+    }
+    code += "])";
+    return code;
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <Arduino.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define PACT_MODULE "free.mesh03"
+
+// Gas limit of a single-node command
+#define PACT_GAS_LIMIT 1000
+
+// Longest multi-node query expression. At one director key (roughly 600 bytes) per node in the
+// reply, 1024 bytes of code (about 14 public keys) keep a /local response under 10 KiB
+#define NODE_QUERY_MAX_CODE_SIZE 1024
+
+// Gas added per node read by a multi-node query, on top of PACT_GAS_LIMIT
+#define NODE_QUERY_GAS_PER_NODE 150
+
+/**
+ * Identifies a Pact call issued by the library. The value indexes PACT_COMMANDS.
+ */
+enum class PactCall : uint8_t {
+    GET_MY_NODE,
+    UPDATE_SENT,
+    INSERT_MY_NODE,
+    GET_SENDER_DETAILS,
+    RAW, ///< Caller-supplied code with no known result shape.
+    // Appended after RAW: relay messages and traces carry these values, and relays reject anything above RAW
+    GET_NODES, ///< Status of many nodes in one /local, code built by buildNodeQueryCode.
+};
+
+/**
+ * The Pact API endpoint a call is submitted to.
+ */
+enum class PactEndpoint : uint8_t {
+    LOCAL, ///< Read-only evaluation, result decoded from the response.
+    SEND,  ///< Transaction submission, response only carries request keys.
+};
+
+/**
+ * The shape of the "result.data" a call returns, selecting the decoder applied to it.
+ */
+enum class PactResultShape : uint8_t {
+    STATUS_ONLY,    ///< Only the result status is inspected.
+    NODE_STATUS,    ///< { "send": bool, "pubkeyd": string }
+    SENDER_DETAILS, ///< { "pubkeyd": string, ... }
+    NODE_STATUS_LIST, ///< [ { "send": bool, "pubkeyd": string } or false, ... ]
+};
+
+/**
+ * @struct PactCommand
+ * @brief Compile-time descriptor of a Pact call.
+ */
+struct PactCommand {
+    PactCall call;           ///< The call this descriptor describes.
+    const char *function;    ///< Fully qualified Pact function, or nullptr for RAW.
+    PactEndpoint endpoint;   ///< Endpoint the call is submitted to.
+    PactResultShape shape;   ///< Decoder applied to the /local result.
+    bool takesArgument;      ///< Whether the function takes a single string argument.
+};
+
+constexpr PactCommand PACT_COMMANDS[] = {
+    {PactCall::GET_MY_NODE, "(" PACT_MODULE ".get-my-node", PactEndpoint::LOCAL, PactResultShape::NODE_STATUS, false},
+    {PactCall::UPDATE_SENT, "(" PACT_MODULE ".update-sent", PactEndpoint::SEND, PactResultShape::STATUS_ONLY, true},
+    {PactCall::INSERT_MY_NODE, "(" PACT_MODULE ".insert-my-node", PactEndpoint::SEND, PactResultShape::STATUS_ONLY, true},
+    {PactCall::GET_SENDER_DETAILS, "(" PACT_MODULE ".get-sender-details", PactEndpoint::LOCAL, PactResultShape::SENDER_DETAILS,
+     false},
+    {PactCall::RAW, nullptr, PactEndpoint::LOCAL, PactResultShape::STATUS_ONLY, false},
+    {PactCall::GET_NODES, nullptr, PactEndpoint::LOCAL, PactResultShape::NODE_STATUS_LIST, false},
+};
+
+/**
+ * Returns the descriptor for a call.
+ */
+constexpr const PactCommand &pactCommand(PactCall call)
+{
+    return PACT_COMMANDS[static_cast<size_t>(call)];
+}
+
+/**
+ * Returns the URL path segment of an endpoint ("local" or "send").
+ */
+constexpr const char *pactEndpointPath(PactEndpoint endpoint)
+{
+    return endpoint == PactEndpoint::LOCAL ? "local" : "send";
+}
+
+/**
+ * Builds the Pact code for a call, quoting and escaping its argument when it takes one.
+ *
+ * @param call The call to build.
+ * @param argument The string argument, ignored for calls without one.
+ * @return The Pact expression, e.g. (free.mesh03.update-sent "...").
+ */
+String buildPactCode(PactCall call, const String &argument = "");
+
+/**
+ * Identifies the call a piece of caller-supplied Pact code invokes.
+ *
+ * Only used to support the untyped executeBlockchainCommand overload; typed callers already
+ * know their call and never scan code text.
+ *
+ * @return The matching call, or PactCall::RAW if the code is not a known call.
+ */
+PactCall pactCallFromCode(const String &code);
+
+/**
+ * Builds the code of a Merkle-committed beacon batch (see BeaconBatch).
+ *
+ * The deployed free.mesh03 has no update-sent-batch yet, so the code only runs against a
+ * contract that adds it.
+ *
+ * @param root The base64url Merkle root.
+ * @param publicKeys The node keys, in leaf order.
+ * @return The Pact expression, e.g. (free.mesh03.update-sent-batch "<root>" ["<key>", ...]).
+ */
+String buildBeaconBatchCode(const String &root, const std::vector<std::string> &publicKeys);
+
+/**
+ * Builds a status query of many nodes in one expression: get-node mapped over their keys, an
+ * unregistered node yielding false rather than failing the whole call.
+ *
+ * Keys are added from first on for as long as the code stays within maxLength. The deployed
+ * free.mesh03 has no get-node yet, so the code only runs against a contract that adds it.
+ *
+ * @param nodeIds The node keys.
+ * @param first The first key to include.
+ * @param maxLength The longest code to build, e.g. NODE_QUERY_MAX_CODE_SIZE.
+ * @param count Receives the number of keys included; 0 if not even nodeIds[first] fits.
+ * @return The Pact expression, e.g. (map (lambda (id) (try false (free.mesh03.get-node id))) ["<key>", ...]).
+ */
+String buildNodeQueryCode(const std::vector<std::string> &nodeIds, size_t first, size_t maxLength, size_t &count);
@@ -0,0 +1,275 @@
+#include "SecretDecryptor.h"
+#include "mbedtls/platform_util.h"
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+struct SecretDecryptor::Worker {
+    mbedtls_rsa_context rsa;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context drbg; // Random source for RSA blinding
+    mbedtls_aes_context aes;
+    bool seeded = false;
+
+    Worker()
+    {
+        mbedtls_rsa_init(&rsa, MBEDTLS_RSA_PKCS_V21, MBEDTLS_MD_SHA256);
+        mbedtls_entropy_init(&entropy);
+        mbedtls_ctr_drbg_init(&drbg);
+        mbedtls_aes_init(&aes);
+    }
+
+    ~Worker()
+    {
+        mbedtls_aes_free(&aes);
+        mbedtls_ctr_drbg_free(&drbg);
+        mbedtls_entropy_free(&entropy);
+        mbedtls_rsa_free(&rsa);
+    }
+};
+
+static int base64Value(char c)
+{
+    if (c >= 'A' && c <= 'Z') {
+        return c - 'A';
+    }
+    if (c >= 'a' && c <= 'z') {
+        return c - 'a' + 26;
+    }
+    if (c >= '0' && c <= '9') {
+        return c - '0' + 52;
+    }
+    if (c == '+') {
+        return 62;
+    }
+    if (c == '/') {
+        return 63;
+    }
+    return -1;
+}
+
+// Decodes padded base64 from a span of the caller's buffer, rejecting anything else
+static bool decodeBase64(const char *in, size_t length, unsigned char *out, size_t capacity, size_t &decoded)
+{
+    if (length == 0 || length % 4 != 0) {
+        return false;
+    }
+    size_t padding = in[length - 1] == '=' ? (in[length - 2] == '=' ? 2 : 1) : 0;
+    decoded = length / 4 * 3 - padding;
+    if (decoded > capacity) {
+        return false;
+    }
+
+    size_t written = 0;
+    for (size_t i = 0; i < length; i += 4) {
+        uint32_t quad = 0;
+        for (size_t j = 0; j < 4; j++) {
+            int value = 0;
+            if (i + 4 < length || j < 4 - padding) {
+                value = base64Value(in[i + j]);
+                if (value < 0) {
+                    return false;
+                }
+            }
+            quad = quad << 6 | static_cast<uint32_t>(value);
+        }
+        for (int shift = 16; shift >= 0 && written < decoded; shift -= 8) {
+            out[written++] = static_cast<unsigned char>(quad >> shift);
+        }
+    }
+    return true;
+}
+
+SecretDecryptor::SecretDecryptor(unsigned threads)
+{
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        workers_.emplace_back(new Worker());
+    }
+}
+
+SecretDecryptor::~SecretDecryptor() = default;
+
+bool SecretDecryptor::setPrivateKey(const std::string &base64PrivateKey)
+{
+    has_key_ = false;
+
+    // Decode Base64 private key to a null-terminated PEM buffer, as mbedtls_pk_parse_key expects
+    size_t decodedKeyLength = base64::decodeLength(base64PrivateKey.c_str());
+    std::vector<unsigned char> pem(decodedKeyLength + 1);
+    base64::decode(base64PrivateKey.c_str(), pem.data());
+    pem[decodedKeyLength] = '\0';
+
+    mbedtls_pk_context pk;
+    mbedtls_pk_init(&pk);
+    int err = mbedtls_pk_parse_key(&pk, pem.data(), pem.size(), nullptr, 0);
+    mbedtls_platform_zeroize(pem.data(), pem.size());
+    if (err != 0) {
+        Serial.printf("Failed to parse private key: -%04x\n", -err);
+        mbedtls_pk_free(&pk);
+        return false;
+    }
+    if (mbedtls_pk_get_type(&pk) != MBEDTLS_PK_RSA) {
+        Serial.printf("Private key is not an RSA key\n");
+        mbedtls_pk_free(&pk);
+        return false;
+    }
+
+    // Also validates dP, dQ and qInv, which every private operation below relies on
+    mbedtls_rsa_context *rsa = mbedtls_pk_rsa(pk);
+    if (mbedtls_rsa_check_privkey(rsa) != 0 || mbedtls_rsa_get_len(rsa) > SECRET_RSA_MAX_SIZE) {
+        Serial.printf("Invalid RSA private key\n");
+        mbedtls_pk_free(&pk);
+        return false;
+    }
+
+    for (size_t i = 0; i < workers_.size(); i++) {
+        Worker &worker = *workers_[i];
+        mbedtls_rsa_free(&worker.rsa);
+        mbedtls_rsa_init(&worker.rsa, MBEDTLS_RSA_PKCS_V21, MBEDTLS_MD_SHA256);
+        if (mbedtls_rsa_copy(&worker.rsa, rsa) != 0) {
+            Serial.printf("Failed to copy RSA key\n");
+            mbedtls_pk_free(&pk);
+            return false;
+        }
+        mbedtls_rsa_set_padding(&worker.rsa, MBEDTLS_RSA_PKCS_V21, MBEDTLS_MD_SHA256);
+
+        if (!worker.seeded) {
+            // The worker index keeps DRBGs seeded in the same instant apart
+            if (mbedtls_ctr_drbg_seed(&worker.drbg, mbedtls_entropy_func, &worker.entropy,
+                                      reinterpret_cast<const unsigned char *>(&i), sizeof(i)) != 0) {
+                Serial.printf("Failed to initialize RNG\n");
+                mbedtls_pk_free(&pk);
+                return false;
+            }
+            worker.seeded = true;
+        }
+    }
+    mbedtls_pk_free(&pk);
+
+    has_key_ = true;
+    return true;
+}
+
+bool SecretDecryptor::decrypt(const char *secret, size_t length, std::string &plaintext)
+{
+    return decryptWith(*workers_[0], secret, length, plaintext);
+}
+
+bool SecretDecryptor::decrypt(const std::string &secret, std::string &plaintext)
+{
+    return decrypt(secret.data(), secret.size(), plaintext);
+}
+
+bool SecretDecryptor::decryptWith(Worker &worker, const char *secret, size_t length, std::string &plaintext)
+{
+    plaintext.clear();
+    if (!has_key_) {
+        return false;
+    }
+
+    // Split at the separator without copying either half
+    const size_t separatorLength = strlen(SECRET_SEPARATOR);
+    const char *separator = nullptr;
+    for (size_t i = 0; i + separatorLength <= length; i++) {
+        if (memcmp(secret + i, SECRET_SEPARATOR, separatorLength) == 0) {
+            separator = secret + i;
+            break;
+        }
+    }
+    if (!separator) {
+        return false;
+    }
+    size_t dataBase64Length = separator - secret;
+    const char *keyBase64 = separator + separatorLength;
+    size_t keyBase64Length = secret + length - keyBase64;
+
+    // Recover the symmetric key with RSA-OAEP (SHA-256)
+    unsigned char encryptedKey[SECRET_RSA_MAX_SIZE];
+    size_t encryptedKeyLength;
+    if (!decodeBase64(keyBase64, keyBase64Length, encryptedKey, sizeof(encryptedKey), encryptedKeyLength) ||
+        encryptedKeyLength != mbedtls_rsa_get_len(&worker.rsa)) {
+        return false;
+    }
+    unsigned char symKey[SECRET_RSA_MAX_SIZE];
+    size_t symKeyLength;
+    if (mbedtls_rsa_rsaes_oaep_decrypt(&worker.rsa, mbedtls_ctr_drbg_random, &worker.drbg, MBEDTLS_RSA_PRIVATE, nullptr, 0,
+                                       &symKeyLength, encryptedKey, symKey, sizeof(symKey)) != 0) {
+        return false;
+    }
+
+    // Decode "Salted__" + salt + ciphertext straight into the output, then decrypt it there
+    plaintext.resize(dataBase64Length / 4 * 3);
+    unsigned char *combinedData = reinterpret_cast<unsigned char *>(&plaintext[0]);
+    size_t combinedSize;
+    if (!decodeBase64(secret, dataBase64Length, combinedData, plaintext.size(), combinedSize) ||
+        combinedSize < SECRET_HEADER_SIZE + 16 || (combinedSize - SECRET_HEADER_SIZE) % 16 != 0 ||
+        memcmp(combinedData, SECRET_SALT_PREFIX, strlen(SECRET_SALT_PREFIX)) != 0) {
+        mbedtls_platform_zeroize(symKey, sizeof(symKey));
+        plaintext.clear();
+        return false;
+    }
+
+    unsigned char derivedKey[SECRET_AES_KEY_SIZE], derivedIV[SECRET_IV_SIZE];
+    EncryptionHandler::deriveSecretKey(symKey, symKeyLength, combinedData + strlen(SECRET_SALT_PREFIX), derivedKey, derivedIV);
+    mbedtls_platform_zeroize(symKey, sizeof(symKey));
+
+    unsigned char *ciphertext = combinedData + SECRET_HEADER_SIZE;
+    size_t ciphertextSize = combinedSize - SECRET_HEADER_SIZE;
+    mbedtls_aes_setkey_dec(&worker.aes, derivedKey, 256);
+    mbedtls_aes_crypt_cbc(&worker.aes, MBEDTLS_AES_DECRYPT, ciphertextSize, derivedIV, ciphertext, ciphertext);
+    mbedtls_platform_zeroize(derivedKey, sizeof(derivedKey));
+
+    // Check and strip the PKCS7 padding
+    unsigned char padding = ciphertext[ciphertextSize - 1];
+    bool padded = padding >= 1 && padding <= 16;
+    for (size_t i = 0; padded && i < padding; i++) {
+        padded = ciphertext[ciphertextSize - 1 - i] == padding;
+    }
+    if (!padded) {
+        plaintext.clear();
+        return false;
+    }
+    plaintext.erase(0, SECRET_HEADER_SIZE);
+    plaintext.resize(ciphertextSize - padding);
+    return true;
+}
+
+size_t SecretDecryptor::decryptBatch(const std::string *secrets, size_t count, std::string *plaintexts, bool *decrypted)
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    // Workers claim secrets one at a time, so a slow one never holds up a fixed share of the batch
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> succeeded(0);
+    auto run = [&](Worker &worker) {
+        for (size_t i = next++; i < count; i = next++) {
+            bool ok = decryptWith(worker, secrets[i].data(), secrets[i].size(), plaintexts[i]);
+            if (decrypted) {
+                decrypted[i] = ok;
+            }
+            if (ok) {
+                succeeded++;
+            }
+        }
+    };
+
+    size_t helpers = (workers_.size() < count ? workers_.size() : count) - 1;
+    std::vector<std::thread> threads;
+    threads.reserve(helpers);
+    for (size_t i = 1; i <= helpers; i++) {
+        threads.emplace_back(run, std::ref(*workers_[i]));
+    }
+    run(*workers_[0]);
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    return succeeded;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <Arduino.h>
+#include "EncryptionHandler.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// Worker threads used by decryptBatch; 0 means one per hardware thread
+#define SECRET_DECRYPT_THREADS 0
+
+/**
+ * Decrypts secrets written by EncryptionHandler::encrypt, for the director that receives them.
+ *
+ * The private key is parsed and checked once; its CRT parameters (dP, dQ, qInv) are required, so
+ * every RSA-OAEP decryption runs as two half-size exponentiations instead of one with d. Each
+ * worker keeps its own copy of the key and its own DRBG for RSA blinding, so workers share nothing
+ * while decrypting. Secrets are decoded in place from the caller's buffer: the two base64 halves
+ * are never split into separate strings, the RSA block is decoded onto the stack and the ciphertext
+ * straight into the plaintext string, where it is also decrypted.
+ *
+ * decrypt() uses the first worker and must not be called from several threads at once; decryptBatch
+ * spreads a batch over all workers itself.
+ */
+class SecretDecryptor
+{
+  public:
+    /**
+     * @param threads Workers for decryptBatch, or 0 for one per hardware thread.
+     */
+    explicit SecretDecryptor(unsigned threads = SECRET_DECRYPT_THREADS);
+    ~SecretDecryptor();
+
+    SecretDecryptor(const SecretDecryptor &) = delete;
+    SecretDecryptor &operator=(const SecretDecryptor &) = delete;
+
+    /**
+     * Loads the director's RSA private key.
+     *
+     * @param base64PrivateKey The PEM private key (PKCS#1 or PKCS#8), encoded in Base64 like the
+     *        public key given to EncryptionHandler::encrypt.
+     * @return False if the key cannot be parsed, is not RSA or lacks valid CRT parameters.
+     */
+    bool setPrivateKey(const std::string &base64PrivateKey);
+
+    /**
+     * Decrypts one secret.
+     *
+     * @param secret The secret, need not be null-terminated.
+     * @param length The length of secret.
+     * @param plaintext Receives the payload; cleared on failure.
+     * @return False if the secret is malformed, was encrypted for another key or fails the padding check.
+     */
+    bool decrypt(const char *secret, size_t length, std::string &plaintext);
+    bool decrypt(const std::string &secret, std::string &plaintext);
+
+    /**
+     * Decrypts many secrets in parallel, each worker taking the next secret as it finishes one.
+     *
+     * @param secrets The secrets to decrypt.
+     * @param count The number of secrets.
+     * @param plaintexts Receives count payloads; failed entries are left empty.
+     * @param decrypted Optional, receives whether each secret was decrypted.
+     * @return The number of secrets decrypted.
+     */
+    size_t decryptBatch(const std::string *secrets, size_t count, std::string *plaintexts, bool *decrypted = nullptr);
+
+    /**
+     * Returns the number of workers used by decryptBatch.
+     */
+    size_t threads() const { return workers_.size(); }
+
+  private:
+    struct Worker;
+
+    bool decryptWith(Worker &worker, const char *secret, size_t length, std::string &plaintext);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    bool has_key_ = false;
+};
@@ -0,0 +1,186 @@
+#include "SubmissionLimiter.h"
+#include "ClockSkew.h"
+#include <algorithm>
+#include <chrono>
+
+// Longest Retry-After honored, so a bogus header cannot stall the gateway for days
+static const uint32_t RETRY_AFTER_MAX_S = 3600;
+
+SubmissionLimiter::SubmissionLimiter(float rate_per_s, uint32_t burst, uint32_t initial_limit, uint32_t max_limit)
+    : rate_per_ms_(rate_per_s / 1000.0f)
+    , burst_(burst > 0 ? burst : 1)
+    , tokens_(burst_)
+    , limit_(initial_limit < SUBMISSION_LIMIT_MIN ? SUBMISSION_LIMIT_MIN : initial_limit)
+    , max_limit_(max_limit < limit_ ? limit_ : max_limit)
+    , last_refill_ms_(millis())
+{
+}
+
+void SubmissionLimiter::acquire()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        uint32_t wait_ms = admit(millis());
+        if (wait_ms == 0) {
+            return;
+        }
+        // A release wakes the waiters early; the timeout covers token refills and pauses
+        waiting_++;
+        released_.wait_for(lock, std::chrono::milliseconds(wait_ms));
+        waiting_--;
+    }
+}
+
+uint32_t SubmissionLimiter::tryAcquire(unsigned long now_ms)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return admit(now_ms);
+}
+
+uint32_t SubmissionLimiter::admit(unsigned long now_ms)
+{
+    if (paused_) {
+        long remaining = static_cast<long>(paused_until_ms_ - now_ms);
+        if (remaining > 0) {
+            return remaining;
+        }
+        paused_ = false;
+    }
+    if (in_flight_ >= static_cast<uint32_t>(limit_)) {
+        return baseline_latency_ms_ > 0 ? baseline_latency_ms_ : 1;
+    }
+    if (rate_per_ms_ > 0) {
+        tokens_ += (now_ms - last_refill_ms_) * rate_per_ms_;
+        if (tokens_ > burst_) {
+            tokens_ = burst_;
+        }
+        last_refill_ms_ = now_ms;
+        if (tokens_ < 1.0f) {
+            return static_cast<uint32_t>((1.0f - tokens_) / rate_per_ms_) + 1;
+        }
+        tokens_ -= 1.0f;
+    }
+    in_flight_++;
+    return 0;
+}
+
+void SubmissionLimiter::release(int httpCode, uint32_t latencyMs, uint32_t retryAfterMs)
+{
+    release(millis(), httpCode, latencyMs, retryAfterMs);
+}
+
+void SubmissionLimiter::release(unsigned long now_ms, int httpCode, uint32_t latencyMs, uint32_t retryAfterMs)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (in_flight_ > 0) {
+        in_flight_--;
+    }
+
+    bool rejected = httpCode == 429 || httpCode == 503;
+    // A 502 or 504 is a proxy in front of the node giving up on it
+    bool overload = rejected || httpCode == 502 || httpCode == 504 || httpCode < 0;
+    if (!overload && httpCode > 0) {
+        if (httpCode >= 200 && httpCode <= 299) {
+            addLatency(latencyMs);
+        }
+        overload = baseline_latency_ms_ > 0 && latencyMs > SUBMISSION_LATENCY_INFLATION * baseline_latency_ms_;
+    }
+
+    if (overload) {
+        decrease(now_ms);
+    } else if (httpCode > 0 && httpCode < 500) {
+        limit_ += 1.0f / limit_;
+        if (limit_ > max_limit_) {
+            limit_ = max_limit_;
+        }
+    }
+
+    if (rejected && retryAfterMs > 0) {
+        unsigned long until = now_ms + retryAfterMs;
+        if (!paused_ || static_cast<long>(until - paused_until_ms_) > 0) {
+            paused_until_ms_ = until;
+        }
+        paused_ = true;
+    }
+    released_.notify_all();
+}
+
+void SubmissionLimiter::addLatency(uint32_t latencyMs)
+{
+    latencies_[latency_next_] = latencyMs;
+    latency_next_ = (latency_next_ + 1) % SUBMISSION_LATENCY_WINDOW;
+    if (latency_count_ < SUBMISSION_LATENCY_WINDOW) {
+        latency_count_++;
+    }
+
+    // A percentile rather than the minimum, so a few odd fast replies cannot pin the baseline, and
+    // a window so it follows a node that has become slower for good
+    uint32_t sorted[SUBMISSION_LATENCY_WINDOW];
+    std::copy(latencies_, latencies_ + latency_count_, sorted);
+    uint32_t *rank = sorted + latency_count_ * SUBMISSION_LATENCY_PERCENTILE / 100;
+    std::nth_element(sorted, rank, sorted + latency_count_);
+    baseline_latency_ms_ = *rank > SUBMISSION_LATENCY_FLOOR_MS ? *rank : SUBMISSION_LATENCY_FLOOR_MS;
+}
+
+void SubmissionLimiter::decrease(unsigned long now_ms)
+{
+    overloads_++;
+    // Requests in flight together fail together; one halving per round trip is enough
+    uint32_t window_ms = baseline_latency_ms_ > 0 ? baseline_latency_ms_ : 1;
+    if (decreased_ && now_ms - last_decrease_ms_ < window_ms) {
+        return;
+    }
+    limit_ /= 2;
+    if (limit_ < SUBMISSION_LIMIT_MIN) {
+        limit_ = SUBMISSION_LIMIT_MIN;
+    }
+    decreased_ = true;
+    last_decrease_ms_ = now_ms;
+}
+
+uint32_t SubmissionLimiter::limit() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<uint32_t>(limit_);
+}
+
+uint32_t SubmissionLimiter::inFlight() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return in_flight_;
+}
+
+uint32_t SubmissionLimiter::queueDepth() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return waiting_;
+}
+
+uint32_t SubmissionLimiter::overloads() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return overloads_;
+}
+
+uint32_t SubmissionLimiter::parseRetryAfterMs(const char *value, int64_t server_now_s)
+{
+    if (!value || !*value) {
+        return 0;
+    }
+    int64_t seconds = 0;
+    if (*value >= '0' && *value <= '9') {
+        for (const char *p = value; *p >= '0' && *p <= '9' && seconds <= RETRY_AFTER_MAX_S; p++) {
+            seconds = seconds * 10 + (*p - '0');
+        }
+    } else {
+        int64_t at;
+        if (!ClockSkewEstimator::parseHttpDate(value, at)) {
+            return 0;
+        }
+        seconds = at - server_now_s;
+    }
+    if (seconds <= 0) {
+        return 0;
+    }
+    return (seconds > RETRY_AFTER_MAX_S ? RETRY_AFTER_MAX_S : seconds) * 1000;
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <Arduino.h>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+// Concurrency limit bounds; the limit starts low and grows while the node keeps up
+#define SUBMISSION_LIMIT_INITIAL 4
+#define SUBMISSION_LIMIT_MIN 1
+#define SUBMISSION_LIMIT_MAX 64
+
+// Token bucket defaults: sustained requests per second and the burst allowed on top
+#define SUBMISSION_RATE_PER_S 20
+#define SUBMISSION_BURST 10
+
+// A response this many times slower than the baseline latency counts as overload
+#define SUBMISSION_LATENCY_INFLATION 3
+
+// The baseline is the lower quartile of the latencies of the last this many 2xx replies
+#define SUBMISSION_LATENCY_WINDOW 32
+#define SUBMISSION_LATENCY_PERCENTILE 25
+
+// Baselines below this are raised to it, so a node answering within timer resolution does not
+// turn every few milliseconds of jitter into overload
+#define SUBMISSION_LATENCY_FLOOR_MS 5
+
+/**
+ * Admission control in front of the transport for a gateway submitting for many identities.
+ *
+ * Requests need a concurrency slot and a token. The concurrency limit follows AIMD: every request
+ * that completes in time raises it by 1/limit (about one per round trip at full load), while a
+ * 429, a 502, a 503, a 504, a transport error or a latency above SUBMISSION_LATENCY_INFLATION
+ * times the baseline halves it, at most once per baseline latency so one burst of failures
+ * counts once. The baseline is a low percentile of recent 2xx latencies only: error replies are
+ * often fast without saying anything about how loaded the node is.
+ * The token bucket caps the sustained request rate, and a 429 or 503 carrying Retry-After pauses
+ * all admissions until the node asks for traffic again.
+ *
+ * One limiter is shared by every BlockchainHandler talking to the same node and may be used
+ * from several threads.
+ */
+class SubmissionLimiter
+{
+  public:
+    /**
+     * @param rate_per_s Sustained requests per second; 0 disables the token bucket.
+     * @param burst Requests allowed back to back on top of the rate.
+     * @param initial_limit Concurrency limit to start from.
+     * @param max_limit Upper bound of the concurrency limit.
+     */
+    SubmissionLimiter(float rate_per_s = SUBMISSION_RATE_PER_S, uint32_t burst = SUBMISSION_BURST,
+                      uint32_t initial_limit = SUBMISSION_LIMIT_INITIAL, uint32_t max_limit = SUBMISSION_LIMIT_MAX);
+
+    /**
+     * Blocks until a request may be sent, then takes a slot and a token.
+     */
+    void acquire();
+
+    /**
+     * Takes a slot and a token if both are available at now_ms.
+     *
+     * @return 0 if admitted, otherwise the number of milliseconds worth waiting before trying again.
+     */
+    uint32_t tryAcquire(unsigned long now_ms);
+
+    /**
+     * Returns the slot taken by acquire and adjusts the limit to how the request went.
+     *
+     * @param httpCode The HTTP status, or a negative transport error.
+     * @param latencyMs The time from sending the request to the end of the response.
+     * @param retryAfterMs The delay requested by a Retry-After header, or 0.
+     */
+    void release(int httpCode, uint32_t latencyMs, uint32_t retryAfterMs = 0);
+    void release(unsigned long now_ms, int httpCode, uint32_t latencyMs, uint32_t retryAfterMs = 0);
+
+    /**
+     * Returns the current concurrency limit.
+     */
+    uint32_t limit() const;
+
+    /**
+     * Returns the number of requests admitted and not yet released.
+     */
+    uint32_t inFlight() const;
+
+    /**
+     * Returns the number of threads blocked in acquire (queue depth).
+     */
+    uint32_t queueDepth() const;
+
+    /**
+     * Returns the number of overload signals seen (429, 502-504, transport errors, inflated latency).
+     */
+    uint32_t overloads() const;
+
+    /**
+     * Parses a Retry-After value, either delta-seconds or an HTTP date.
+     *
+     * @param value The header value, may be empty.
+     * @param server_now_s The server's current time, to turn a date into a delay.
+     * @return The requested delay in milliseconds, or 0 if there is none.
+     */
+    static uint32_t parseRetryAfterMs(const char *value, int64_t server_now_s);
+
+  private:
+    uint32_t admit(unsigned long now_ms);
+    void decrease(unsigned long now_ms);
+    void addLatency(uint32_t latencyMs);
+
+    mutable std::mutex mutex_;
+    std::condition_variable released_;
+    float rate_per_ms_;
+    float burst_;
+    float tokens_;
+    float limit_;
+    float max_limit_;
+    uint32_t in_flight_ = 0;
+    uint32_t waiting_ = 0;
+    uint32_t overloads_ = 0;
+    uint32_t baseline_latency_ms_ = 0;
+    uint32_t latencies_[SUBMISSION_LATENCY_WINDOW] = {}; ///< Ring of recent 2xx latencies.
+    uint32_t latency_count_ = 0;
+    uint32_t latency_next_ = 0;
+    unsigned long last_refill_ms_;
+    unsigned long last_decrease_ms_ = 0;
+    unsigned long paused_until_ms_ = 0;
+    bool decreased_ = false;
+    bool paused_ = false;
+};
@@ -0,0 +1,115 @@
+#include "Trace.h"
+#include <cstring>
+
+static const size_t HEADER_SIZE = 5;
+
+// Timestamp, call, flags, HTTP code, status, attempt, stage timings and the three blob lengths
+static const size_t RECORD_FIXED_SIZE = 4 + 1 + 1 + 2 + 1 + 1 + 4 * TRACE_STAGE_COUNT + 3 * 4;
+
+static uint32_t readInteger(const uint8_t *p, int size)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < size; i++) {
+        value |= static_cast<uint32_t>(p[i]) << (8 * i);
+    }
+    return value;
+}
+
+void TraceWriter::writeInteger(uint32_t value, int size)
+{
+    uint8_t buffer[4];
+    for (int i = 0; i < size; i++) {
+        buffer[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+    writeBytes(buffer, size);
+}
+
+void TraceWriter::writeBytes(const void *data, size_t length)
+{
+    if (length > 0) {
+        bytes_ += out_.write(static_cast<const uint8_t *>(data), length);
+    }
+}
+
+void TraceWriter::write(const TraceRecord &record)
+{
+    if (!header_written_) {
+        writeBytes(TRACE_MAGIC, 4);
+        writeInteger(TRACE_VERSION, 1);
+        header_written_ = true;
+    }
+
+    writeInteger(RECORD_FIXED_SIZE + record.codeLength + record.requestLength + record.responseLength, 4);
+    writeInteger(record.timestampMs, 4);
+    writeInteger(static_cast<uint8_t>(record.call), 1);
+    writeInteger((record.local ? 0x01 : 0) | (record.compressed ? 0x02 : 0), 1);
+    writeInteger(static_cast<uint16_t>(record.httpCode), 2);
+    writeInteger(record.status, 1);
+    writeInteger(record.attempt, 1);
+    for (uint32_t us : record.stageUs) {
+        writeInteger(us, 4);
+    }
+    writeInteger(record.codeLength, 4);
+    writeBytes(record.code, record.codeLength);
+    writeInteger(record.requestLength, 4);
+    writeBytes(record.request, record.requestLength);
+    writeInteger(record.responseLength, 4);
+    writeBytes(record.response, record.responseLength);
+    records_++;
+}
+
+TraceReader::TraceReader(const uint8_t *data, size_t length) : data_(data), length_(length)
+{
+    valid_ = length >= HEADER_SIZE && memcmp(data, TRACE_MAGIC, 4) == 0 && data[4] == TRACE_VERSION;
+    position_ = HEADER_SIZE;
+}
+
+bool TraceReader::next(TraceRecord &record)
+{
+    if (!valid_ || position_ + 4 > length_) {
+        return false;
+    }
+    size_t size = readInteger(data_ + position_, 4);
+    if (size < RECORD_FIXED_SIZE || position_ + 4 + size > length_) {
+        return false;
+    }
+    const uint8_t *p = data_ + position_ + 4;
+    const uint8_t *end = p + size;
+    position_ += 4 + size;
+
+    record.timestampMs = readInteger(p, 4);
+    record.call = static_cast<PactCall>(p[4]);
+    record.local = p[5] & 0x01;
+    record.compressed = p[5] & 0x02;
+    record.httpCode = static_cast<int16_t>(readInteger(p + 6, 2));
+    record.status = p[8];
+    record.attempt = p[9];
+    p += 10;
+    for (uint32_t &us : record.stageUs) {
+        us = readInteger(p, 4);
+        p += 4;
+    }
+
+    // Each blob is length-prefixed; a length running past the record means corruption
+    const uint8_t *blobs[3];
+    size_t lengths[3];
+    for (int i = 0; i < 3; i++) {
+        if (p + 4 > end) {
+            return false;
+        }
+        lengths[i] = readInteger(p, 4);
+        p += 4;
+        if (lengths[i] > static_cast<size_t>(end - p)) {
+            return false;
+        }
+        blobs[i] = p;
+        p += lengths[i];
+    }
+    record.code = reinterpret_cast<const char *>(blobs[0]);
+    record.codeLength = lengths[0];
+    record.request = blobs[1];
+    record.requestLength = lengths[1];
+    record.response = blobs[2];
+    record.responseLength = lengths[2];
+    return true;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <Arduino.h>
+#include <cstddef>
+#include <cstdint>
+#include "PactCommands.h"
+
+#define TRACE_MAGIC "KDTR"
+#define TRACE_VERSION 2
+
+/**
+ * Pipeline stages timed for every traced command.
+ */
+enum TraceStage : uint8_t {
+    TRACE_STAGE_BUILD,     ///< Command object creation.
+    TRACE_STAGE_SIGN,      ///< Command serialization, hashing and signing.
+    TRACE_STAGE_SERIALIZE, ///< Request body serialization.
+    TRACE_STAGE_HTTP,      ///< POST until the response body has been read.
+    TRACE_STAGE_PARSE,     ///< Response decoding (/local only).
+    TRACE_STAGE_COUNT,
+};
+
+/**
+ * @struct TraceRecord
+ * @brief One command as captured: what was sent, what came back and how long each stage took.
+ *
+ * The code, request and response fields point into caller-owned memory: the handler's buffers
+ * while recording, the trace data while reading.
+ */
+struct TraceRecord {
+    uint32_t timestampMs = 0;                ///< millis() when the command started.
+    PactCall call = PactCall::RAW;           ///< The call executed.
+    bool local = false;                      ///< Posted to /local rather than /send.
+    bool compressed = false;                 ///< The response body is gzip or deflate encoded.
+    int16_t httpCode = 0;                    ///< HTTP status, negative for transport errors.
+    uint8_t status = 0;                      ///< Resulting BlockchainStatus.
+    uint8_t attempt = 1;                     ///< Submission attempt; retries only time HTTP and parse.
+    uint32_t stageUs[TRACE_STAGE_COUNT] = {}; ///< Duration of each stage in microseconds.
+    const char *code = nullptr;              ///< The Pact code.
+    size_t codeLength = 0;
+    const uint8_t *request = nullptr;        ///< The request body.
+    size_t requestLength = 0;
+    const uint8_t *response = nullptr;       ///< The response body as received.
+    size_t responseLength = 0;
+};
+
+/**
+ * Appends trace records to any Print, e.g. an open LittleFS/SD File on the device.
+ *
+ * The trace is a "KDTR" magic and version byte followed by length-prefixed little-endian records,
+ * so the file can be copied off the device and replayed natively.
+ */
+class TraceWriter
+{
+  public:
+    explicit TraceWriter(Print &out) : out_(out) {}
+
+    void write(const TraceRecord &record);
+
+    uint32_t records() const { return records_; }
+    size_t bytesWritten() const { return bytes_; }
+
+  private:
+    void writeInteger(uint32_t value, int size);
+    void writeBytes(const void *data, size_t length);
+
+    Print &out_;
+    bool header_written_ = false;
+    uint32_t records_ = 0;
+    size_t bytes_ = 0;
+};
+
+/**
+ * Reads records back from a trace held in memory.
+ */
+class TraceReader
+{
+  public:
+    TraceReader(const uint8_t *data, size_t length);
+
+    /**
+     * Returns true if the data starts with a trace header of a supported version.
+     */
+    bool valid() const { return valid_; }
+
+    /**
+     * Reads the next record.
+     *
+     * @return False at the end of the trace or if the remaining data is truncated.
+     */
+    bool next(TraceRecord &record);
+
+  private:
+    const uint8_t *data_;
+    size_t length_;
+    size_t position_ = 0;
+    bool valid_ = false;
+};
@@ -22,17 +22,16 @@ inline String getCurrentTimestamp() {
     return String(oss.str().c_str());
 }
 
-// Logging utility function to avoid 50 char limitation
+// Logging utility function to avoid 50 char limitation, printing chunks in place without copying
+inline void logLongString(const char *str, size_t len, size_t chunkSize = 50) {
+    size_t i = 0;
+    do {
+        size_t end = std::min(i + chunkSize, len);
+        Serial.printf("%.*s\n", (int)(end - i), str + i);
+        i = end;
+    } while (i < len);
+}
+
 inline void logLongString(const String &str, size_t chunkSize = 50) {
-    size_t len = str.length();
-    if (len <= chunkSize) {
-        Serial.printf("%s\n", str.c_str());
-    } else {
-        size_t i = 0;
-        while (i < len) {
-            size_t end = std::min(i + chunkSize, len);
-            Serial.printf("%s\n", str.substring(i, end).c_str());
-            i = end;
-        }
-    }
+    logLongString(str.c_str(), str.length(), chunkSize);
 }
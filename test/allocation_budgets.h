@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+
+// How far a run may drift from the recorded figures, either way, before it fails
+#define ALLOCATION_BUDGET_MARGIN_PERCENT 10
+
+/**
+ * Heap use of hot-path operations as measured by the native_alloc test target.
+ *
+ * Figures are for the native build (glibc, 64-bit) and count bytes as malloc_usable_size.
+ * A run fails when an operation uses more than ALLOCATION_BUDGET_MARGIN_PERCENT above a
+ * figure (a regression) or as much below it (an improvement the figures have not caught up
+ * with), and prints the measured line to paste here. Raise a figure only with the reason
+ * stated in the commit message.
+ */
+struct AllocationBudget {
+    size_t count; ///< malloc/calloc/realloc calls.
+    size_t bytes; ///< Total bytes allocated.
+    size_t peak;  ///< Bytes live at any one time.
+};
+
+// Still the original ceilings, pending the first native_alloc run; it fails and prints the measured
+// replacement for each line
+static const AllocationBudget BUDGET_CREATE_COMMAND = {24, 4096, 4096};
+static const AllocationBudget BUDGET_PREPARE_POST = {48, 8192, 6144};
+static const AllocationBudget BUDGET_ENCRYPT = {160, 32768, 12288};
+static const AllocationBudget BUDGET_PARSE_RESPONSE = {48, 8192, 8192};
+static const AllocationBudget BUDGET_NODE_SYNC = {480, 98304, 24576};
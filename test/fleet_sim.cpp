@@ -0,0 +1,327 @@
+#include "fleet_sim.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <queue>
+#include <string>
+#include "BlockchainHandler.h"
+#include "test_fixtures.h"
+
+static const uint8_t FLEET_CHAIN_ID = 19;
+static const char FLEET_SERVER_URL[] = "http://fleet.sim/chain/19/pact/api/v1/";
+// Height of the block at time 0
+static const uint32_t FLEET_HEIGHT_BASE = 4000000;
+// millis() reads this at time 0; a handler treats a header received at 0 ms as none at all
+static const uint64_t FLEET_CLOCK_BASE_MS = 1000;
+
+// A node as the simulated contract and mempool see it
+struct SimNode {
+    bool registered = false;
+    int64_t registerAtMs = -1; // Block its insert-my-node lands in
+    int64_t lastBeaconMs = 0;  // Block its last beacon landed in
+    int64_t dueSinceMs = 0;
+    std::vector<std::pair<int64_t, std::string>> pending; // Accepted update-sent: landing block and request key
+    std::string landedKey;                                // Request key of the last transaction that landed
+};
+
+class FleetSimulation
+{
+  public:
+    FleetSimulation(const FleetConfig &config, FleetReport &report);
+
+    void run();
+
+  private:
+    MockHttpResponse respond(const String &url, const String &body);
+    void settle(SimNode &node, int64_t nowMs);
+    void advance(uint32_t ms);
+    bool draw(float probability) { return probability > 0 && uniform_(rng_) < probability; }
+    int64_t blockStart(int64_t ms) const { return ms / block_ms_ * block_ms_; }
+    uint32_t heightAt(int64_t ms) const { return FLEET_HEIGHT_BASE + static_cast<uint32_t>(ms / block_ms_); }
+
+    const FleetConfig &config_;
+    FleetReport &report_;
+    std::mt19937 rng_;
+    std::uniform_real_distribution<float> uniform_{0.0f, 1.0f};
+    int64_t block_ms_;
+    int64_t due_ms_;
+    std::vector<SimNode> nodes_;
+    std::vector<std::unique_ptr<BlockchainHandler>> handlers_;
+    std::vector<std::string> node_ids_;
+    size_t current_ = 0;
+    int64_t now_ms_ = 0;
+};
+
+// Returns the string value following marker in a request body, e.g. a request key
+static std::string valueAfter(const String &body, const char *marker)
+{
+    size_t start = body.find(marker);
+    if (start == std::string::npos) {
+        return "";
+    }
+    start += strlen(marker);
+    size_t end = body.find('"', start);
+    return end == std::string::npos ? "" : body.substr(start, end - start);
+}
+
+FleetSimulation::FleetSimulation(const FleetConfig &config, FleetReport &report)
+    : config_(config)
+    , report_(report)
+    , rng_(config.seed)
+    , block_ms_(static_cast<int64_t>(config.blockTimeS) * 1000)
+    , due_ms_(static_cast<int64_t>(config.dueIntervalS) * 1000)
+    , nodes_(config.nodes)
+{
+    for (uint32_t i = 0; i < config.nodes; i++) {
+        char publicKey[65], privateKey[65], nodeId[16];
+        snprintf(publicKey, sizeof(publicKey), "%064x", i + 1);
+        snprintf(privateKey, sizeof(privateKey), "%064x", ~i);
+        snprintf(nodeId, sizeof(nodeId), "!%08x", i);
+        handlers_.emplace_back(new BlockchainHandler(publicKey, privateKey, true, FLEET_SERVER_URL));
+        handlers_.back()->setRetrySleep([this](uint32_t ms) { advance(ms); });
+        handlers_.back()->setBeaconInterval(config.beaconIntervalS);
+        node_ids_.push_back(nodeId);
+
+        // Registered nodes sent their last beacon at some point within the last due interval
+        SimNode &node = nodes_[i];
+        if (uniform_(rng_) < config.registeredFraction) {
+            node.registered = true;
+            node.lastBeaconMs = -static_cast<int64_t>(uniform_(rng_) * due_ms_);
+            node.dueSinceMs = node.lastBeaconMs + due_ms_;
+        }
+    }
+    report_.nodes = config.nodes;
+    report_.durationS = config.durationS;
+    report_.bucketS = config.bucketS;
+    report_.load.assign(config.durationS / config.bucketS + 1, 0);
+}
+
+void FleetSimulation::advance(uint32_t ms)
+{
+    now_ms_ += ms;
+    MockClock::set((FLEET_CLOCK_BASE_MS + now_ms_) * 1000);
+}
+
+void FleetSimulation::settle(SimNode &node, int64_t nowMs)
+{
+    int64_t tip = blockStart(nowMs);
+    if (node.registerAtMs >= 0 && node.registerAtMs <= tip) {
+        // A new node is due at once
+        node.registered = true;
+        node.lastBeaconMs = node.registerAtMs - due_ms_;
+        node.dueSinceMs = node.registerAtMs;
+        node.registerAtMs = -1;
+        report_.inserts++;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < node.pending.size(); i++) {
+        std::pair<int64_t, std::string> &tx = node.pending[i];
+        if (tx.first > tip) {
+            node.pending[kept++] = tx;
+            continue;
+        }
+        // The contract refuses an update-sent that is not due
+        if (node.registered && tx.first >= node.lastBeaconMs + due_ms_) {
+            report_.latenciesMs.push_back(static_cast<uint32_t>(tx.first - node.dueSinceMs));
+            report_.beacons++;
+            node.lastBeaconMs = tx.first;
+            node.dueSinceMs = tx.first + due_ms_;
+        } else {
+            report_.rejected++;
+        }
+        node.landedKey = tx.second;
+    }
+    node.pending.resize(kept);
+}
+
+MockHttpResponse FleetSimulation::respond(const String &url, const String &body)
+{
+    // Load is counted when the request starts; the node answers from its state once the request arrived
+    size_t bucket = static_cast<size_t>(now_ms_ / 1000 / config_.bucketS);
+    if (bucket < report_.load.size()) {
+        report_.load[bucket]++;
+    }
+    uint32_t latency = config_.latencyMs;
+    if (config_.latencyJitterMs > 0) {
+        latency += static_cast<uint32_t>(std::exponential_distribution<float>(1.0f / config_.latencyJitterMs)(rng_));
+    }
+    advance(latency);
+
+    SimNode &node = nodes_[current_];
+    settle(node, now_ms_);
+    bool error = draw(config_.errorRate);
+    if (error) {
+        report_.errors++;
+    }
+    String height = String(heightAt(now_ms_));
+
+    if (url.indexOf("/poll") >= 0) {
+        report_.requests[FLEET_POLL]++;
+        if (error) {
+            return {503, ""};
+        }
+        std::string key = valueAfter(body, "[\"");
+        if (!key.empty() && key == node.landedKey) {
+            return {200, "{\"" + key + "\":{\"result\":{\"status\":\"success\"}}}"};
+        }
+        return {200, "{}"};
+    }
+
+    if (url.indexOf("/send") >= 0) {
+        report_.requests[FLEET_SEND]++;
+        std::string key = valueAfter(body, "\"hash\":\"");
+        bool known = key == node.landedKey;
+        for (const std::pair<int64_t, std::string> &tx : node.pending) {
+            known = known || tx.second == key;
+        }
+        // Chainweb turns away a request key it already holds or has already included
+        if (known && !error) {
+            return {400, "Validation failed: Transaction already exists on chain"};
+        }
+        if (!known && (!error || draw(config_.acceptedOnErrorRate))) {
+            if (body.find("insert-my-node") != std::string::npos) {
+                if (!node.registered && node.registerAtMs < 0) {
+                    node.registerAtMs = blockStart(now_ms_) + block_ms_;
+                }
+            } else {
+                node.pending.push_back({blockStart(now_ms_) + block_ms_, key});
+            }
+        }
+        if (error) {
+            return {503, ""};
+        }
+        return {200, "{\"requestKeys\":[\"" + key + "\"]}"};
+    }
+
+    report_.requests[FLEET_LOCAL]++;
+    if (error) {
+        return {503, ""};
+    }
+    if (!node.registered) {
+        return {200, "{\"result\":{\"status\":\"failure\",\"error\":{\"message\":\"row not found\"}},"
+                     "\"metaData\":{\"blockHeight\":" + height + "}}"};
+    }
+    bool due = blockStart(now_ms_) >= node.lastBeaconMs + due_ms_;
+    return {200, "{\"result\":{\"status\":\"success\",\"data\":{\"send\":" + String(due ? "true" : "false") +
+                     ",\"pubkeyd\":\"" + TEST_PUBLIC_KEY_BASE64 + "\"}},\"metaData\":{\"blockHeight\":" + height + "}}"};
+}
+
+void FleetSimulation::run()
+{
+    typedef std::pair<int64_t, size_t> Event;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    for (size_t i = 0; i < nodes_.size(); i++) {
+        int64_t boot = static_cast<int64_t>(uniform_(rng_) * config_.bootSpreadS * 1000);
+        events.push({boot, i});
+    }
+
+    HTTPClient::setResponder([this](const String &url, const String &body) { return respond(url, body); });
+    int64_t durationMs = static_cast<int64_t>(config_.durationS) * 1000;
+    while (!events.empty() && events.top().first < durationMs) {
+        Event event = events.top();
+        events.pop();
+        current_ = event.second;
+        settle(nodes_[current_], event.first);
+        BlockchainHandler &handler = *handlers_[current_];
+
+        // Headers arrive as blocks land; only the latest one matters to a handler
+        if (config_.headerFeed) {
+            now_ms_ = blockStart(event.first);
+            advance(0);
+            handler.onBlockHeader(FLEET_CHAIN_ID, heightAt(event.first));
+        }
+        now_ms_ = event.first;
+        advance(0);
+
+        bool online = !draw(config_.wifiDropoutRate);
+        WiFi.setStatus(online ? WL_CONNECTED : WL_DISCONNECTED);
+        report_.wifiDown += online ? 0 : 1;
+        int32_t intervalMs = handler.performNodeSync(node_ids_[current_]);
+        report_.syncs++;
+
+        uint32_t waitMs = config_.scheduler ? config_.scheduler(current_, intervalMs, rng_) : intervalMs;
+        events.push({now_ms_ + waitMs, current_});
+    }
+    HTTPClient::setResponder(nullptr);
+
+    // Transactions sent before the end land if their block does
+    for (SimNode &node : nodes_) {
+        settle(node, durationMs);
+    }
+    std::sort(report_.latenciesMs.begin(), report_.latenciesMs.end());
+}
+
+FleetReport simulateFleet(const FleetConfig &config)
+{
+    FleetReport report;
+    if (config.nodes == 0 || config.bucketS == 0 || config.blockTimeS == 0) {
+        return report;
+    }
+
+    uint8_t wifiStatus = WiFi.status();
+    Serial.setMuted(true);
+    auto start = std::chrono::steady_clock::now();
+    {
+        FleetSimulation simulation(config, report);
+        simulation.run();
+    }
+    report.wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    Serial.setMuted(false);
+    MockClock::release();
+    WiFi.setStatus(wifiStatus);
+    return report;
+}
+
+uint32_t FleetReport::peakLoad() const
+{
+    return load.empty() ? 0 : *std::max_element(load.begin(), load.end());
+}
+
+double FleetReport::meanLoad() const
+{
+    // The last bucket is usually cut short by the end of the run
+    size_t full = durationS / bucketS;
+    if (full == 0) {
+        return 0;
+    }
+    uint64_t total = 0;
+    for (size_t i = 0; i < full; i++) {
+        total += load[i];
+    }
+    return static_cast<double>(total) / full;
+}
+
+uint32_t FleetReport::latencyPercentileMs(double percentile) const
+{
+    if (latenciesMs.empty()) {
+        return 0;
+    }
+    size_t rank = static_cast<size_t>(percentile / 100.0 * latenciesMs.size());
+    return latenciesMs[rank < latenciesMs.size() ? rank : latenciesMs.size() - 1];
+}
+
+void printFleetReport(const FleetReport &report, bool series)
+{
+    Serial.printf("Fleet: %u nodes, %.1f h simulated in %.2f s\n", (unsigned)report.nodes, report.durationS / 3600.0,
+                  report.wallS);
+    Serial.printf("Syncs: %llu (%llu with WiFi down); requests: %llu /local, %llu /send, %llu /poll; %llu answered 503\n",
+                  (unsigned long long)report.syncs, (unsigned long long)report.wifiDown,
+                  (unsigned long long)report.requests[FLEET_LOCAL], (unsigned long long)report.requests[FLEET_SEND],
+                  (unsigned long long)report.requests[FLEET_POLL], (unsigned long long)report.errors);
+    Serial.printf("Beacons landed: %llu, rejected as not due: %llu, nodes registered: %llu\n",
+                  (unsigned long long)report.beacons, (unsigned long long)report.rejected,
+                  (unsigned long long)report.inserts);
+    Serial.printf("Load per %u s: mean %.1f, peak %u (%.1f requests/s)\n", (unsigned)report.bucketS, report.meanLoad(),
+                  (unsigned)report.peakLoad(), static_cast<double>(report.peakLoad()) / report.bucketS);
+    Serial.printf("Beacon latency: p50 %.1f s, p90 %.1f s, p99 %.1f s, max %.1f s\n",
+                  report.latencyPercentileMs(50) / 1000.0, report.latencyPercentileMs(90) / 1000.0,
+                  report.latencyPercentileMs(99) / 1000.0, report.latencyPercentileMs(100) / 1000.0);
+    if (series) {
+        for (size_t i = 0; i < report.load.size(); i++) {
+            Serial.printf("%7u s %u\n", (unsigned)(i * report.bucketS), (unsigned)report.load[i]);
+        }
+    }
+}
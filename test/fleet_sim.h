@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <vector>
+
+/**
+ * Picks how long a node waits before its next sync, given the interval performNodeSync returned.
+ * Unset, the node waits exactly that interval, as the firmware loop does.
+ */
+using FleetScheduler = std::function<uint32_t(size_t node, int32_t intervalMs, std::mt19937 &rng)>;
+
+/**
+ * @struct FleetConfig
+ * @brief A fleet of nodes and the simulated Chainweb they sync against.
+ */
+struct FleetConfig {
+    uint32_t nodes = 1000;
+    uint32_t durationS = 3 * 3600;    ///< Fleet time to simulate.
+    uint32_t bootSpreadS = 0;         ///< Nodes boot uniformly within this window; 0 boots them all at once.
+    uint32_t blockTimeS = 30;         ///< Time between blocks; a transaction lands in the block after it is sent.
+    uint32_t dueIntervalS = 3600;     ///< Time after a beacon lands before get-my-node reports the node due again.
+    uint32_t beaconIntervalS = 0;     ///< Interval the handlers assume (see BlockchainHandler::setBeaconInterval).
+    float registeredFraction = 1.0f;  ///< Nodes registered before the start; the others insert themselves.
+    float errorRate = 0.0f;           ///< Probability that a request is answered 503.
+    float acceptedOnErrorRate = 0.5f; ///< Probability that a /send answered 503 was accepted nonetheless.
+    float wifiDropoutRate = 0.0f;     ///< Probability that WiFi is down when a node syncs.
+    uint32_t latencyMs = 150;         ///< Round trip of every request.
+    uint32_t latencyJitterMs = 100;   ///< Mean of the exponentially distributed extra latency.
+    bool headerFeed = false;          ///< Nodes follow block headers (see BlockchainHandler::onBlockHeader).
+    uint32_t bucketS = 60;            ///< Width of the load-over-time buckets.
+    uint32_t seed = 1;                ///< Seed of every random draw, so runs are reproducible.
+    FleetScheduler scheduler;
+};
+
+// Request counters of FleetReport, by endpoint
+enum FleetEndpoint { FLEET_LOCAL, FLEET_SEND, FLEET_POLL, FLEET_ENDPOINT_COUNT };
+
+/**
+ * @struct FleetReport
+ * @brief Endpoint load and beacon latency of a simulated run.
+ */
+struct FleetReport {
+    uint32_t nodes = 0;
+    uint32_t durationS = 0;
+    uint32_t bucketS = 0;
+    uint64_t syncs = 0;                            ///< performNodeSync calls.
+    uint64_t wifiDown = 0;                         ///< Syncs made while WiFi was down.
+    uint64_t requests[FLEET_ENDPOINT_COUNT] = {};  ///< Requests received per endpoint.
+    uint64_t errors = 0;                           ///< Requests answered 503.
+    uint64_t inserts = 0;                          ///< Nodes registered during the run.
+    uint64_t beacons = 0;                          ///< update-sent transactions that landed while the node was due.
+    uint64_t rejected = 0;                         ///< update-sent transactions that landed when the node was not due.
+    std::vector<uint32_t> load;                    ///< Requests started in each bucket.
+    std::vector<uint32_t> latenciesMs;             ///< Sorted beacon latencies: from becoming due to the beacon landing.
+    double wallS = 0;                              ///< Real time the simulation took.
+
+    /**
+     * Returns the highest bucket of load.
+     */
+    uint32_t peakLoad() const;
+
+    /**
+     * Returns the mean bucket of load.
+     */
+    double meanLoad() const;
+
+    /**
+     * Returns a beacon latency percentile (0-100) in milliseconds, or 0 without beacons.
+     */
+    uint32_t latencyPercentileMs(double percentile) const;
+};
+
+/**
+ * Runs a fleet of real BlockchainHandlers against a simulated Chainweb on a virtual clock.
+ *
+ * Each node is a handler with its own keys, synced by performNodeSync as the firmware loop does:
+ * the next sync starts the returned interval (or the scheduler's choice) after the previous one
+ * ended. Syncs are discrete events run to completion at their start time; every request inside
+ * one advances the node's virtual time by its latency, and retry backoff advances it too.
+ * MockClock carries that time to millis() inside the handler.
+ *
+ * The simulated node answers get-my-node from per-node contract state: unregistered nodes fail,
+ * registered nodes are due dueIntervalS after their last beacon landed. Transactions sent with
+ * update-sent and insert-my-node land in the next block, /poll reports them once they have, and
+ * resending an accepted command is acknowledged without landing it twice.
+ *
+ * Serial output is muted while the fleet runs.
+ */
+FleetReport simulateFleet(const FleetConfig &config);
+
+/**
+ * Prints a run's totals, peak and mean load and beacon latency percentiles.
+ *
+ * @param series Also print the load of every bucket.
+ */
+void printFleetReport(const FleetReport &report, bool series = false);
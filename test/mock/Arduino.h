@@ -5,8 +5,12 @@
 #include <sstream>
 #include <iomanip>
 #include <chrono>
+#include <thread>
 #include <cstdio>
 #include <cstdarg>
+#include <functional>
+#include <utility>
+#include <vector>
 
 // Constants
 #define WL_CONNECTED 3
@@ -14,15 +18,37 @@
 #define HTTP_CODE_NO_CONTENT 204
 #define HEX 16
 
+// Virtual time for simulations: while set, millis(), micros() and delay() follow it instead of the system clock
+struct MockClock {
+    static void set(uint64_t us) { nowUs() = us; active() = true; }
+    static void release() { active() = false; }
+    static bool& active() { static bool value = false; return value; }
+    static uint64_t& nowUs() { static uint64_t value = 0; return value; }
+};
+
 // Arduino timing functions
 inline unsigned long millis() {
+    if (MockClock::active()) {
+        return MockClock::nowUs() / 1000;
+    }
     using namespace std::chrono;
     return duration_cast<milliseconds>(
         system_clock::now().time_since_epoch()
     ).count();
 }
 
+inline void delay(unsigned long ms) {
+    if (MockClock::active()) {
+        MockClock::nowUs() += static_cast<uint64_t>(ms) * 1000;
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
 inline unsigned long micros() {
+    if (MockClock::active()) {
+        return MockClock::nowUs();
+    }
     using namespace std::chrono;
     return duration_cast<microseconds>(
         system_clock::now().time_since_epoch()
@@ -57,6 +83,10 @@ public:
         return *this;
     }
 
+    void remove(size_t index) {
+        erase(index);
+    }
+
     int indexOf(const String& str) const {
         size_t pos = find(str);
         return pos == npos ? -1 : pos;
@@ -78,23 +108,51 @@ public:
     }
 };
 
+// Print/Stream interfaces
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--) {
+            n += write(*buffer++);
+        }
+        return n;
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
 // Serial interface
 class SerialClass {
 public:
     void print(const char* str) {
-        printf("%s", str);
+        if (!muted_) printf("%s", str);
     }
     
     void println(const char* str) {
-        printf("%s\n", str);
+        if (!muted_) printf("%s\n", str);
     }
     
     void printf(const char* format, ...) {
+        if (muted_) return;
         va_list args;
         va_start(args, format);
         vprintf(format, args);
         va_end(args);
     }
+
+    // Silences output, e.g. while simulating thousands of nodes
+    void setMuted(bool muted) { muted_ = muted; }
+
+private:
+    bool muted_ = false;
 };
 
 // WiFi interface
@@ -107,14 +165,86 @@ private:
 };
 
 // HTTPClient interface
+// Scripted server reply; without a responder every request answers 204 with no body
+// Replays a response body as the connection stream, like the WiFiClient behind HTTPClient::getStreamPtr()
+class MockResponseStream : public Stream {
+public:
+    void reset(const String& body) { body_ = body; position_ = 0; }
+    int available() override { return body_.size() - position_; }
+    int read() override { return position_ < body_.size() ? static_cast<uint8_t>(body_[position_++]) : -1; }
+    int peek() override { return position_ < body_.size() ? static_cast<uint8_t>(body_[position_]) : -1; }
+    size_t write(uint8_t c) override { return 0; }
+
+private:
+    String body_;
+    size_t position_ = 0;
+};
+
+struct MockHttpResponse {
+    int code;
+    String body;
+    std::vector<std::pair<String, String>> headers;
+};
+
 class HTTPClient {
 public:
-    bool begin(const String& url) { return true; }
+    using Responder = std::function<MockHttpResponse(const String& url, const String& body)>;
+
+    // Installs the responder used by every HTTPClient; pass nullptr to restore the default
+    static void setResponder(Responder responder) { responder_() = responder; }
+
+    bool begin(const String& url) { url_ = url; return true; }
     void addHeader(const char* name, const char* value) {}
     void setTimeout(uint32_t timeout) {}
-    int POST(const String& payload) { return HTTP_CODE_NO_CONTENT; }
-    String getString() { return ""; }
+    void setConnectTimeout(int32_t timeout) {}
+    int POST(const String& payload) {
+        if (!responder_()) {
+            return HTTP_CODE_NO_CONTENT;
+        }
+        MockHttpResponse response = responder_()(url_, payload);
+        response_ = response.body;
+        headers_ = response.headers;
+        return response.code;
+    }
+    int POST(uint8_t* payload, size_t size) { return POST(String(std::string(reinterpret_cast<char*>(payload), size))); }
+    int GET() {
+        if (!responder_()) {
+            return HTTP_CODE_NO_CONTENT;
+        }
+        MockHttpResponse response = responder_()(url_, "");
+        response_ = response.body;
+        headers_ = response.headers;
+        stream_.reset(response_);
+        return response.code;
+    }
+    Stream* getStreamPtr() { return &stream_; }
+    bool connected() { return stream_.available() > 0; }
+    String getString() { return response_; }
+    void collectHeaders(const char* headerKeys[], size_t count) {}
+    String header(const char* name) {
+        for (const auto& header : headers_) {
+            if (strcasecmp(header.first.c_str(), name) == 0) {
+                return header.second;
+            }
+        }
+        return "";
+    }
+    int writeToStream(Stream* stream) {
+        String body = getString();
+        return stream->write(reinterpret_cast<const uint8_t*>(body.data()), body.size());
+    }
     void end() {}
+
+private:
+    static Responder& responder_() {
+        static Responder responder;
+        return responder;
+    }
+
+    String url_;
+    String response_;
+    std::vector<std::pair<String, String>> headers_;
+    MockResponseStream stream_;
 };
 
 // Global instances
@@ -0,0 +1,182 @@
+#ifdef ALLOC_ACCOUNTING
+#include <unity.h>
+#include <malloc.h>
+#include "BlockchainHandler.h"
+#include "allocation_budgets.h"
+#include "test_fixtures.h"
+
+// Interposes the glibc allocator so every heap allocation, including those made through
+// operator new, ArduinoJson and mbedTLS, is counted while tracking is enabled.
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+}
+
+struct AllocationStats {
+    size_t count;
+    size_t bytes;
+    size_t live;
+    size_t peak;
+};
+
+static AllocationStats g_stats;
+static bool g_tracking = false;
+
+static void recordAllocation(void *ptr)
+{
+    if (!g_tracking || !ptr) {
+        return;
+    }
+    size_t size = malloc_usable_size(ptr);
+    g_stats.count++;
+    g_stats.bytes += size;
+    g_stats.live += size;
+    if (g_stats.live > g_stats.peak) {
+        g_stats.peak = g_stats.live;
+    }
+}
+
+static void recordRelease(void *ptr)
+{
+    if (!g_tracking || !ptr) {
+        return;
+    }
+    // Memory allocated before tracking started may be released during it
+    size_t size = malloc_usable_size(ptr);
+    g_stats.live = g_stats.live > size ? g_stats.live - size : 0;
+}
+
+extern "C" void *malloc(size_t size)
+{
+    void *ptr = __libc_malloc(size);
+    recordAllocation(ptr);
+    return ptr;
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    void *ptr = __libc_calloc(count, size);
+    recordAllocation(ptr);
+    return ptr;
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    recordRelease(ptr);
+    void *moved = __libc_realloc(ptr, size);
+    recordAllocation(moved);
+    return moved;
+}
+
+extern "C" void free(void *ptr)
+{
+    recordRelease(ptr);
+    __libc_free(ptr);
+}
+
+// Reaches the handler's private pipeline stages
+struct BlockchainHandlerTestAccess {
+    static JsonDocument createCommandObject(BlockchainHandler &handler, const String &command)
+    {
+        return handler.createCommandObject(command);
+    }
+    static JsonDocument preparePostObject(BlockchainHandler &handler, const JsonDocument &cmdObject, const String &type)
+    {
+        return handler.preparePostObject(cmdObject, type);
+    }
+    static BlockchainStatus parseBlockchainResponse(BlockchainHandler &handler, const std::string &response, PactCall call)
+    {
+        return handler.parseBlockchainResponse(response.c_str(), response.length(), call);
+    }
+};
+
+template <typename Operation> static AllocationStats measure(Operation &&operation)
+{
+    g_stats = {0, 0, 0, 0};
+    g_tracking = true;
+    operation();
+    g_tracking = false;
+    return g_stats;
+}
+
+// True if measured is within ALLOCATION_BUDGET_MARGIN_PERCENT of recorded
+static bool withinMargin(size_t measured, size_t recorded)
+{
+    return measured * 100 <= recorded * (100 + ALLOCATION_BUDGET_MARGIN_PERCENT) &&
+           measured * 100 >= recorded * (100 - ALLOCATION_BUDGET_MARGIN_PERCENT);
+}
+
+static void assertWithinBudget(const char *name, const char *budgetName, const AllocationStats &stats,
+                               const AllocationBudget &budget)
+{
+    Serial.printf("%s: %zu allocations (budget %zu), %zu bytes (budget %zu), peak %zu bytes (budget %zu)\n", name,
+                  stats.count, budget.count, stats.bytes, budget.bytes, stats.peak, budget.peak);
+    bool within = withinMargin(stats.count, budget.count) && withinMargin(stats.bytes, budget.bytes) &&
+                  withinMargin(stats.peak, budget.peak);
+    if (!within) {
+        Serial.printf("Measured: static const AllocationBudget %s = {%zu, %zu, %zu};\n", budgetName, stats.count,
+                      stats.bytes, stats.peak);
+    }
+    TEST_ASSERT_TRUE_MESSAGE(within, name);
+}
+
+#define ASSERT_WITHIN_BUDGET(name, stats, budget) assertWithinBudget(name, #budget, stats, budget)
+
+static const std::string ALLOC_PUB_KEY(64, 'a');
+static const std::string ALLOC_PRIV_KEY(64, 'b');
+
+void test_allocations_command_pipeline(void) {
+    BlockchainHandler handler(ALLOC_PUB_KEY, ALLOC_PRIV_KEY, true, "http://test.url/chain/19/pact/api/v1/");
+    String code = "(free.mesh03.get-my-node)";
+
+    AllocationStats stats = measure([&]() {
+        JsonDocument cmdObject = BlockchainHandlerTestAccess::createCommandObject(handler, code);
+    });
+    ASSERT_WITHIN_BUDGET("createCommandObject", stats, BUDGET_CREATE_COMMAND);
+
+    JsonDocument cmdObject = BlockchainHandlerTestAccess::createCommandObject(handler, code);
+    stats = measure([&]() {
+        JsonDocument postObject = BlockchainHandlerTestAccess::preparePostObject(handler, cmdObject, "local");
+    });
+    ASSERT_WITHIN_BUDGET("preparePostObject", stats, BUDGET_PREPARE_POST);
+
+    stats = measure([&]() {
+        BlockchainStatus status =
+            BlockchainHandlerTestAccess::parseBlockchainResponse(handler, TEST_GET_MY_NODE_READY_RESPONSE, PactCall::GET_MY_NODE);
+        TEST_ASSERT_EQUAL(BlockchainStatus::READY, status);
+    });
+    ASSERT_WITHIN_BUDGET("parseBlockchainResponse", stats, BUDGET_PARSE_RESPONSE);
+}
+
+void test_allocations_encrypt(void) {
+    EncryptionHandler handler;
+    AllocationStats stats = measure([&]() {
+        String secret = handler.encrypt(TEST_PUBLIC_KEY_BASE64, "1a2b3c4d");
+        TEST_ASSERT_TRUE(secret.length() > 0);
+    });
+    ASSERT_WITHIN_BUDGET("encrypt", stats, BUDGET_ENCRYPT);
+}
+
+void test_allocations_node_sync(void) {
+    WiFi.setStatus(WL_CONNECTED);
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        if (url.indexOf("/local") >= 0) {
+            return {200, TEST_GET_MY_NODE_READY_RESPONSE};
+        }
+        return {200, TEST_SEND_RESPONSE};
+    });
+
+    BlockchainHandler handler(ALLOC_PUB_KEY, ALLOC_PRIV_KEY, true, "http://test.url/chain/19/pact/api/v1/");
+    bool beaconSent = false;
+    AllocationStats stats = measure([&]() {
+        handler.performNodeSync(
+            "node", []() -> uint32_t { return 0x1a2b3c4d; }, [&](uint32_t) { beaconSent = true; });
+    });
+    HTTPClient::setResponder(nullptr);
+
+    TEST_ASSERT_TRUE(beaconSent);
+    ASSERT_WITHIN_BUDGET("performNodeSync", stats, BUDGET_NODE_SYNC);
+}
+#endif
@@ -0,0 +1,51 @@
+#include <unity.h>
+#include "Arena.h"
+#include "BlockchainHandler.h"
+
+
+void test_arena_allocation(void) {
+    static uint8_t buffer[256];
+    Arena arena(buffer, sizeof(buffer));
+
+    void *first = arena.allocate(100);
+    TEST_ASSERT_NOT_NULL(first);
+    TEST_ASSERT_TRUE(arena.extend(first, 150));
+    TEST_ASSERT_NULL(arena.allocate(200));
+    TEST_ASSERT_TRUE(arena.exhausted());
+
+    arena.reset();
+    TEST_ASSERT_FALSE(arena.exhausted());
+    TEST_ASSERT_EQUAL(0, arena.used());
+    TEST_ASSERT_TRUE(arena.highWater() >= 150);
+
+    // Rewinding releases only what came after the mark
+    void *kept = arena.allocate(64);
+    size_t mark = arena.mark();
+    TEST_ASSERT_NOT_NULL(arena.allocate(160));
+    TEST_ASSERT_NULL(arena.allocate(64));
+    arena.rewind(mark);
+    TEST_ASSERT_FALSE(arena.exhausted());
+    TEST_ASSERT_EQUAL(mark, arena.used());
+    TEST_ASSERT_FALSE(arena.extend(kept, 80));
+    TEST_ASSERT_NOT_NULL(arena.allocate(160));
+}
+
+void test_arena_backed_command(void) {
+    WiFi.setStatus(WL_CONNECTED);
+    std::string valid_pub_key(64, 'a');
+    std::string valid_priv_key(64, 'b');
+
+    static uint8_t buffer[BLOCKCHAIN_ARENA_MIN_SIZE];
+    Arena arena(buffer, sizeof(buffer));
+    BlockchainHandler handler(valid_pub_key, valid_priv_key, true, "http://test.url", &arena);
+    TEST_ASSERT_EQUAL(BlockchainStatus::EMPTY_RESPONSE,
+                      handler.executeBlockchainCommand("send", "(free.mesh03.insert-my-node \"node\")"));
+    TEST_ASSERT_TRUE(arena.highWater() > 0);
+
+    // An arena too small for the command fails hard instead of growing the heap
+    static uint8_t tiny[128];
+    Arena tinyArena(tiny, sizeof(tiny));
+    BlockchainHandler tinyHandler(valid_pub_key, valid_priv_key, true, "http://test.url", &tinyArena);
+    TEST_ASSERT_EQUAL(BlockchainStatus::OUT_OF_MEMORY,
+                      tinyHandler.executeBlockchainCommand("send", "(free.mesh03.insert-my-node \"node\")"));
+}
@@ -0,0 +1,315 @@
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include "BlockchainHandler.h"
+#include "Blake2bBatch.h"
+#include "Ed25519.h"
+#include "Ed25519Fast.h"
+#include "Inflate.h"
+#include "NonceGenerator.h"
+#include "SecretDecryptor.h"
+#include "fleet_sim.h"
+#include "test_fixtures.h"
+#include "trace_replay.h"
+#include "utils.h"
+
+// Benchmarks report their timings and only assert on correctness, so they stay stable on shared CI runners.
+
+static const int BENCH_ITERATIONS = 10000;
+
+void test_benchmark_nonce_generation(void) {
+    unsigned long start = micros();
+    size_t checksum = 0;
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        checksum += getCurrentTimestamp().length();
+    }
+    unsigned long legacy_us = micros() - start;
+
+    NonceGenerator generator;
+    char nonce[NONCE_BUFFER_SIZE];
+    start = micros();
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        checksum += generator.next(nonce);
+    }
+    unsigned long generator_us = micros() - start;
+
+    Serial.printf("getCurrentTimestamp: %lu us / %d calls\n", legacy_us, BENCH_ITERATIONS);
+    Serial.printf("NonceGenerator::next: %lu us / %d calls\n", generator_us, BENCH_ITERATIONS);
+    TEST_ASSERT_TRUE(checksum > 0);
+    TEST_ASSERT_EQUAL(BENCH_ITERATIONS, generator.counter());
+}
+
+void test_benchmark_compressed_response(void) {
+    const int iterations = BENCH_ITERATIONS / 10;
+    JsonDocument doc;
+    unsigned long start = micros();
+    for (int i = 0; i < iterations; i++) {
+        deserializeJson(doc, TEST_GET_MY_NODE_READY_RESPONSE);
+    }
+    unsigned long plain_us = micros() - start;
+
+    static uint8_t window[INFLATE_WINDOW_SIZE];
+    start = micros();
+    for (int i = 0; i < iterations; i++) {
+        Inflater inflater(TEST_GET_MY_NODE_READY_RESPONSE_GZIP, sizeof(TEST_GET_MY_NODE_READY_RESPONSE_GZIP), window,
+                          sizeof(window));
+        deserializeJson(doc, inflater);
+    }
+    unsigned long inflate_us = micros() - start;
+
+    Serial.printf("get-my-node response: %u bytes plain, %u bytes gzip\n",
+                  (unsigned)TEST_GET_MY_NODE_READY_RESPONSE.size(), (unsigned)sizeof(TEST_GET_MY_NODE_READY_RESPONSE_GZIP));
+    Serial.printf("parse plain: %lu us / %d calls\n", plain_us, iterations);
+    Serial.printf("inflate + parse gzip: %lu us / %d calls\n", inflate_us, iterations);
+    TEST_ASSERT_EQUAL_STRING("success", doc["result"]["status"]);
+}
+
+// Replays TRACE_FILE when set (e.g. a trace copied off a device), otherwise a synthetic trace
+void test_benchmark_trace_replay(void) {
+    TraceBuffer trace;
+    const char *path = getenv("TRACE_FILE");
+    if (path) {
+        std::ifstream file(path, std::ios::binary);
+        trace.data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        Serial.printf("Replaying %s (%u bytes)\n", path, (unsigned)trace.data.size());
+    } else {
+        WiFi.setStatus(WL_CONNECTED);
+        BlockchainHandler handler(std::string(64, 'a'), std::string(64, 'b'), true, "http://test.url/chain/19/pact/api/v1/");
+        TraceWriter writer(trace);
+        handler.setTraceWriter(&writer);
+        HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+            return {200, url.indexOf("/local") >= 0 ? TEST_GET_MY_NODE_READY_RESPONSE : TEST_SEND_RESPONSE};
+        });
+        for (int i = 0; i < BENCH_ITERATIONS / 100; i++) {
+            handler.executeBlockchainCommand(PactCall::GET_MY_NODE);
+            handler.executeBlockchainCommand(PactCall::INSERT_MY_NODE, "node-1");
+        }
+        HTTPClient::setResponder(nullptr);
+    }
+
+    TraceReplayReport report = replayTrace(trace.data.data(), trace.data.size(), getenv("TRACE_REALTIME") != nullptr);
+    printTraceReplayReport(report);
+    TEST_ASSERT_TRUE(report.records > 0);
+    TEST_ASSERT_EQUAL(0, report.statusMismatches);
+}
+
+void test_benchmark_signatures(void) {
+    const int iterations = BENCH_ITERATIONS / 50;
+    uint8_t privateKey[32], publicKey[32], hash[32] = {}, signature[64], reference[64];
+    for (int i = 0; i < 32; i++) {
+        privateKey[i] = static_cast<uint8_t>(i * 11 + 5);
+    }
+    Ed25519::derivePublicKey(publicKey, privateKey);
+
+    unsigned long start = micros();
+    for (int i = 0; i < iterations; i++) {
+        hash[0] = static_cast<uint8_t>(i);
+        Ed25519::sign(reference, privateKey, publicKey, hash, sizeof(hash));
+    }
+    unsigned long reference_us = micros() - start;
+
+    start = micros();
+    for (int i = 0; i < iterations; i++) {
+        hash[0] = static_cast<uint8_t>(i);
+        Ed25519Fast::sign(signature, privateKey, publicKey, hash, sizeof(hash));
+    }
+    unsigned long fast_us = micros() - start;
+
+    Serial.printf("Ed25519::sign:     %lu us / %d signatures (%.0f/s)\n", reference_us, iterations, iterations * 1e6 / reference_us);
+    Serial.printf("Ed25519Fast::sign: %lu us / %d signatures (%.0f/s, %d table rows)\n", fast_us, iterations,
+                  iterations * 1e6 / fast_us, ED25519_BASE_TABLE_ROWS);
+    TEST_ASSERT_EQUAL_MEMORY(reference, signature, sizeof(signature));
+}
+
+void test_benchmark_batch_hashing(void) {
+    // Command-sized messages, as a gateway builds them for many identities
+    const int batch = 64;
+    const int rounds = BENCH_ITERATIONS / 100;
+    std::vector<std::string> commands;
+    std::vector<HashVector> vectors;
+    for (int i = 0; i < batch; i++) {
+        commands.push_back(std::string(320 + i % 48, static_cast<char>('a' + i % 26)));
+    }
+    for (const std::string &command : commands) {
+        vectors.push_back(HashVector{"batch", command.c_str()});
+    }
+    EncryptionHandler handler;
+
+    unsigned long start = micros();
+    size_t checksum = 0;
+    for (int round = 0; round < rounds; round++) {
+        for (HashVector &vector : vectors) {
+            checksum += handler.Binhash(&vector)[0];
+        }
+    }
+    unsigned long single_us = micros() - start;
+
+    start = micros();
+    size_t batchChecksum = 0;
+    for (int round = 0; round < rounds; round++) {
+        handler.Binhashes(vectors.data(), vectors.size());
+        for (const HashVector &vector : vectors) {
+            batchChecksum += vector.hash[0];
+        }
+    }
+    unsigned long batch_us = micros() - start;
+
+    Serial.printf("Binhash:   %lu us / %d hashes\n", single_us, rounds * batch);
+    Serial.printf("Binhashes: %lu us / %d hashes (%u lanes)\n", batch_us, rounds * batch, (unsigned)blake2bBatchLanes());
+    TEST_ASSERT_EQUAL(checksum, batchChecksum);
+}
+
+void test_benchmark_snapshot_resume(void) {
+    std::string pub_key(64, 'a');
+    std::string priv_key(64, 'b');
+    std::string url = "http://test.url/chain/19/pact/api/v1/";
+    WiFi.setStatus(WL_CONNECTED);
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        return {200, TEST_GET_MY_NODE_READY_RESPONSE};
+    });
+    const int rounds = BENCH_ITERATIONS / 100;
+
+    // Cold boot: the director key has to be learned again with a signed /local
+    unsigned long start = micros();
+    for (int i = 0; i < rounds; i++) {
+        BlockchainHandler handler(pub_key, priv_key, true, url);
+        TEST_ASSERT_EQUAL(BlockchainStatus::READY, handler.executeBlockchainCommand(PactCall::GET_MY_NODE));
+    }
+    unsigned long cold_us = micros() - start;
+
+    uint8_t snapshot[HANDLER_SNAPSHOT_MAX_SIZE];
+    size_t length;
+    {
+        BlockchainHandler handler(pub_key, priv_key, true, url);
+        handler.executeBlockchainCommand(PactCall::GET_MY_NODE);
+        length = handler.saveSnapshot(snapshot, sizeof(snapshot));
+    }
+    HTTPClient::setResponder(nullptr);
+
+    // Resume: the same state comes back from the snapshot
+    start = micros();
+    int restored = 0;
+    for (int i = 0; i < rounds; i++) {
+        BlockchainHandler handler(pub_key, priv_key, true, url);
+        restored += handler.restoreSnapshot(snapshot, length);
+    }
+    unsigned long resume_us = micros() - start;
+
+    Serial.printf("Cold boot to director key: %lu us / %d boots (mock HTTP, no network latency)\n", cold_us, rounds);
+    Serial.printf("Snapshot resume:           %lu us / %d boots (%u byte snapshot)\n", resume_us, rounds,
+                  (unsigned)length);
+    TEST_ASSERT_EQUAL(rounds, restored);
+}
+
+void test_benchmark_merkle_batch(void) {
+    const int leaves = BEACON_BATCH_MAX_LEAVES;
+    std::vector<std::string> keys;
+    for (int i = 0; i < leaves; i++) {
+        char key[65];
+        snprintf(key, sizeof(key), "%064x", i);
+        keys.push_back(key);
+    }
+    String secret(std::string(700, 's'));
+    BeaconBatch batch;
+    batch.reserve(leaves);
+
+    unsigned long start = micros();
+    for (int i = 0; i < leaves; i++) {
+        batch.add(keys[i], i, secret);
+    }
+    unsigned long add_us = micros() - start;
+
+    start = micros();
+    const uint8_t *root = batch.root();
+    unsigned long root_us = micros() - start;
+
+    start = micros();
+    MerkleProof proof;
+    size_t verified = 0;
+    for (int i = 0; i < leaves; i++) {
+        uint8_t leaf[MERKLE_HASH_SIZE];
+        batch.proof(i, proof);
+        BeaconBatch::leafHash(keys[i], i, secret, leaf);
+        verified += MerkleTree::verify(leaf, proof, root);
+    }
+    unsigned long proof_us = micros() - start;
+
+    // The tree alone, grown one leaf at a time with the root taken after each: only new paths are rehashed
+    const int treeLeaves = 65536;
+    std::vector<uint8_t> hashes(treeLeaves * MERKLE_HASH_SIZE);
+    for (size_t i = 0; i < hashes.size(); i++) {
+        hashes[i] = static_cast<uint8_t>(i * 131);
+    }
+    MerkleTree tree;
+    tree.reserve(treeLeaves);
+    start = micros();
+    tree.append(reinterpret_cast<const uint8_t(*)[MERKLE_HASH_SIZE]>(hashes.data()), treeLeaves);
+    tree.root();
+    unsigned long bulk_us = micros() - start;
+    tree.clear();
+    start = micros();
+    for (int i = 0; i < treeLeaves; i++) {
+        tree.append(reinterpret_cast<const uint8_t(*)[MERKLE_HASH_SIZE]>(&hashes[i * MERKLE_HASH_SIZE]), 1);
+        tree.root();
+    }
+    unsigned long incremental_us = micros() - start;
+
+    Serial.printf("Beacon batch: %d leaves, add %lu us, root %lu us\n", leaves, add_us, root_us);
+    Serial.printf("Proofs: %lu us for %d proofs + verifications (depth %u)\n", proof_us, leaves, (unsigned)proof.depth);
+    Serial.printf("Merkle tree: %d leaves in %lu us at once, %lu us one leaf at a time (%u lanes)\n", treeLeaves,
+                  bulk_us, incremental_us, (unsigned)blake2bBatchLanes());
+    TEST_ASSERT_NOT_NULL(root);
+    TEST_ASSERT_EQUAL(leaves, verified);
+}
+
+void test_benchmark_secret_decryption(void) {
+    const int secrets = 512;
+    EncryptionHandler encryption;
+    std::vector<std::string> batch;
+    for (int i = 0; i < secrets; i++) {
+        batch.push_back(encryption.encrypt(TEST_DIRECTOR_PUBLIC_KEY_BASE64, std::string(200, 'a' + i % 26)).c_str());
+    }
+    std::vector<std::string> plaintexts(secrets);
+
+    SecretDecryptor single(1);
+    TEST_ASSERT_TRUE(single.setPrivateKey(TEST_DIRECTOR_PRIVATE_KEY_BASE64));
+    unsigned long start = micros();
+    size_t decrypted = 0;
+    for (int i = 0; i < secrets; i++) {
+        decrypted += single.decrypt(batch[i], plaintexts[i]);
+    }
+    unsigned long single_us = micros() - start;
+
+    SecretDecryptor pool;
+    TEST_ASSERT_TRUE(pool.setPrivateKey(TEST_DIRECTOR_PRIVATE_KEY_BASE64));
+    start = micros();
+    decrypted += pool.decryptBatch(batch.data(), secrets, plaintexts.data());
+    unsigned long batch_us = micros() - start;
+
+    Serial.printf("Secret decrypt, one at a time: %lu us / %d secrets (%.0f secrets/s)\n", single_us, secrets,
+                  secrets * 1e6 / single_us);
+    Serial.printf("Secret decryptBatch, %u workers: %lu us / %d secrets (%.0f secrets/s)\n", (unsigned)pool.threads(),
+                  batch_us, secrets, secrets * 1e6 / batch_us);
+    TEST_ASSERT_EQUAL(2 * secrets, decrypted);
+}
+
+// Simulates FLEET_NODES nodes (default 10,000) for FLEET_HOURS hours (default 1), first on the
+// fixed sync cadence, then with the interval jittered by +/-50%
+void test_benchmark_fleet_sim(void) {
+    FleetConfig config;
+    config.nodes = getenv("FLEET_NODES") ? atoi(getenv("FLEET_NODES")) : 10000;
+    config.durationS = getenv("FLEET_HOURS") ? atoi(getenv("FLEET_HOURS")) * 3600 : 3600;
+
+    FleetReport fixed = simulateFleet(config);
+    printFleetReport(fixed);
+    config.bootSpreadS = 300;
+    config.scheduler = [](size_t node, int32_t intervalMs, std::mt19937 &rng) {
+        return std::uniform_int_distribution<uint32_t>(intervalMs / 2, intervalMs * 3 / 2)(rng);
+    };
+    FleetReport jittered = simulateFleet(config);
+    printFleetReport(jittered);
+    TEST_ASSERT_TRUE(fixed.syncs > 0 && jittered.syncs > 0);
+    TEST_ASSERT_EQUAL(0, fixed.rejected + jittered.rejected);
+}
@@ -0,0 +1,159 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "BlockHeaderStream.h"
+#include "BlockchainHandler.h"
+#include "test_fixtures.h"
+
+
+static std::vector<std::pair<uint8_t, uint32_t>> receivedHeaders;
+
+static void recordHeader(uint8_t chain_id, uint32_t height)
+{
+    receivedHeaders.push_back({chain_id, height});
+}
+
+void test_block_header_event_parsing(void) {
+    receivedHeaders.clear();
+    BlockHeaderEventParser parser(recordHeader);
+
+    // Keep-alive comments, CRLF line endings, other event types and arbitrary splits
+    const char stream[] = ":keep-alive\r\n"
+                          "event:BlockHeader\r\n"
+                          "data:{\"txCount\":0,\"header\":{\"chainId\":19,\"height\":4200001}}\r\n\r\n"
+                          "retry: 5000\n"
+                          "event: Other\n"
+                          "data: {\"header\":{\"chainId\":1,\"height\":2}}\n\n"
+                          "event:BlockHeader\n"
+                          "data:{\"header\":{\"chainId\":3,\"height\":77}}\n\n";
+    for (size_t i = 0; i < sizeof(stream) - 1; i += 7) {
+        parser.feed(stream + i, sizeof(stream) - 1 - i < 7 ? sizeof(stream) - 1 - i : 7);
+    }
+    TEST_ASSERT_EQUAL(2, receivedHeaders.size());
+    TEST_ASSERT_EQUAL(19, receivedHeaders[0].first);
+    TEST_ASSERT_EQUAL(4200001, receivedHeaders[0].second);
+    TEST_ASSERT_EQUAL(3, receivedHeaders[1].first);
+    TEST_ASSERT_EQUAL(5000, parser.retryMs());
+
+    // An event larger than the buffer is dropped without affecting the next one
+    std::string oversized = "data:{\"pad\":\"" + std::string(BLOCK_HEADER_EVENT_SIZE, 'x') + "\"}\n\n" +
+                            "data:{\"header\":{\"chainId\":4,\"height\":5}}\n\n";
+    parser.feed(oversized.data(), oversized.size());
+    TEST_ASSERT_EQUAL(3, receivedHeaders.size());
+    TEST_ASSERT_EQUAL(4, receivedHeaders[2].first);
+}
+
+void test_block_header_subscription_reconnect(void) {
+    // The node streams one chunked event and closes the connection
+    static int connects;
+    connects = 0;
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        connects++;
+        TEST_ASSERT_EQUAL_STRING("http://test.url/header/updates", url.c_str());
+        return {200, "16\r\nevent:BlockHeader\ndata\r\n28;ext=1\r\n:{\"header\":{\"chainId\":19,\"height\":10}}\n\n\r\n0\r\n\r\n",
+                {{"Transfer-Encoding", "chunked"}}};
+    });
+
+    receivedHeaders.clear();
+    BlockHeaderSubscription subscription("http://test.url");
+    subscription.setListener(recordHeader);
+    subscription.poll(1000);
+    TEST_ASSERT_TRUE(subscription.connected());
+    subscription.poll(1001);
+    TEST_ASSERT_EQUAL(1, receivedHeaders.size());
+    TEST_ASSERT_EQUAL(10, receivedHeaders[0].second);
+    TEST_ASSERT_FALSE(subscription.connected());
+
+    // Reconnects after the minimum delay, then backs off while the node refuses
+    subscription.poll(1001 + BLOCK_HEADER_RECONNECT_MIN_MS - 1);
+    TEST_ASSERT_EQUAL(1, connects);
+    subscription.poll(1001 + BLOCK_HEADER_RECONNECT_MIN_MS);
+    TEST_ASSERT_EQUAL(2, connects);
+
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        connects++;
+        return {503, ""};
+    });
+    subscription.poll(5000);
+    subscription.poll(10000);
+    TEST_ASSERT_EQUAL(3, connects);
+    subscription.poll(10000 + BLOCK_HEADER_RECONNECT_MIN_MS);
+    TEST_ASSERT_EQUAL(3, connects);
+    subscription.poll(10000 + 2 * BLOCK_HEADER_RECONNECT_MIN_MS);
+    TEST_ASSERT_EQUAL(4, connects);
+    HTTPClient::setResponder(nullptr);
+}
+
+void test_block_header_driven_sync(void) {
+    WiFi.setStatus(WL_CONNECTED);
+    std::string valid_pub_key(64, 'a');
+    std::string valid_priv_key(64, 'b');
+    BlockchainHandler handler(valid_pub_key, valid_priv_key, true, "http://test.url/chain/19/pact/api/v1/");
+
+    static int localQueries;
+    localQueries = 0;
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        localQueries++;
+        return {200, "{\"result\":{\"status\":\"success\",\"data\":{\"send\":false}},\"metaData\":{\"blockHeight\":100}}"};
+    });
+
+    // A header from another chain shows the feed is live without moving this chain
+    handler.onBlockHeader(0, 5);
+    TEST_ASSERT_FALSE(handler.syncWanted());
+    handler.performNodeSync("node-1");
+    TEST_ASSERT_EQUAL(1, localQueries);
+    TEST_ASSERT_EQUAL(100, handler.chainHeight());
+
+    // Not due and no new block: the signed /local query is skipped
+    handler.performNodeSync("node-1");
+    TEST_ASSERT_EQUAL(1, localQueries);
+
+    handler.onBlockHeader(19, 101);
+    TEST_ASSERT_TRUE(handler.syncWanted());
+    handler.performNodeSync("node-1");
+    TEST_ASSERT_EQUAL(2, localQueries);
+    TEST_ASSERT_FALSE(handler.syncWanted());
+    HTTPClient::setResponder(nullptr);
+}
+
+void test_block_header_sync_waits_for_due_time(void) {
+    WiFi.setStatus(WL_CONNECTED);
+    MockClock::set(1000000000ULL);
+    BlockchainHandler handler(std::string(64, 'a'), std::string(64, 'b'), true, "http://test.url/chain/19/pact/api/v1/");
+    const uint32_t intervalS = 3600;
+    handler.setBeaconInterval(intervalS);
+
+    static int localQueries;
+    localQueries = 0;
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        if (url.indexOf("/local") >= 0) {
+            return {200, localQueries++ == 0 ? TEST_GET_MY_NODE_READY_RESPONSE
+                                             : "{\"result\":{\"status\":\"success\",\"data\":{\"send\":false}}}"};
+        }
+        return {200, TEST_SEND_RESPONSE};
+    });
+
+    static bool beaconSent;
+    beaconSent = false;
+    handler.onBlockHeader(19, 4200000);
+    handler.performNodeSync("node-1", nullptr, [](uint32_t) { beaconSent = true; });
+    TEST_ASSERT_TRUE(beaconSent);
+    TEST_ASSERT_EQUAL(1, localQueries);
+
+    // New blocks no longer end the skip: the node is not due until the beacon interval has passed
+    handler.onBlockHeader(19, 4200001);
+    TEST_ASSERT_TRUE(handler.syncWanted());
+    handler.performNodeSync("node-1");
+    TEST_ASSERT_EQUAL(1, localQueries);
+
+    delay(intervalS * 1000UL - 1);
+    handler.onBlockHeader(19, 4200002);
+    handler.performNodeSync("node-1");
+    TEST_ASSERT_EQUAL(1, localQueries);
+
+    delay(1);
+    handler.performNodeSync("node-1");
+    TEST_ASSERT_EQUAL(2, localQueries);
+    HTTPClient::setResponder(nullptr);
+    MockClock::release();
+}
@@ -0,0 +1,61 @@
+#include <unity.h>
+#include "BlockchainHandler.h"
+#include "ChainRouter.h"
+
+
+void test_chain_router_mapping(void) {
+    ChainRouter router("http://test.url/chainweb/0.0/mainnet01/", 20);
+    std::string key_a(64, 'a');
+    std::string key_b(64, 'b');
+
+    // Hash-based mapping is stable and within range
+    uint8_t chain_a = router.chainFor(key_a);
+    TEST_ASSERT_EQUAL(chain_a, router.chainFor(key_a));
+    TEST_ASSERT_TRUE(chain_a < 20);
+
+    // Explicit assignments override the hash
+    router.assignChain(key_b, 7);
+    TEST_ASSERT_EQUAL(7, router.chainFor(key_b));
+    TEST_ASSERT_EQUAL_STRING("http://test.url/chainweb/0.0/mainnet01/chain/7/pact/api/v1/",
+                             router.serverUrlFor(7).c_str());
+}
+
+void test_chain_router_stats(void) {
+    WiFi.setStatus(WL_CONNECTED);
+    ChainRouter router("http://test.url/chainweb/0.0/mainnet01", 20);
+    std::string valid_pub_key(64, 'a');
+    std::string valid_priv_key(64, 'b');
+    router.assignChain(valid_pub_key, 3);
+
+    BlockchainHandler handler(valid_pub_key, valid_priv_key, true, router);
+    TEST_ASSERT_EQUAL(3, handler.chainId());
+
+    handler.executeBlockchainCommand("local", "(free.mesh03.get-my-node)");
+    ChainStats stats = router.stats(3);
+    TEST_ASSERT_EQUAL(1, stats.submitted);
+    TEST_ASSERT_EQUAL(1, stats.succeeded);
+    TEST_ASSERT_EQUAL(0, router.queueDepth(3));
+    TEST_ASSERT_EQUAL(0, router.stats(19).submitted);
+}
+
+void test_chain_router_rejects_malformed_url(void) {
+    WiFi.setStatus(WL_CONNECTED);
+    std::string valid_pub_key(64, 'a');
+    std::string valid_priv_key(64, 'b');
+
+    BlockchainHandler chain7(valid_pub_key, valid_priv_key, true, "http://test.url/chain/7/pact/api/v1/");
+    TEST_ASSERT_EQUAL(7, chain7.chainId());
+    TEST_ASSERT_TRUE(chain7.isWalletConfigValid());
+    BlockchainHandler unsharded(valid_pub_key, valid_priv_key, true, "http://test.url/pact/api/v1/");
+    TEST_ASSERT_EQUAL(DEFAULT_CHAIN_ID, unsharded.chainId());
+    TEST_ASSERT_TRUE(unsharded.isWalletConfigValid());
+
+    // None of these lands silently on chain 0
+    for (const char *url : {"http://test.url/chain/abc/pact/api/v1/", "http://test.url/chain//pact/api/v1/",
+                            "http://test.url/chain/-1/pact/api/v1/", "http://test.url/chain/7x/pact/api/v1/",
+                            "http://test.url/chain/20/pact/api/v1/"}) {
+        BlockchainHandler handler(valid_pub_key, valid_priv_key, true, url);
+        TEST_ASSERT_FALSE(handler.isWalletConfigValid());
+        TEST_ASSERT_TRUE(handler.executeBlockchainCommand(PactCall::GET_MY_NODE) == BlockchainStatus::FAILURE);
+    }
+}
@@ -0,0 +1,55 @@
+#include <unity.h>
+#include "BlockchainHandler.h"
+#include "ClockSkew.h"
+#include "utils.h"
+
+
+void test_clock_skew_estimation(void) {
+    int64_t parsed;
+    TEST_ASSERT_TRUE(ClockSkewEstimator::parseHttpDate("Tue, 14 Nov 2023 22:13:20 GMT", parsed));
+    TEST_ASSERT_EQUAL(1700000000, parsed);
+    TEST_ASSERT_FALSE(ClockSkewEstimator::parseHttpDate("not a date", parsed));
+
+    ClockSkewEstimator estimator;
+    TEST_ASSERT_FALSE(estimator.hasEstimate());
+    estimator.addSample(1100, 1000);
+    TEST_ASSERT_EQUAL(100, estimator.offsetSeconds());
+
+    // Small deviations are smoothed, large jumps reseed the estimate
+    estimator.addSample(1104, 1000);
+    TEST_ASSERT_EQUAL(101, estimator.offsetSeconds());
+    estimator.addBlockTime(5000.0 * 1000000, 1000);
+    TEST_ASSERT_EQUAL(4000 + CLOCK_SKEW_BLOCK_AGE_SECONDS, estimator.offsetSeconds());
+
+    // A block mined 30 s before the response is, on average, half a block old
+    ClockSkewEstimator blocks;
+    blocks.addBlockTime(970.0 * 1000000, 1000);
+    blocks.addBlockTime(1000.0 * 1000000, 1000);
+    TEST_ASSERT_INT_WITHIN(CLOCK_SKEW_BLOCK_AGE_SECONDS, 0, blocks.offsetSeconds());
+}
+
+void test_clock_skew_applied_to_commands(void) {
+    WiFi.setStatus(WL_CONNECTED);
+    std::string valid_pub_key(64, 'a');
+    std::string valid_priv_key(64, 'b');
+    BlockchainHandler handler(valid_pub_key, valid_priv_key, true, "http://test.url/chain/19/pact/api/v1/");
+
+    // The node answers with a Date one hour ahead of the local clock
+    static uint32_t lastCreationTime;
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        size_t pos = body.find("creationTime");
+        lastCreationTime = strtoul(body.c_str() + body.find(':', pos) + 1, nullptr, 10);
+
+        char date[40];
+        std::time_t ahead = getCurrentUnixTime() + 3600;
+        strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", std::gmtime(&ahead));
+        return {200, "{\"result\":{\"status\":\"success\",\"data\":{\"send\":false}}}", {{"Date", date}}};
+    });
+
+    TEST_ASSERT_EQUAL(BlockchainStatus::NOT_DUE, handler.executeBlockchainCommand(PactCall::GET_MY_NODE));
+    TEST_ASSERT_INT_WITHIN(1, 3600, handler.clockOffsetSeconds());
+
+    handler.executeBlockchainCommand(PactCall::GET_MY_NODE);
+    TEST_ASSERT_INT_WITHIN(2, getCurrentUnixTime() + 3600, lastCreationTime);
+    HTTPClient::setResponder(nullptr);
+}
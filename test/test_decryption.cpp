@@ -0,0 +1,108 @@
+#include <unity.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "EncryptionHandler.h"
+#include "SecretDecryptor.h"
+#include "test_fixtures.h"
+
+static std::string testPayload(size_t length, int variant)
+{
+    std::string payload(length, '\0');
+    for (size_t i = 0; i < length; i++) {
+        payload[i] = static_cast<char>((i * 7 + variant * 31) & 0xff);
+    }
+    return payload;
+}
+
+void test_secret_decryption_round_trip(void) {
+    EncryptionHandler encryption;
+    SecretDecryptor decryptor(1);
+    std::string plaintext;
+
+    std::string secret = encryption.encrypt(TEST_DIRECTOR_PUBLIC_KEY_BASE64, "before the key").c_str();
+    TEST_ASSERT_FALSE(decryptor.decrypt(secret, plaintext));
+    TEST_ASSERT_TRUE(decryptor.setPrivateKey(TEST_DIRECTOR_PRIVATE_KEY_BASE64));
+
+    // Around the AES block size, and binary data
+    for (size_t length : {0, 1, 15, 16, 17, 32, 700}) {
+        std::string payload = testPayload(length, static_cast<int>(length));
+        secret = encryption.encrypt(TEST_DIRECTOR_PUBLIC_KEY_BASE64, payload).c_str();
+        TEST_ASSERT_TRUE(secret.size() > 0);
+        TEST_ASSERT_TRUE(decryptor.decrypt(secret, plaintext));
+        TEST_ASSERT_EQUAL(payload.size(), plaintext.size());
+        TEST_ASSERT_EQUAL_MEMORY(payload.data(), plaintext.data(), payload.size());
+    }
+
+    // Decoded in place from a larger, unterminated buffer
+    std::string payload = "{\"packetId\":1234,\"secret\":\"mesh\"}";
+    secret = encryption.encrypt(TEST_DIRECTOR_PUBLIC_KEY_BASE64, payload).c_str();
+    std::string buffer = "prefix" + secret + "trailing garbage";
+    TEST_ASSERT_TRUE(decryptor.decrypt(buffer.data() + 6, secret.size(), plaintext));
+    TEST_ASSERT_EQUAL_STRING(payload.c_str(), plaintext.c_str());
+}
+
+void test_secret_decryption_rejected(void) {
+    EncryptionHandler encryption;
+    SecretDecryptor decryptor(1);
+    TEST_ASSERT_FALSE(decryptor.setPrivateKey(TEST_DIRECTOR_PUBLIC_KEY_BASE64));
+    TEST_ASSERT_FALSE(decryptor.setPrivateKey("bm90IGEga2V5"));
+    TEST_ASSERT_TRUE(decryptor.setPrivateKey(TEST_DIRECTOR_PRIVATE_KEY_BASE64));
+
+    std::string payload = "secret payload";
+    std::string secret = encryption.encrypt(TEST_DIRECTOR_PUBLIC_KEY_BASE64, payload).c_str();
+    size_t separator = secret.find(SECRET_SEPARATOR);
+    std::string plaintext;
+    TEST_ASSERT_TRUE(decryptor.decrypt(secret, plaintext));
+
+    // Encrypted for another key
+    std::string other = encryption.encrypt(TEST_PUBLIC_KEY_BASE64, payload).c_str();
+    TEST_ASSERT_FALSE(decryptor.decrypt(other, plaintext));
+    TEST_ASSERT_EQUAL(0, plaintext.size());
+
+    // Corrupted encrypted key, corrupted "Salted__" header, invalid base64, missing separator, truncation
+    std::string corrupted = secret;
+    corrupted[separator + 10] = corrupted[separator + 10] == 'A' ? 'B' : 'A';
+    TEST_ASSERT_FALSE(decryptor.decrypt(corrupted, plaintext));
+    corrupted = secret;
+    corrupted[0] = corrupted[0] == 'A' ? 'B' : 'A';
+    TEST_ASSERT_FALSE(decryptor.decrypt(corrupted, plaintext));
+    corrupted = secret;
+    corrupted[4] = '*';
+    TEST_ASSERT_FALSE(decryptor.decrypt(corrupted, plaintext));
+    TEST_ASSERT_FALSE(decryptor.decrypt(secret.substr(0, separator), plaintext));
+    TEST_ASSERT_FALSE(decryptor.decrypt(secret.substr(0, secret.size() - 4), plaintext));
+    TEST_ASSERT_FALSE(decryptor.decrypt(secret.substr(separator), plaintext));
+    TEST_ASSERT_EQUAL(0, plaintext.size());
+}
+
+void test_secret_decryption_batch(void) {
+    EncryptionHandler encryption;
+    SecretDecryptor decryptor(4);
+    TEST_ASSERT_EQUAL(4, decryptor.threads());
+    TEST_ASSERT_TRUE(decryptor.setPrivateKey(TEST_DIRECTOR_PRIVATE_KEY_BASE64));
+
+    const size_t count = 40;
+    std::vector<std::string> payloads, secrets;
+    for (size_t i = 0; i < count; i++) {
+        payloads.push_back(testPayload(i * 5, static_cast<int>(i)));
+        secrets.push_back(encryption.encrypt(TEST_DIRECTOR_PUBLIC_KEY_BASE64, payloads[i]).c_str());
+    }
+    // Every fifth secret loses its encrypted key
+    for (size_t i = 0; i < count; i += 5) {
+        secrets[i].resize(secrets[i].find(SECRET_SEPARATOR));
+    }
+
+    std::vector<std::string> plaintexts(count);
+    bool decrypted[count];
+    TEST_ASSERT_EQUAL(count - count / 5, decryptor.decryptBatch(secrets.data(), count, plaintexts.data(), decrypted));
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT_EQUAL(i % 5 != 0, decrypted[i]);
+        if (decrypted[i]) {
+            TEST_ASSERT_TRUE(plaintexts[i] == payloads[i]);
+        } else {
+            TEST_ASSERT_EQUAL(0, plaintexts[i].size());
+        }
+    }
+    TEST_ASSERT_EQUAL(0, decryptor.decryptBatch(secrets.data(), 0, plaintexts.data()));
+}
@@ -1,5 +1,9 @@
 #include <unity.h>
+#include "Blake2bBatch.h"
 #include "EncryptionHandler.h"
+#include "test_fixtures.h"
+#include <cstring>
+#include <vector>
 
 
 void test_binary_hash_generation(void) {
@@ -33,19 +37,7 @@ void test_hex_conversion(void) {
 
 void test_payload_encryption(void) {
     EncryptionHandler handler;
-    // Test RSA public key in PEM format (base64 encoded)
-    // Generated using:
-    // 1. Generate 1024-bit RSA private key:
-    //    openssl genrsa -out private.pem 1024
-    // 2. Extract PKCS#1 public key:
-    //    openssl rsa -in private.pem -pubout -RSAPublicKey_out -out public.pem
-    // 3. Encode the public key in base64:
-    // WARNING: 1024-bit keys are considered weak - used here for testing only
-    std::string base64_public_key =
-        "LS0tLS1CRUdJTiBSU0EgUFVCTElDIEtFWS0tLS0tCk1JR0pBb0dCQU5YODZUNmRuVStsZ2phVHNIMjdhTVlx"
-        "OXlEOCtCVHV1WEczMlRpb2Z0QURkdUJ1SWlXbEpKVXAKaFpPcDdGM2ZBTmtoczNXOHJuNy9tKzhESWZ3bWhZ"
-        "eVZYaS9EK3gyWDBTcXAwOVBnVU9mdlo0dVlTSFlheFhqSApxaTZRSlRKY2NnQTEwRzBRUm9hZTk5MXV4VVVX"
-        "WEN2dU9sR2RxL2NwOFRXUFMvOTkrZ1RiQWdNQkFBRT0KLS0tLS1FTkQgUlNBIFBVQkxJQyBLRVktLS0tLQ==";
+    std::string base64_public_key = TEST_PUBLIC_KEY_BASE64;
     // Test payload
     std::string test_payload = "test_data_123";
     String encrypted = handler.encrypt(base64_public_key, test_payload);
@@ -77,3 +69,107 @@ void test_payload_encryption(void) {
     TEST_ASSERT_GREATER_THAN(0, encrypted_content.size());  // Should have encrypted content
     TEST_ASSERT_EQUAL(0, encrypted_content.size() % 16);  // Should be multiple of AES block size
 }
+
+// RFC 8032 section 7.1, tests 1-3
+static const struct {
+    const char *privateKey;
+    const char *publicKey;
+    const char *message;
+    const char *signature;
+} ED25519_VECTORS[] = {
+    {"9d61b19deffd5a60ba844af492ec2cc44449c5697b326919703bac031cae7f60",
+     "d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a", "",
+     "e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e06522490155"
+     "5fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b"},
+    {"4ccd089b28ff96da9db6c346ec114e0f5b8a319f35aba624da8cf6ed4fb8a6fb",
+     "3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c", "72",
+     "92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da"
+     "085ac1e43e15996e458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00"},
+    {"c5aa8df43f9f837bedb7442f31dcb7b166d38535076f094b85ce3a2e0b4458f7",
+     "fc51cd8e6218a1a38da47ed00230f0580816ed13ba3303ac5deb911548908025", "af82",
+     "6291d657deec24024827e69c3abe01a30ce548a284743a445e3680d7db5ac3ac"
+     "18ff9b538d16f290ae67f760984dc6594a7c15e9716ed28dc027beceea1ec40a"},
+};
+
+void test_ed25519_rfc8032_vectors(void) {
+    EncryptionHandler handler;
+    for (const auto &vector : ED25519_VECTORS) {
+        char privateKey[32], publicKey[32], message[2], expected[64];
+        handler.HexToBytes(vector.privateKey, privateKey);
+        handler.HexToBytes(vector.publicKey, publicKey);
+        handler.HexToBytes(vector.message, message);
+        handler.HexToBytes(vector.signature, expected);
+        size_t length = strlen(vector.message) / 2;
+
+        uint8_t derived[32];
+        Ed25519Fast::derivePublicKey(derived, (uint8_t *)privateKey);
+        TEST_ASSERT_EQUAL_MEMORY(publicKey, derived, 32);
+
+        uint8_t signature[64];
+        Ed25519Fast::sign(signature, (uint8_t *)privateKey, (uint8_t *)publicKey, message, length);
+        TEST_ASSERT_EQUAL_MEMORY(expected, signature, 64);
+        Ed25519::sign(signature, (uint8_t *)privateKey, (uint8_t *)publicKey, message, length);
+        TEST_ASSERT_EQUAL_MEMORY(expected, signature, 64);
+    }
+}
+
+void test_signature_backends_match(void) {
+    EncryptionHandler fast;
+    EncryptionHandler reference;
+    reference.setSignatureBackend(SignatureBackend::REFERENCE);
+
+    uint8_t privateKey[32], publicKey[32], derived[32], hash[HASH_SIZE];
+    for (int i = 0; i < 16; i++) {
+        for (int j = 0; j < 32; j++) {
+            privateKey[j] = static_cast<uint8_t>(i * 31 + j * 7);
+            hash[j] = static_cast<uint8_t>(i ^ (j * 13));
+        }
+        Ed25519::derivePublicKey(publicKey, privateKey);
+        Ed25519Fast::derivePublicKey(derived, privateKey);
+        TEST_ASSERT_EQUAL_MEMORY(publicKey, derived, 32);
+
+        std::string publicHex = fast.bytesToHex(publicKey, 32);
+        std::string privateHex = fast.bytesToHex(privateKey, 32);
+        TEST_ASSERT_EQUAL_STRING(reference.generateSignature(publicHex, privateHex, hash).c_str(),
+                                 fast.generateSignature(publicHex, privateHex, hash).c_str());
+    }
+}
+
+void test_binhash_batch_matches_single(void) {
+    EncryptionHandler handler;
+    // Lengths around the 128-byte block size, more vectors than one chunk
+    std::vector<std::string> messages;
+    for (size_t length : {0, 1, 64, 127, 128, 129, 255, 256, 257, 600, 1000}) {
+        for (int variant = 0; variant < 3; variant++) {
+            std::string message(length, 'a');
+            for (size_t i = 0; i < length; i++) {
+                message[i] = static_cast<char>('!' + (i * 7 + variant * 13) % 90);
+            }
+            messages.push_back(message);
+        }
+    }
+
+    std::vector<HashVector> vectors;
+    for (const std::string &message : messages) {
+        vectors.push_back(HashVector{"batch", message.c_str()});
+    }
+    handler.Binhashes(vectors.data(), vectors.size());
+    for (HashVector &vector : vectors) {
+        uint8_t single[HASH_SIZE];
+        memcpy(single, handler.Binhash(&vector), HASH_SIZE);
+        TEST_ASSERT_EQUAL_MEMORY(single, vector.hash, HASH_SIZE);
+        TEST_ASSERT_EQUAL_STRING(handler.KDAhash(&vector).c_str(), handler.KDAhash(vector.hash).c_str());
+    }
+
+    // The scalar path gives the same result as the widest one
+    std::vector<const uint8_t *> data;
+    std::vector<size_t> lengths;
+    for (const std::string &message : messages) {
+        data.push_back(reinterpret_cast<const uint8_t *>(message.data()));
+        lengths.push_back(message.size());
+    }
+    std::vector<uint8_t> wide(messages.size() * HASH_SIZE), scalar(messages.size() * HASH_SIZE);
+    blake2b256Batch(data.data(), lengths.data(), messages.size(), reinterpret_cast<uint8_t(*)[32]>(wide.data()));
+    blake2b256Batch(data.data(), lengths.data(), messages.size(), reinterpret_cast<uint8_t(*)[32]>(scalar.data()), 1);
+    TEST_ASSERT_EQUAL_MEMORY(scalar.data(), wide.data(), wide.size());
+}
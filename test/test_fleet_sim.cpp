@@ -0,0 +1,95 @@
+#include <unity.h>
+#include "fleet_sim.h"
+
+// Waits between half and one and a half times the interval the handler asked for
+static uint32_t jitteredInterval(size_t node, int32_t intervalMs, std::mt19937 &rng)
+{
+    return std::uniform_int_distribution<uint32_t>(intervalMs / 2, intervalMs * 3 / 2)(rng);
+}
+
+void test_fleet_sim_herd_and_jitter(void) {
+    FleetConfig config;
+    config.nodes = 300;
+    config.durationS = 2 * 3600;
+
+    // Booted together, the fixed cadence keeps every node syncing in the same minute
+    FleetReport herd = simulateFleet(config);
+    TEST_ASSERT_EQUAL(300, herd.nodes);
+    TEST_ASSERT_TRUE(herd.syncs >= 300 * 23);
+    TEST_ASSERT_EQUAL(herd.syncs, herd.requests[FLEET_LOCAL]);
+    TEST_ASSERT_EQUAL(0, herd.requests[FLEET_POLL]);
+    TEST_ASSERT_EQUAL(0, herd.rejected);
+    TEST_ASSERT_EQUAL(herd.beacons, herd.latenciesMs.size());
+    TEST_ASSERT_TRUE(herd.beacons >= 300);
+    TEST_ASSERT_TRUE(herd.peakLoad() >= 3 * herd.meanLoad());
+    // A due node is seen by its next sync and its beacon lands in the following block
+    TEST_ASSERT_TRUE(herd.latencyPercentileMs(100) <= 300000 + 30000 + 10000);
+
+    // Same seed, same run
+    FleetReport again = simulateFleet(config);
+    TEST_ASSERT_EQUAL(herd.syncs, again.syncs);
+    TEST_ASSERT_EQUAL(herd.beacons, again.beacons);
+    TEST_ASSERT_EQUAL(herd.peakLoad(), again.peakLoad());
+
+    config.bootSpreadS = 300;
+    config.scheduler = jitteredInterval;
+    FleetReport jittered = simulateFleet(config);
+    TEST_ASSERT_EQUAL(0, jittered.rejected);
+    TEST_ASSERT_TRUE(jittered.beacons >= 300);
+    TEST_ASSERT_TRUE(2 * jittered.peakLoad() < herd.peakLoad());
+}
+
+void test_fleet_sim_errors_and_registration(void) {
+    FleetConfig config;
+    config.nodes = 200;
+    config.durationS = 2 * 3600;
+    config.bootSpreadS = 300;
+    config.registeredFraction = 0.5f;
+    config.errorRate = 0.1f;
+    config.wifiDropoutRate = 0.05f;
+    config.headerFeed = true;
+
+    FleetReport report = simulateFleet(config);
+    TEST_ASSERT_TRUE(report.inserts > 50 && report.inserts < 150);
+    TEST_ASSERT_TRUE(report.errors > 0);
+    TEST_ASSERT_TRUE(report.wifiDown > 0);
+    // Failed sends are retried, and a retry first polls whether the failed attempt landed
+    TEST_ASSERT_TRUE(report.requests[FLEET_POLL] > 0);
+    TEST_ASSERT_TRUE(report.beacons > 150);
+    // Resent commands are never included twice, so no beacon lands while its node is not due
+    TEST_ASSERT_EQUAL(0, report.rejected);
+}
+
+void test_fleet_sim_assumed_beacon_interval(void) {
+    FleetConfig config;
+    config.nodes = 200;
+    config.durationS = 4 * 3600;
+    config.bootSpreadS = 300;
+    config.beaconIntervalS = 3600;
+
+    // Matching the contract, the assumed interval saves most /local queries without delaying beacons
+    FleetReport matched = simulateFleet(config);
+    TEST_ASSERT_TRUE(matched.requests[FLEET_LOCAL] + 5 * matched.beacons <= matched.syncs);
+    TEST_ASSERT_EQUAL(0, matched.rejected);
+    TEST_ASSERT_TRUE(matched.latencyPercentileMs(100) <= 300000 + 30000 + 10000);
+
+    // A contract spacing beacons further apart only costs the NOT_DUE answers past the assumed interval
+    config.dueIntervalS = 5400;
+    FleetReport longer = simulateFleet(config);
+    TEST_ASSERT_EQUAL(0, longer.rejected);
+    TEST_ASSERT_TRUE(longer.requests[FLEET_LOCAL] < longer.syncs);
+    TEST_ASSERT_TRUE(longer.latencyPercentileMs(100) <= 300000 + 30000 + 10000);
+
+    // One letting nodes send sooner goes unnoticed: beacons wait out the assumed interval
+    config.dueIntervalS = 1800;
+    FleetReport shorter = simulateFleet(config);
+    TEST_ASSERT_EQUAL(0, shorter.rejected);
+    TEST_ASSERT_TRUE(shorter.latencyPercentileMs(100) > 1500 * 1000);
+
+    // Without the assumption every sync asks the contract and beacons follow its interval
+    config.beaconIntervalS = 0;
+    FleetReport unset = simulateFleet(config);
+    TEST_ASSERT_EQUAL(unset.syncs, unset.requests[FLEET_LOCAL]);
+    TEST_ASSERT_TRUE(unset.beacons > shorter.beacons);
+    TEST_ASSERT_TRUE(unset.latencyPercentileMs(100) <= 300000 + 30000 + 10000);
+}
@@ -0,0 +1,146 @@
+#include <unity.h>
+#include "Arena.h"
+#include "BlockchainHandler.h"
+#include "Inflate.h"
+#include "test_fixtures.h"
+
+
+static std::string gzipFixture()
+{
+    return std::string(reinterpret_cast<const char *>(TEST_GET_MY_NODE_READY_RESPONSE_GZIP),
+                       sizeof(TEST_GET_MY_NODE_READY_RESPONSE_GZIP));
+}
+
+void test_inflate_gzip_stream(void) {
+    static uint8_t window[INFLATE_WINDOW_SIZE];
+    Inflater inflater(TEST_GET_MY_NODE_READY_RESPONSE_GZIP, sizeof(TEST_GET_MY_NODE_READY_RESPONSE_GZIP), window,
+                      sizeof(window));
+    std::string inflated;
+    int byte;
+    while ((byte = inflater.read()) >= 0) {
+        inflated += static_cast<char>(byte);
+    }
+    TEST_ASSERT_FALSE(inflater.error());
+    TEST_ASSERT_EQUAL_STRING(TEST_GET_MY_NODE_READY_RESPONSE.c_str(), inflated.c_str());
+    TEST_ASSERT_EQUAL(TEST_GET_MY_NODE_READY_RESPONSE.size(), inflater.totalOut());
+
+    // A truncated stream is reported instead of silently ending early
+    Inflater truncated(TEST_GET_MY_NODE_READY_RESPONSE_GZIP, 200, window, sizeof(window));
+    char buffer[1024];
+    truncated.readBytes(buffer, sizeof(buffer));
+    TEST_ASSERT_TRUE(truncated.error());
+}
+
+void test_inflate_compressed_response(void) {
+    WiFi.setStatus(WL_CONNECTED);
+    std::string valid_pub_key(64, 'a');
+    std::string valid_priv_key(64, 'b');
+
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        return {200, gzipFixture(), {{"Content-Encoding", "gzip"}}};
+    });
+    BlockchainHandler handler(valid_pub_key, valid_priv_key, true, "http://test.url/chain/19/pact/api/v1/");
+    TEST_ASSERT_EQUAL(BlockchainStatus::READY, handler.executeBlockchainCommand(PactCall::GET_MY_NODE));
+
+    static uint8_t buffer[BLOCKCHAIN_ARENA_MIN_SIZE];
+    Arena arena(buffer, sizeof(buffer));
+    BlockchainHandler arenaHandler(valid_pub_key, valid_priv_key, true, "http://test.url/chain/19/pact/api/v1/", &arena);
+    TEST_ASSERT_EQUAL(BlockchainStatus::READY, arenaHandler.executeBlockchainCommand(PactCall::GET_MY_NODE));
+
+    // A corrupt body is a parsing error, not a partial decode
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        return {200, gzipFixture().substr(0, 300), {{"Content-Encoding", "gzip"}}};
+    });
+    TEST_ASSERT_EQUAL(BlockchainStatus::PARSING_ERROR, handler.executeBlockchainCommand(PactCall::GET_MY_NODE));
+    HTTPClient::setResponder(nullptr);
+}
+
+// Writes DEFLATE bits least significant first; Huffman codes go in most significant bit first
+struct DeflateBits {
+    std::string data;
+    int used = 8;
+
+    void put(uint32_t value, int count)
+    {
+        for (int i = 0; i < count; i++) {
+            if (used == 8) {
+                data += '\0';
+                used = 0;
+            }
+            data.back() |= static_cast<char>(((value >> i) & 1) << used++);
+        }
+    }
+
+    void code(uint32_t code, int length)
+    {
+        for (int i = length - 1; i >= 0; i--) {
+            put(code >> i, 1);
+        }
+    }
+
+    void literal(uint8_t c) { code(0x30 + c, 8); } // Fixed code for literals 0..143
+};
+
+// A raw DEFLATE stream whose second block copies padding from 4990 bytes back, beyond a 4 KiB window
+static std::string farReferenceStream(const std::string &head, const std::string &tail)
+{
+    DeflateBits stream;
+    std::string stored = head + std::string(5000 - head.size(), 'x');
+    stream.put(0, 3); // Stored block, not final
+    stream.used = 8;
+    uint16_t length = static_cast<uint16_t>(stored.size());
+    stream.data += static_cast<char>(length & 0xff);
+    stream.data += static_cast<char>(length >> 8);
+    stream.data += static_cast<char>(~length & 0xff);
+    stream.data += static_cast<char>(~length >> 8);
+    stream.data += stored;
+
+    stream.put(1, 1); // Fixed Huffman block, final
+    stream.put(1, 2);
+    stream.code(264 - 256, 7); // Length 10
+    stream.code(24, 5);        // Distance 4097 + 893 = 4990
+    stream.put(893, 11);
+    for (char c : tail) {
+        stream.literal(static_cast<uint8_t>(c));
+    }
+    stream.code(0, 7); // End of block
+    return stream.data;
+}
+
+void test_inflate_far_reference(void) {
+    const std::string head = "{\"pad\":\"";
+    const std::string tail = "\",\"result\":{\"status\":\"success\",\"data\":{\"send\":true}}}";
+    static std::string stream;
+    stream = farReferenceStream(head, tail);
+    static std::string expected;
+    expected = head + std::string(5000 - head.size() + 10, 'x') + tail;
+
+    static uint8_t small[INFLATE_WINDOW_SIZE];
+    Inflater limited(reinterpret_cast<const uint8_t *>(stream.data()), stream.size(), small, 4096);
+    char buffer[6000];
+    limited.readBytes(buffer, sizeof(buffer));
+    TEST_ASSERT_TRUE(limited.error());
+    TEST_ASSERT_TRUE(limited.windowExceeded());
+
+    static uint8_t full[32768];
+    Inflater complete(reinterpret_cast<const uint8_t *>(stream.data()), stream.size(), full, sizeof(full));
+    size_t produced = complete.readBytes(buffer, sizeof(buffer));
+    TEST_ASSERT_FALSE(complete.error());
+    TEST_ASSERT_EQUAL(expected.size(), produced);
+    TEST_ASSERT_EQUAL_MEMORY(expected.data(), buffer, produced);
+
+    // The handler asks again without compression instead of failing the call
+    WiFi.setStatus(WL_CONNECTED);
+    static int requests;
+    requests = 0;
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        if (requests++ == 0) {
+            return {200, stream, {{"Content-Encoding", "deflate"}}};
+        }
+        return {200, expected};
+    });
+    BlockchainHandler handler(std::string(64, 'a'), std::string(64, 'b'), true, "http://test.url/chain/19/pact/api/v1/");
+    TEST_ASSERT_EQUAL(BlockchainStatus::READY, handler.executeBlockchainCommand(PactCall::GET_MY_NODE));
+    TEST_ASSERT_EQUAL(2, requests);
+    HTTPClient::setResponder(nullptr);
+}
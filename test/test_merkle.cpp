@@ -0,0 +1,135 @@
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <cstring>
+#include <vector>
+#include "BLAKE2b.h"
+#include "BeaconBatch.h"
+#include "BlockchainHandler.h"
+#include "MerkleTree.h"
+#include "test_fixtures.h"
+
+typedef std::vector<uint8_t> Hash;
+
+static Hash blake2b256(const std::vector<uint8_t> &data)
+{
+    Hash hash(MERKLE_HASH_SIZE);
+    BLAKE2b blake;
+    blake.reset(MERKLE_HASH_SIZE);
+    blake.update(data.data(), data.size());
+    blake.finalize(hash.data(), hash.size());
+    return hash;
+}
+
+// Straightforward recursive definition: pair neighbours, carry an odd node up
+static Hash referenceRoot(std::vector<Hash> level)
+{
+    while (level.size() > 1) {
+        std::vector<Hash> parents;
+        for (size_t i = 0; i < level.size(); i += 2) {
+            if (i + 1 == level.size()) {
+                parents.push_back(level[i]);
+                continue;
+            }
+            std::vector<uint8_t> pair(1, MERKLE_NODE_TAG);
+            pair.insert(pair.end(), level[i].begin(), level[i].end());
+            pair.insert(pair.end(), level[i + 1].begin(), level[i + 1].end());
+            parents.push_back(blake2b256(pair));
+        }
+        level = parents;
+    }
+    return level[0];
+}
+
+void test_merkle_tree_incremental(void) {
+    std::vector<Hash> leaves;
+    MerkleTree tree;
+    TEST_ASSERT_NULL(tree.root());
+
+    // Appending in uneven steps, with the root taken in between, matches building from scratch
+    size_t steps[] = {1, 1, 1, 2, 3, 5, 8, 13, 21, 34, 1};
+    uint8_t counter = 0;
+    for (size_t step : steps) {
+        std::vector<uint8_t> hashes(step * MERKLE_HASH_SIZE);
+        for (size_t i = 0; i < step; i++) {
+            std::vector<uint8_t> data = {MERKLE_LEAF_TAG, counter++};
+            leaves.push_back(blake2b256(data));
+            memcpy(&hashes[i * MERKLE_HASH_SIZE], leaves.back().data(), MERKLE_HASH_SIZE);
+        }
+        tree.append(reinterpret_cast<const uint8_t(*)[MERKLE_HASH_SIZE]>(hashes.data()), step);
+        TEST_ASSERT_EQUAL(leaves.size(), tree.leafCount());
+        TEST_ASSERT_EQUAL_MEMORY(referenceRoot(leaves).data(), tree.root(), MERKLE_HASH_SIZE);
+    }
+
+    // Every leaf proves against the root, and only at its own position
+    const uint8_t *root = tree.root();
+    for (size_t i = 0; i < leaves.size(); i++) {
+        MerkleProof proof;
+        TEST_ASSERT_TRUE(tree.proof(i, proof));
+        TEST_ASSERT_TRUE(MerkleTree::verify(leaves[i].data(), proof, root));
+        TEST_ASSERT_FALSE(MerkleTree::verify(leaves[(i + 1) % leaves.size()].data(), proof, root));
+
+        uint8_t encoded[9 + MERKLE_MAX_DEPTH * MERKLE_HASH_SIZE];
+        size_t length = proof.encode(encoded, sizeof(encoded));
+        TEST_ASSERT_TRUE(length > 0);
+        MerkleProof decoded;
+        TEST_ASSERT_TRUE(decoded.decode(encoded, length));
+        TEST_ASSERT_TRUE(MerkleTree::verify(leaves[i].data(), decoded, root));
+        TEST_ASSERT_FALSE(decoded.decode(encoded, length - 1));
+    }
+    MerkleProof proof;
+    TEST_ASSERT_FALSE(tree.proof(leaves.size(), proof));
+
+    tree.clear();
+    TEST_ASSERT_NULL(tree.root());
+}
+
+void test_beacon_batch_submission(void) {
+    std::string gatewayKey(64, 'a');
+    BlockchainHandler gateway(gatewayKey, std::string(64, 'b'), true, "http://test.url/chain/19/pact/api/v1/");
+
+    BeaconBatch batch;
+    const char *nodeKeys[] = {"11", "22", "33"};
+    for (uint32_t i = 0; i < 3; i++) {
+        std::string key;
+        for (int j = 0; j < 32; j++) {
+            key += nodeKeys[i];
+        }
+        TEST_ASSERT_EQUAL(i, batch.add(key, 0x100 + i, ("secret-" + std::to_string(i)).c_str()));
+    }
+    TEST_ASSERT_EQUAL(-1, batch.add("not-a-key", 1, "secret"));
+    TEST_ASSERT_EQUAL(-1, batch.add(std::string(64, 'x'), 1, "secret"));
+
+    static std::string sent;
+    WiFi.setStatus(WL_CONNECTED);
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        sent = body;
+        return {200, TEST_SEND_RESPONSE};
+    });
+    TEST_ASSERT_EQUAL(BlockchainStatus::SUCCESS, gateway.submitBeaconBatch(batch));
+    HTTPClient::setResponder(nullptr);
+
+    // One transaction carrying the root and the node keys, with gas for all of them
+    JsonDocument request;
+    deserializeJson(request, sent);
+    JsonDocument cmd;
+    deserializeJson(cmd, request["cmds"][0]["cmd"].as<const char *>());
+    std::string code = cmd["payload"]["exec"]["code"].as<std::string>();
+    EncryptionHandler encryption;
+    std::string root = encryption.KDAhash(batch.root()).c_str();
+    TEST_ASSERT_EQUAL_STRING(("(free.mesh03.update-sent-batch \"" + root + "\" [\"" + std::string(64, '1') + "\", \"" +
+                              std::string(64, '2') + "\", \"" + std::string(64, '3') + "\"])").c_str(),
+                             code.c_str());
+    TEST_ASSERT_EQUAL(BEACON_BATCH_GAS_BASE + 3 * BEACON_BATCH_GAS_PER_LEAF, cmd["meta"]["gasLimit"].as<uint32_t>());
+
+    // The director checks a node's secret against the committed root
+    MerkleProof proof;
+    TEST_ASSERT_TRUE(batch.proof(1, proof));
+    uint8_t leaf[MERKLE_HASH_SIZE];
+    TEST_ASSERT_TRUE(BeaconBatch::leafHash(std::string(64, '2'), 0x101, "secret-1", leaf));
+    TEST_ASSERT_TRUE(MerkleTree::verify(leaf, proof, batch.root()));
+    TEST_ASSERT_TRUE(BeaconBatch::leafHash(std::string(64, '2'), 0x101, "secret-X", leaf));
+    TEST_ASSERT_FALSE(MerkleTree::verify(leaf, proof, batch.root()));
+
+    batch.clear();
+    TEST_ASSERT_EQUAL(BlockchainStatus::FAILURE, gateway.submitBeaconBatch(batch));
+}
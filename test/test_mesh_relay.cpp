@@ -0,0 +1,310 @@
+#include <unity.h>
+#include <vector>
+#include "BlockchainHandler.h"
+#include "MeshRelay.h"
+#include "test_fixtures.h"
+
+
+void test_mesh_relay_codec(void) {
+    RelayCommand command;
+    command.call = PactCall::UPDATE_SENT;
+    command.chainId = 19;
+    command.creationTime = 1700000000;
+    command.nonceMs = 1700000000123ULL;
+    command.nonceCounter = 0xabc123;
+    memset(command.publicKey, 0xaa, sizeof(command.publicKey));
+    memset(command.signature, 0x5c, sizeof(command.signature));
+    memset(command.hashCheck, 0x01, sizeof(command.hashCheck));
+    command.argument = "U2FsdGVkX1+AAAAAAAAAAP7Jw0eDD6f6/qJJGpt5A0w=;;;;;" + TEST_PUBLIC_KEY_BASE64;
+
+    // Encrypted arguments travel as raw bytes and come back as the same base64 text
+    uint8_t message[MESH_RELAY_MAX_MESSAGE];
+    size_t length = encodeRelayCommand(command, message, sizeof(message));
+    TEST_ASSERT_TRUE(length > 0);
+    TEST_ASSERT_TRUE(length < command.argument.length() + 117);
+    RelayCommand decoded;
+    TEST_ASSERT_TRUE(decodeRelayCommand(message, length, decoded));
+    TEST_ASSERT_EQUAL_STRING(command.argument.c_str(), decoded.argument.c_str());
+    TEST_ASSERT_EQUAL(command.nonceCounter, decoded.nonceCounter);
+    TEST_ASSERT_TRUE(command.nonceMs == decoded.nonceMs);
+    TEST_ASSERT_FALSE(decodeRelayCommand(message, length - 1, decoded));
+
+    // Fragments arrive out of order, duplicated and interleaved with another sender's
+    std::vector<std::vector<uint8_t>> fragments;
+    size_t count = fragmentRelayMessage(message, length, 0x1234, [&](const uint8_t *fragment, size_t size) {
+        TEST_ASSERT_TRUE(size <= MESH_RELAY_PACKET_SIZE);
+        fragments.emplace_back(fragment, fragment + size);
+    });
+    TEST_ASSERT_EQUAL(2, count);
+
+    static MeshRelayReassembler reassembler;
+    TEST_ASSERT_FALSE(reassembler.add(1, fragments[1].data(), fragments[1].size()));
+    TEST_ASSERT_FALSE(reassembler.add(2, fragments[0].data(), fragments[0].size()));
+    TEST_ASSERT_FALSE(reassembler.add(1, fragments[1].data(), fragments[1].size()));
+    TEST_ASSERT_TRUE(reassembler.add(1, fragments[0].data(), fragments[0].size()));
+    TEST_ASSERT_EQUAL(length, reassembler.length());
+    TEST_ASSERT_EQUAL_MEMORY(message, reassembler.message(), length);
+}
+
+void test_mesh_relay_gateway_submission(void) {
+    std::string valid_pub_key(64, 'a');
+    std::string valid_priv_key(64, 'b');
+    BlockchainHandler node(valid_pub_key, valid_priv_key, true, "http://test.url/chain/19/pact/api/v1/");
+    BlockchainHandler gateway(std::string(64, 'c'), std::string(64, 'd'), true, "http://test.url/chain/0/pact/api/v1/");
+
+    static std::vector<std::vector<uint8_t>> packets;
+    packets.clear();
+    node.setMeshRelay([](const uint8_t *fragment, size_t size) { packets.emplace_back(fragment, fragment + size); });
+
+    // An earlier sync over WiFi taught the node the director key
+    WiFi.setStatus(WL_CONNECTED);
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        return {200, TEST_GET_MY_NODE_READY_RESPONSE};
+    });
+    TEST_ASSERT_EQUAL(BlockchainStatus::READY, node.executeBlockchainCommand(PactCall::GET_MY_NODE));
+
+    // Without WiFi the sync goes out over the mesh instead of being skipped; the radio beacon
+    // waits for the gateway's ack, and nothing more is relayed while it is outstanding
+    WiFi.setStatus(WL_DISCONNECTED);
+    static uint32_t beaconPacketId;
+    beaconPacketId = 0;
+    auto packetIdGen = []() -> uint32_t { return 0xbeef; };
+    auto onSecretGen = [](uint32_t packetId) { beaconPacketId = packetId; };
+    node.performNodeSync("node-1", packetIdGen, onSecretGen);
+    TEST_ASSERT_EQUAL(0, beaconPacketId);
+    TEST_ASSERT_EQUAL(2, packets.size());
+    node.performNodeSync("node-1", packetIdGen, onSecretGen);
+    TEST_ASSERT_EQUAL(2, packets.size());
+
+    static MeshRelayReassembler reassembler;
+    bool complete = false;
+    for (const auto &packet : packets) {
+        complete = reassembler.add(42, packet.data(), packet.size());
+    }
+    TEST_ASSERT_TRUE(complete);
+
+    // The gateway posts the node's command to the node's chain
+    static String postedUrl, postedBody;
+    WiFi.setStatus(WL_CONNECTED);
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        postedUrl = url;
+        postedBody = body;
+        return {200, TEST_SEND_RESPONSE};
+    });
+    static std::vector<uint8_t> ack;
+    ack.clear();
+    gateway.setRelayAckSender([](size_t index, const uint8_t *frame, size_t size) {
+        TEST_ASSERT_EQUAL(0, index);
+        ack.assign(frame, frame + size);
+    });
+    TEST_ASSERT_EQUAL(BlockchainStatus::SUCCESS, gateway.submitRelayedCommand(reassembler.message(), reassembler.length()));
+    TEST_ASSERT_EQUAL_STRING("http://test.url/chain/19/pact/api/v1/send", postedUrl.c_str());
+    TEST_ASSERT_TRUE(postedBody.indexOf("(free.mesh03.update-sent") >= 0);
+    TEST_ASSERT_TRUE(postedBody.indexOf(String(valid_pub_key)) >= 0);
+
+    // The ack releases the beacon, once; after it the node is not due, so it relays nothing more
+    TEST_ASSERT_EQUAL(MESH_RELAY_ACK_SIZE, ack.size());
+    TEST_ASSERT_FALSE(reassembler.add(42, ack.data(), ack.size()));
+    std::vector<uint8_t> otherAck = ack;
+    otherAck.back() ^= 1;
+    TEST_ASSERT_FALSE(node.onRelayAck(otherAck.data(), otherAck.size()));
+    TEST_ASSERT_TRUE(node.onRelayAck(ack.data(), ack.size()));
+    TEST_ASSERT_EQUAL(0xbeef, beaconPacketId);
+    TEST_ASSERT_FALSE(node.onRelayAck(ack.data(), ack.size()));
+    WiFi.setStatus(WL_DISCONNECTED);
+    node.performNodeSync("node-1", packetIdGen, onSecretGen);
+    TEST_ASSERT_EQUAL(2, packets.size());
+    WiFi.setStatus(WL_CONNECTED);
+
+    // A message whose fields no longer match the signed hash is rejected before submission
+    std::vector<uint8_t> corrupted(reassembler.message(), reassembler.message() + reassembler.length());
+    corrupted[4] ^= 1;
+    TEST_ASSERT_EQUAL(BlockchainStatus::PARSING_ERROR, gateway.submitRelayedCommand(corrupted.data(), corrupted.size()));
+    HTTPClient::setResponder(nullptr);
+}
+
+void test_mesh_relay_gateway_batch(void) {
+    // Three nodes, two on chain 19 and one on chain 3, relay through one gateway
+    std::string chain19 = "http://test.url/chain/19/pact/api/v1/";
+    BlockchainHandler nodeA(std::string(64, 'a'), std::string(64, 'b'), true, chain19);
+    BlockchainHandler nodeB(std::string(64, 'e'), std::string(64, 'f'), true, chain19);
+    BlockchainHandler nodeC(std::string(64, '1'), std::string(64, '2'), true, "http://test.url/chain/3/pact/api/v1/");
+    BlockchainHandler gateway(std::string(64, 'c'), std::string(64, 'd'), true, "http://test.url/chain/0/pact/api/v1/");
+
+    static std::vector<std::vector<uint8_t>> messages;
+    static MeshRelayReassembler reassembler;
+    messages.clear();
+    MeshRelaySender collect = [](const uint8_t *fragment, size_t size) {
+        if (reassembler.add(7, fragment, size)) {
+            messages.emplace_back(reassembler.message(), reassembler.message() + reassembler.length());
+        }
+    };
+    nodeA.setMeshRelay(collect);
+    nodeB.setMeshRelay(collect);
+    nodeC.setMeshRelay(collect);
+    TEST_ASSERT_TRUE(nodeA.relayCommand(PactCall::INSERT_MY_NODE, "node-a"));
+    TEST_ASSERT_TRUE(nodeB.relayCommand(PactCall::INSERT_MY_NODE, "node-b"));
+    TEST_ASSERT_TRUE(nodeC.relayCommand(PactCall::INSERT_MY_NODE, "node-c"));
+    TEST_ASSERT_EQUAL(3, messages.size());
+
+    static std::vector<String> postedUrls, postedBodies;
+    postedUrls.clear();
+    postedBodies.clear();
+    WiFi.setStatus(WL_CONNECTED);
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        postedUrls.push_back(url);
+        postedBodies.push_back(body);
+        return {200, TEST_SEND_RESPONSE};
+    });
+
+    // One request per chain, in chain order, carrying every command for that chain
+    const uint8_t *batch[4];
+    size_t lengths[4];
+    for (size_t i = 0; i < messages.size(); i++) {
+        batch[i] = messages[i].data();
+        lengths[i] = messages[i].size();
+    }
+    TEST_ASSERT_EQUAL(BlockchainStatus::SUCCESS, gateway.submitRelayedCommands(batch, lengths, 3));
+    TEST_ASSERT_EQUAL(2, postedUrls.size());
+    TEST_ASSERT_EQUAL_STRING("http://test.url/chain/3/pact/api/v1/send", postedUrls[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("http://test.url/chain/19/pact/api/v1/send", postedUrls[1].c_str());
+    JsonDocument request;
+    TEST_ASSERT_FALSE(deserializeJson(request, postedBodies[1].c_str()));
+    TEST_ASSERT_EQUAL(2, request["cmds"].size());
+    TEST_ASSERT_TRUE(postedBodies[1].indexOf("node-a") >= 0);
+    TEST_ASSERT_TRUE(postedBodies[1].indexOf("node-b") >= 0);
+    TEST_ASSERT_TRUE(postedBodies[0].indexOf("node-c") >= 0);
+
+    // A corrupted message is dropped while the rest still go out
+    std::vector<uint8_t> corrupted = messages[0];
+    corrupted[4] ^= 1;
+    batch[3] = corrupted.data();
+    lengths[3] = corrupted.size();
+    postedUrls.clear();
+    postedBodies.clear();
+    TEST_ASSERT_EQUAL(BlockchainStatus::PARSING_ERROR, gateway.submitRelayedCommands(batch + 1, lengths + 1, 3));
+    TEST_ASSERT_EQUAL(2, postedUrls.size());
+    TEST_ASSERT_TRUE(postedBodies[1].indexOf("node-b") >= 0);
+    TEST_ASSERT_TRUE(postedBodies[1].indexOf("node-a") < 0);
+    HTTPClient::setResponder(nullptr);
+}
+
+void test_mesh_relay_gateway_arena_chunks(void) {
+    // More relayed commands than one arena holds at once
+    const size_t count = 12;
+    BlockchainHandler node(std::string(64, 'a'), std::string(64, 'b'), true, "http://test.url/chain/19/pact/api/v1/");
+    static uint8_t buffer[BLOCKCHAIN_ARENA_MIN_SIZE];
+    Arena arena(buffer, sizeof(buffer));
+    BlockchainHandler gateway(std::string(64, 'c'), std::string(64, 'd'), true, "http://test.url/chain/0/pact/api/v1/",
+                              &arena);
+
+    static std::vector<std::vector<uint8_t>> messages;
+    static MeshRelayReassembler reassembler;
+    messages.clear();
+    node.setMeshRelay([](const uint8_t *fragment, size_t size) {
+        if (reassembler.add(9, fragment, size)) {
+            messages.emplace_back(reassembler.message(), reassembler.message() + reassembler.length());
+        }
+    });
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT_TRUE(node.relayCommand(PactCall::INSERT_MY_NODE, String("node-") + String((unsigned)i)));
+    }
+    TEST_ASSERT_EQUAL(count, messages.size());
+
+    static size_t posted;
+    static size_t commands;
+    posted = 0;
+    commands = 0;
+    WiFi.setStatus(WL_CONNECTED);
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        JsonDocument request;
+        TEST_ASSERT_FALSE(deserializeJson(request, body.c_str()));
+        posted++;
+        commands += request["cmds"].size();
+        return {200, TEST_SEND_RESPONSE};
+    });
+    static std::vector<size_t> acked;
+    acked.clear();
+    gateway.setRelayAckSender([](size_t index, const uint8_t *frame, size_t size) { acked.push_back(index); });
+
+    // The batch goes out in several requests instead of failing as a whole
+    const uint8_t *batch[count];
+    size_t lengths[count];
+    for (size_t i = 0; i < count; i++) {
+        batch[i] = messages[i].data();
+        lengths[i] = messages[i].size();
+    }
+    TEST_ASSERT_EQUAL(BlockchainStatus::SUCCESS, gateway.submitRelayedCommands(batch, lengths, count));
+    TEST_ASSERT_TRUE(posted > 1);
+    TEST_ASSERT_EQUAL(count, commands);
+    TEST_ASSERT_EQUAL(count, acked.size());
+    TEST_ASSERT_EQUAL(count - 1, acked.back());
+    TEST_ASSERT_FALSE(arena.exhausted());
+    HTTPClient::setResponder(nullptr);
+}
+
+void test_mesh_relay_rejects_local_calls(void) {
+    BlockchainHandler node(std::string(64, 'a'), std::string(64, 'b'), true, "http://test.url/chain/19/pact/api/v1/");
+    BlockchainHandler gateway(std::string(64, 'c'), std::string(64, 'd'), true, "http://test.url/chain/0/pact/api/v1/");
+    static int posts;
+    posts = 0;
+    node.setMeshRelay([](const uint8_t *fragment, size_t size) { posts++; });
+    TEST_ASSERT_FALSE(node.relayCommand(PactCall::GET_MY_NODE));
+    TEST_ASSERT_EQUAL(0, posts);
+
+    // A /local call forged into a relay message is dropped before anything is posted or decoded
+    WiFi.setStatus(WL_CONNECTED);
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        posts++;
+        return {200, TEST_GET_MY_NODE_READY_RESPONSE};
+    });
+    RelayCommand command;
+    command.call = PactCall::GET_MY_NODE;
+    command.chainId = 19;
+    command.creationTime = 1700000000;
+    command.nonceMs = 1700000000123ULL;
+    command.nonceCounter = 1;
+    memset(command.publicKey, 0xaa, sizeof(command.publicKey));
+    memset(command.signature, 0x5c, sizeof(command.signature));
+    memset(command.hashCheck, 0x01, sizeof(command.hashCheck));
+    uint8_t message[MESH_RELAY_MAX_MESSAGE];
+    size_t length = encodeRelayCommand(command, message, sizeof(message));
+    RelayCommand decoded;
+    TEST_ASSERT_FALSE(decodeRelayCommand(message, length, decoded));
+    TEST_ASSERT_EQUAL(BlockchainStatus::PARSING_ERROR, gateway.submitRelayedCommand(message, length));
+    TEST_ASSERT_EQUAL(0, posts);
+    TEST_ASSERT_EQUAL(0, gateway.chainHeight());
+    HTTPClient::setResponder(nullptr);
+}
+
+void test_mesh_relay_seeded_node_resends(void) {
+    BlockchainHandler node(std::string(64, 'a'), std::string(64, 'b'), true, "http://test.url/chain/19/pact/api/v1/");
+    static int relays;
+    relays = 0;
+    node.setMeshRelay([](const uint8_t *fragment, size_t size) {
+        // Count messages, not fragments
+        relays += fragment[2] >> 4 == 0;
+    });
+    static int beacons;
+    beacons = 0;
+    auto packetIdGen = []() -> uint32_t { return 0xbeef; };
+    auto onSecretGen = [](uint32_t packetId) { beacons++; };
+
+    // A node that has never had WiFi relays nothing until provisioning seeds the key and due state
+    WiFi.setStatus(WL_DISCONNECTED);
+    node.performNodeSync("node-1", packetIdGen, onSecretGen);
+    TEST_ASSERT_EQUAL(0, relays);
+    node.seedRelayState(TEST_PUBLIC_KEY_BASE64, true);
+    node.performNodeSync("node-1", packetIdGen, onSecretGen);
+    TEST_ASSERT_EQUAL(1, relays);
+
+    // With the ack lost the node waits out the timeout, then relays again; no beacon went out meanwhile
+    for (int i = 0; i < MESH_RELAY_ACK_TIMEOUT_SYNCS; i++) {
+        node.performNodeSync("node-1", packetIdGen, onSecretGen);
+    }
+    TEST_ASSERT_EQUAL(1, relays);
+    node.performNodeSync("node-1", packetIdGen, onSecretGen);
+    TEST_ASSERT_EQUAL(2, relays);
+    TEST_ASSERT_EQUAL(0, beacons);
+    WiFi.setStatus(WL_CONNECTED);
+}
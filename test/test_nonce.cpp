@@ -0,0 +1,28 @@
+#include <unity.h>
+#include "NonceGenerator.h"
+#include <set>
+#include <string>
+
+
+void test_nonce_format(void) {
+    NonceGenerator generator;
+    char nonce[NONCE_BUFFER_SIZE];
+
+    TEST_ASSERT_EQUAL(NONCE_LENGTH, generator.next(nonce, 0));
+    TEST_ASSERT_EQUAL_STRING("1970-01-01 00:00:00.000 UTC-00000000", nonce);
+
+    generator.next(nonce, 1700000000123ULL);
+    TEST_ASSERT_EQUAL_STRING("2023-11-14 22:13:20.123 UTC-00000001", nonce);
+}
+
+void test_nonce_unique_within_same_millisecond(void) {
+    NonceGenerator generator;
+    char nonce[NONCE_BUFFER_SIZE];
+    std::set<std::string> seen;
+
+    for (int i = 0; i < 1000; i++) {
+        generator.next(nonce, 1700000000000ULL);
+        seen.insert(nonce);
+    }
+    TEST_ASSERT_EQUAL(1000, seen.size());
+}
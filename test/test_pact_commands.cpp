@@ -0,0 +1,114 @@
+#include <unity.h>
+#include "BlockchainHandler.h"
+#include "PactCommands.h"
+#include "test_fixtures.h"
+
+
+void test_pact_code_building(void) {
+    TEST_ASSERT_EQUAL_STRING("(free.mesh03.get-my-node)", buildPactCode(PactCall::GET_MY_NODE).c_str());
+    TEST_ASSERT_EQUAL_STRING("(free.mesh03.insert-my-node \"node-1\")",
+                             buildPactCode(PactCall::INSERT_MY_NODE, "node-1").c_str());
+    TEST_ASSERT_EQUAL_STRING("(free.mesh03.insert-my-node \"a\\\"b\")",
+                             buildPactCode(PactCall::INSERT_MY_NODE, "a\"b").c_str());
+
+    TEST_ASSERT_EQUAL(PactCall::GET_MY_NODE, pactCallFromCode("(free.mesh03.get-my-node)"));
+    TEST_ASSERT_EQUAL(PactCall::UPDATE_SENT, pactCallFromCode("(free.mesh03.update-sent \"x\")"));
+    TEST_ASSERT_EQUAL(PactCall::RAW, pactCallFromCode("(free.mesh03.get-my-node-extra)"));
+    TEST_ASSERT_EQUAL(PactEndpoint::SEND, pactCommand(PactCall::UPDATE_SENT).endpoint);
+}
+
+void test_pact_typed_decoding(void) {
+    WiFi.setStatus(WL_CONNECTED);
+    std::string valid_pub_key(64, 'a');
+    std::string valid_priv_key(64, 'b');
+    BlockchainHandler handler(valid_pub_key, valid_priv_key, true, "http://test.url/chain/19/pact/api/v1/");
+
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        return {200, TEST_GET_MY_NODE_READY_RESPONSE};
+    });
+    TEST_ASSERT_EQUAL(BlockchainStatus::READY, handler.executeBlockchainCommand(PactCall::GET_MY_NODE));
+
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        return {200, "{\"result\":{\"status\":\"failure\",\"error\":{\"message\":\"row not found\"}}}"};
+    });
+    TEST_ASSERT_EQUAL(BlockchainStatus::NODE_NOT_FOUND, handler.executeBlockchainCommand(PactCall::GET_MY_NODE));
+    TEST_ASSERT_EQUAL(BlockchainStatus::FAILURE, handler.executeBlockchainCommand(PactCall::GET_SENDER_DETAILS));
+    HTTPClient::setResponder(nullptr);
+}
+
+void test_node_query_building(void) {
+    std::vector<std::string> ids = {"node-a", "node-b", "q\"uote"};
+    size_t count;
+    TEST_ASSERT_EQUAL_STRING(
+        "(map (lambda (id) (try false (free.mesh03.get-node id))) [\"node-a\", \"node-b\", \"q\\\"uote\"])",
+        buildNodeQueryCode(ids, 0, NODE_QUERY_MAX_CODE_SIZE, count).c_str());
+    TEST_ASSERT_EQUAL(3, count);
+
+    // The cap stops the list at the last key that fits, closing brackets included
+    String code = buildNodeQueryCode(ids, 1, 70, count);
+    TEST_ASSERT_EQUAL(1, count);
+    TEST_ASSERT_EQUAL_STRING("(map (lambda (id) (try false (free.mesh03.get-node id))) [\"node-b\"])", code.c_str());
+    TEST_ASSERT_TRUE(code.length() <= 70);
+    buildNodeQueryCode(ids, 0, 60, count);
+    TEST_ASSERT_EQUAL(0, count);
+    buildNodeQueryCode(ids, 3, NODE_QUERY_MAX_CODE_SIZE, count);
+    TEST_ASSERT_EQUAL(0, count);
+}
+
+void test_node_query_decoding(void) {
+    WiFi.setStatus(WL_CONNECTED);
+    BlockchainHandler gateway(std::string(64, 'a'), std::string(64, 'b'), true, "http://test.url/chain/19/pact/api/v1/");
+
+    // Keys ending in 1 are due, in 2 unregistered, in 3 not due
+    std::vector<std::string> ids;
+    for (int i = 0; i < 9; i++) {
+        ids.push_back(std::string(63, 'f') + static_cast<char>('1' + i % 3));
+    }
+
+    static int requests;
+    static uint32_t gasLimit;
+    requests = 0;
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        requests++;
+        JsonDocument request, cmd;
+        deserializeJson(request, body);
+        deserializeJson(cmd, request["cmd"].as<const char *>());
+        gasLimit = cmd["meta"]["gasLimit"];
+        std::string code = cmd["payload"]["exec"]["code"].as<std::string>();
+        std::string data;
+        for (size_t at = code.find("\"ff"); at != std::string::npos; at = code.find("\"ff", at + 1)) {
+            char last = code[at + 64];
+            data += data.empty() ? "" : ",";
+            data += last == '1'   ? "{\"send\":true,\"pubkeyd\":\"director\"}"
+                    : last == '2' ? "false"
+                                  : "{\"send\":false,\"pubkeyd\":\"director\"}";
+        }
+        return {200, "{\"result\":{\"status\":\"success\",\"data\":[" + data + "]},\"metaData\":{\"blockHeight\":7}}"};
+    });
+
+    std::vector<NodeQueryResult> results;
+    TEST_ASSERT_EQUAL(BlockchainStatus::SUCCESS, gateway.queryNodeStatuses(ids, results));
+    TEST_ASSERT_EQUAL(1, requests);
+    TEST_ASSERT_EQUAL(PACT_GAS_LIMIT + 9 * NODE_QUERY_GAS_PER_NODE, gasLimit);
+    TEST_ASSERT_EQUAL(ids.size(), results.size());
+    for (size_t i = 0; i < ids.size(); i++) {
+        BlockchainStatus expected[] = {BlockchainStatus::READY, BlockchainStatus::NODE_NOT_FOUND, BlockchainStatus::NOT_DUE};
+        TEST_ASSERT_EQUAL(expected[i % 3], results[i].status);
+        TEST_ASSERT_EQUAL_STRING(i % 3 == 1 ? "" : "director", results[i].directorKey.c_str());
+    }
+    TEST_ASSERT_EQUAL(7, gateway.chainHeight());
+
+    // A tighter cap splits the query: four keys per /local here
+    requests = 0;
+    TEST_ASSERT_EQUAL(BlockchainStatus::SUCCESS, gateway.queryNodeStatuses(ids, results, 360));
+    TEST_ASSERT_EQUAL(3, requests);
+    TEST_ASSERT_EQUAL(BlockchainStatus::NOT_DUE, results[8].status);
+
+    // A reply with the wrong number of entries fails its chunk
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        return {200, "{\"result\":{\"status\":\"success\",\"data\":[false]}}"};
+    });
+    TEST_ASSERT_EQUAL(BlockchainStatus::PARSING_ERROR, gateway.queryNodeStatuses(ids, results));
+    TEST_ASSERT_EQUAL(BlockchainStatus::PARSING_ERROR, results[0].status);
+    HTTPClient::setResponder(nullptr);
+}
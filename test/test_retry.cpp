@@ -0,0 +1,195 @@
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <vector>
+#include "Arena.h"
+#include "BlockchainHandler.h"
+#include "test_fixtures.h"
+
+struct RecordedRequest {
+    std::string endpoint;
+    std::string body;
+};
+
+static std::vector<RecordedRequest> requests;
+static std::vector<uint32_t> sleeps;
+
+static void record(const String &url, const String &body)
+{
+    requests.push_back({url.substr(url.rfind('/') + 1), body});
+}
+
+static std::string requestKey(const std::string &sendBody)
+{
+    JsonDocument doc;
+    deserializeJson(doc, sendBody);
+    return doc["cmds"][0]["hash"].as<std::string>();
+}
+
+static void setUpRetry(BlockchainHandler &handler)
+{
+    requests.clear();
+    sleeps.clear();
+    WiFi.setStatus(WL_CONNECTED);
+    handler.setRetrySleep([](uint32_t ms) { sleeps.push_back(ms); });
+}
+
+void test_retry_resends_signed_bytes(void) {
+    BlockchainHandler handler(std::string(64, 'a'), std::string(64, 'b'), true, "http://test.url/chain/19/pact/api/v1/");
+    setUpRetry(handler);
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        record(url, body);
+        if (requests.back().endpoint == "poll") {
+            return {200, "{}"};
+        }
+        // The node is overloaded for the first two attempts
+        return requests.size() < 4 ? MockHttpResponse{503, "overloaded"} : MockHttpResponse{200, TEST_SEND_RESPONSE};
+    });
+
+    TEST_ASSERT_EQUAL(BlockchainStatus::SUCCESS, handler.executeBlockchainCommand(PactCall::UPDATE_SENT, "secret"));
+    HTTPClient::setResponder(nullptr);
+
+    // send, poll, send, poll, send: the same bytes each time, polled under their request key
+    TEST_ASSERT_EQUAL(5, requests.size());
+    TEST_ASSERT_EQUAL_STRING("poll", requests[1].endpoint.c_str());
+    TEST_ASSERT_EQUAL_STRING("poll", requests[3].endpoint.c_str());
+    TEST_ASSERT_EQUAL_STRING(requests[0].body.c_str(), requests[2].body.c_str());
+    TEST_ASSERT_EQUAL_STRING(requests[0].body.c_str(), requests[4].body.c_str());
+    std::string key = requestKey(requests[0].body);
+    TEST_ASSERT_TRUE(requests[1].body.find(key) != std::string::npos);
+
+    // Bounded exponential backoff
+    TEST_ASSERT_EQUAL(2, sleeps.size());
+    TEST_ASSERT_EQUAL(COMMAND_RETRY_MIN_MS, sleeps[0]);
+    TEST_ASSERT_EQUAL(COMMAND_RETRY_MIN_MS * 2, sleeps[1]);
+}
+
+void test_retry_stops_when_poll_finds_command(void) {
+    BlockchainHandler handler(std::string(64, 'a'), std::string(64, 'b'), true, "http://test.url/chain/19/pact/api/v1/");
+    setUpRetry(handler);
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        record(url, body);
+        if (requests.back().endpoint == "poll") {
+            // The first attempt landed although its response was lost
+            std::string key = requestKey(requests[0].body);
+            return {200, "{\"" + key + "\":{\"reqKey\":\"" + key + "\",\"result\":{\"status\":\"success\",\"data\":true}}}"};
+        }
+        return {-1, ""};
+    });
+
+    TEST_ASSERT_EQUAL(BlockchainStatus::SUCCESS, handler.executeBlockchainCommand(PactCall::UPDATE_SENT, "secret"));
+    HTTPClient::setResponder(nullptr);
+    TEST_ASSERT_EQUAL(2, requests.size());
+    TEST_ASSERT_EQUAL_STRING("poll", requests[1].endpoint.c_str());
+}
+
+void test_retry_limits(void) {
+    BlockchainHandler handler(std::string(64, 'a'), std::string(64, 'b'), true, "http://test.url/chain/19/pact/api/v1/");
+    setUpRetry(handler);
+
+    // A 4xx is final
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        record(url, body);
+        return {400, "Validation failed"};
+    });
+    TEST_ASSERT_EQUAL(BlockchainStatus::HTTP_ERROR, handler.executeBlockchainCommand(PactCall::UPDATE_SENT, "secret"));
+    TEST_ASSERT_EQUAL(1, requests.size());
+
+    // A /local is repeated as it is, without polling, until the attempts run out
+    requests.clear();
+    RetryPolicy policy;
+    policy.attempts = 4;
+    policy.minDelayMs = 3000;
+    handler.setRetryPolicy(policy);
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        record(url, body);
+        return {500, ""};
+    });
+    TEST_ASSERT_EQUAL(BlockchainStatus::HTTP_ERROR, handler.executeBlockchainCommand(PactCall::GET_MY_NODE));
+    TEST_ASSERT_EQUAL(4, requests.size());
+    for (const RecordedRequest &request : requests) {
+        TEST_ASSERT_EQUAL_STRING("local", request.endpoint.c_str());
+        TEST_ASSERT_EQUAL_STRING(requests[0].body.c_str(), request.body.c_str());
+    }
+    TEST_ASSERT_EQUAL(3, sleeps.size());
+    TEST_ASSERT_EQUAL(3000, sleeps[0]);
+    TEST_ASSERT_EQUAL(6000, sleeps[1]);
+    TEST_ASSERT_EQUAL(COMMAND_RETRY_MAX_MS, sleeps[2]);
+
+    // A resubmission the node already holds was accepted on an earlier attempt
+    requests.clear();
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        record(url, body);
+        if (requests.back().endpoint == "poll") {
+            return {200, "{}"};
+        }
+        return requests.size() == 1 ? MockHttpResponse{502, ""}
+                                    : MockHttpResponse{400, "Validation failed: Transaction already exists on chain"};
+    });
+    TEST_ASSERT_EQUAL(BlockchainStatus::SUCCESS, handler.executeBlockchainCommand(PactCall::UPDATE_SENT, "secret"));
+    TEST_ASSERT_EQUAL(3, requests.size());
+    HTTPClient::setResponder(nullptr);
+}
+
+void test_retry_honors_retry_after(void) {
+    BlockchainHandler handler(std::string(64, 'a'), std::string(64, 'b'), true, "http://test.url/chain/19/pact/api/v1/");
+    setUpRetry(handler);
+
+    // Within the policy, the retry waits as long as the node asked
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        record(url, body);
+        return requests.size() == 1 ? MockHttpResponse{429, "", {{"Retry-After", "5"}}} : MockHttpResponse{200, TEST_SEND_RESPONSE};
+    });
+    TEST_ASSERT_EQUAL(BlockchainStatus::SUCCESS, handler.executeBlockchainCommand(PactCall::UPDATE_SENT, "secret"));
+    TEST_ASSERT_EQUAL(1, sleeps.size());
+    TEST_ASSERT_EQUAL(5000, sleeps[0]);
+
+    // An hour is beyond it: the failure is returned at once rather than blocking the sync
+    requests.clear();
+    sleeps.clear();
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        record(url, body);
+        return {503, "", {{"Retry-After", "3600"}}};
+    });
+    TEST_ASSERT_EQUAL(BlockchainStatus::HTTP_ERROR, handler.executeBlockchainCommand(PactCall::UPDATE_SENT, "secret"));
+    TEST_ASSERT_EQUAL(1, requests.size());
+    TEST_ASSERT_EQUAL(0, sleeps.size());
+    HTTPClient::setResponder(nullptr);
+}
+
+// Fails the first failures /send attempts with a large overload page, then accepts
+static int failures;
+static MockHttpResponse overloadedThenAccepted(const String &url, const String &body)
+{
+    record(url, body);
+    if (requests.back().endpoint == "poll") {
+        return {200, "{}"};
+    }
+    if (failures-- > 0) {
+        return {503, std::string(4096, 'x')};
+    }
+    return {200, TEST_SEND_RESPONSE};
+}
+
+void test_retry_releases_arena_between_attempts(void) {
+    static uint8_t buffer[BLOCKCHAIN_ARENA_MIN_SIZE];
+    HTTPClient::setResponder(overloadedThenAccepted);
+
+    // 503, poll, 200
+    Arena once(buffer, sizeof(buffer));
+    BlockchainHandler first(std::string(64, 'a'), std::string(64, 'b'), true, "http://test.url/chain/19/pact/api/v1/", &once);
+    setUpRetry(first);
+    failures = 1;
+    TEST_ASSERT_EQUAL(BlockchainStatus::SUCCESS, first.executeBlockchainCommand(PactCall::UPDATE_SENT, "secret"));
+    TEST_ASSERT_EQUAL(3, requests.size());
+
+    // 503, poll, 503, poll, 200 peaks no higher: each failed attempt is released before the next
+    Arena twice(buffer, sizeof(buffer));
+    BlockchainHandler second(std::string(64, 'a'), std::string(64, 'b'), true, "http://test.url/chain/19/pact/api/v1/", &twice);
+    setUpRetry(second);
+    failures = 2;
+    TEST_ASSERT_EQUAL(BlockchainStatus::SUCCESS, second.executeBlockchainCommand(PactCall::UPDATE_SENT, "secret"));
+    TEST_ASSERT_EQUAL(5, requests.size());
+    TEST_ASSERT_FALSE(twice.exhausted());
+    TEST_ASSERT_TRUE(twice.highWater() <= once.highWater() + 64);
+    HTTPClient::setResponder(nullptr);
+}
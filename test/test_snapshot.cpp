@@ -0,0 +1,147 @@
+#include <unity.h>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include "BlockchainHandler.h"
+#include "HandlerSnapshot.h"
+#include "test_fixtures.h"
+#include "utils.h"
+
+
+// Syncs a handler once so it learns the director key, the clock offset and the chain height
+static void learnState(BlockchainHandler &handler)
+{
+    WiFi.setStatus(WL_CONNECTED);
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        char date[40];
+        std::time_t ahead = getCurrentUnixTime() + 600;
+        strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", std::gmtime(&ahead));
+        return {200, TEST_GET_MY_NODE_READY_RESPONSE, {{"Date", date}}};
+    });
+    TEST_ASSERT_EQUAL(BlockchainStatus::READY, handler.executeBlockchainCommand(PactCall::GET_MY_NODE));
+    HTTPClient::setResponder(nullptr);
+    handler.onBlockHeader(handler.chainId(), 4321000);
+}
+
+void test_snapshot_round_trip(void) {
+    std::string pub_key(64, 'a');
+    std::string priv_key(64, 'b');
+    std::string url = "http://test.url/chain/19/pact/api/v1/";
+    BlockchainHandler before(pub_key, priv_key, true, url);
+    learnState(before);
+
+    uint8_t snapshot[HANDLER_SNAPSHOT_MAX_SIZE];
+    size_t length = before.saveSnapshot(snapshot, sizeof(snapshot));
+    TEST_ASSERT_TRUE(length > 0);
+    TEST_ASSERT_EQUAL(0, before.saveSnapshot(snapshot, length - 1));
+
+    // The snapshot survives a trip through a file, as it would through flash
+    const char *path = "handler_snapshot.bin";
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char *>(snapshot), length);
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> stored((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::remove(path);
+
+    // After waking, a fresh handler picks up where the old one left off
+    BlockchainHandler after(pub_key, priv_key, true, url);
+    TEST_ASSERT_TRUE(after.restoreSnapshot(stored.data(), stored.size()));
+    TEST_ASSERT_EQUAL(before.clockOffsetSeconds(), after.clockOffsetSeconds());
+    TEST_ASSERT_EQUAL(4321000, after.chainHeight());
+
+    // The restored director key lets the node relay over the mesh before any WiFi sync
+    static size_t packets;
+    packets = 0;
+    BlockchainHandler cold(pub_key, priv_key, true, url);
+    cold.setMeshRelay([](const uint8_t *fragment, size_t size) { packets++; });
+    after.setMeshRelay([](const uint8_t *fragment, size_t size) { packets++; });
+    WiFi.setStatus(WL_DISCONNECTED);
+    cold.performNodeSync("node-1");
+    TEST_ASSERT_EQUAL(0, packets);
+    after.performNodeSync("node-1");
+    TEST_ASSERT_TRUE(packets > 0);
+    WiFi.setStatus(WL_CONNECTED);
+}
+
+void test_snapshot_skips_local_until_due(void) {
+    std::string pub_key(64, 'a');
+    std::string priv_key(64, 'b');
+    std::string url = "http://test.url/chain/19/pact/api/v1/";
+    static int localQueries;
+    localQueries = 0;
+    WiFi.setStatus(WL_CONNECTED);
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        if (url.indexOf("/local") >= 0) {
+            localQueries++;
+            return {200, TEST_GET_MY_NODE_READY_RESPONSE};
+        }
+        return {200, TEST_SEND_RESPONSE};
+    });
+
+    // The beacon is accepted just before the node goes to sleep
+    const uint32_t intervalS = 3600;
+    BlockchainHandler before(pub_key, priv_key, true, url);
+    before.setBeaconInterval(intervalS);
+    before.performNodeSync("node-1");
+    TEST_ASSERT_EQUAL(1, localQueries);
+    uint8_t snapshot[HANDLER_SNAPSHOT_MAX_SIZE];
+    size_t length = before.saveSnapshot(snapshot, sizeof(snapshot));
+    HandlerSnapshot decoded;
+    TEST_ASSERT_TRUE(decodeHandlerSnapshot(snapshot, length, decoded));
+    TEST_ASSERT_TRUE(decoded.dueAt + 1 >= decoded.savedAt + intervalS);
+
+    // Woken without a header feed, the node still knows it is not due and skips the signed /local
+    BlockchainHandler after(pub_key, priv_key, true, url);
+    after.setBeaconInterval(intervalS);
+    TEST_ASSERT_TRUE(after.restoreSnapshot(snapshot, length));
+    after.performNodeSync("node-1");
+    TEST_ASSERT_EQUAL(1, localQueries);
+
+    // Without a beacon interval the restored due time is not relied on
+    BlockchainHandler unset(pub_key, priv_key, true, url);
+    TEST_ASSERT_TRUE(unset.restoreSnapshot(snapshot, length));
+    unset.performNodeSync("node-1");
+    TEST_ASSERT_EQUAL(2, localQueries);
+
+    // Woken after the due time, it asks again
+    decoded.dueAt = decoded.savedAt;
+    length = encodeHandlerSnapshot(decoded, snapshot, sizeof(snapshot));
+    BlockchainHandler due(pub_key, priv_key, true, url);
+    due.setBeaconInterval(intervalS);
+    TEST_ASSERT_TRUE(due.restoreSnapshot(snapshot, length));
+    due.performNodeSync("node-1");
+    TEST_ASSERT_EQUAL(3, localQueries);
+    HTTPClient::setResponder(nullptr);
+}
+
+void test_snapshot_rejected(void) {
+    std::string pub_key(64, 'a');
+    std::string priv_key(64, 'b');
+    BlockchainHandler handler(pub_key, priv_key, true, "http://test.url/chain/19/pact/api/v1/");
+    learnState(handler);
+    uint8_t snapshot[HANDLER_SNAPSHOT_MAX_SIZE];
+    size_t length = handler.saveSnapshot(snapshot, sizeof(snapshot));
+
+    // Another identity or chain
+    BlockchainHandler otherKey(std::string(64, 'c'), priv_key, true, "http://test.url/chain/19/pact/api/v1/");
+    TEST_ASSERT_FALSE(otherKey.restoreSnapshot(snapshot, length));
+    BlockchainHandler otherChain(pub_key, priv_key, true, "http://test.url/chain/3/pact/api/v1/");
+    TEST_ASSERT_FALSE(otherChain.restoreSnapshot(snapshot, length));
+
+    // Corrupted, truncated or never written (RTC memory after power loss)
+    std::vector<uint8_t> corrupted(snapshot, snapshot + length);
+    corrupted[length / 2] ^= 0x10;
+    TEST_ASSERT_FALSE(handler.restoreSnapshot(corrupted.data(), corrupted.size()));
+    TEST_ASSERT_FALSE(handler.restoreSnapshot(snapshot, length - 1));
+    std::vector<uint8_t> blank(HANDLER_SNAPSHOT_MAX_SIZE, 0);
+    TEST_ASSERT_FALSE(handler.restoreSnapshot(blank.data(), blank.size()));
+
+    // Too old
+    HandlerSnapshot decoded;
+    TEST_ASSERT_TRUE(decodeHandlerSnapshot(snapshot, length, decoded));
+    TEST_ASSERT_EQUAL_STRING(TEST_PUBLIC_KEY_BASE64.c_str(), decoded.directorKey.c_str());
+    decoded.savedAt -= HANDLER_SNAPSHOT_MAX_AGE_S + 60;
+    length = encodeHandlerSnapshot(decoded, snapshot, sizeof(snapshot));
+    TEST_ASSERT_FALSE(handler.restoreSnapshot(snapshot, length));
+}
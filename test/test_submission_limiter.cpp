@@ -0,0 +1,191 @@
+#include <unity.h>
+#include <vector>
+#include "BlockchainHandler.h"
+#include "SubmissionLimiter.h"
+#include "test_fixtures.h"
+
+void test_submission_limiter_aimd(void) {
+    SubmissionLimiter limiter(0, 1, 4, 16);
+    unsigned long now = 1000;
+
+    // Four slots, then the fifth request waits for a release
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(0, limiter.tryAcquire(now));
+    }
+    TEST_ASSERT_TRUE(limiter.tryAcquire(now) > 0);
+    TEST_ASSERT_EQUAL(4, limiter.inFlight());
+
+    // Timely successes add about one slot per round trip
+    for (int i = 0; i < 5; i++) {
+        limiter.release(now += 20, 200, 20);
+        TEST_ASSERT_EQUAL(0, limiter.tryAcquire(now));
+    }
+    TEST_ASSERT_EQUAL(5, limiter.limit());
+
+    // A burst of 429s halves the limit once and pauses admissions for Retry-After
+    for (int i = 0; i < 4; i++) {
+        limiter.release(now, 429, 5, 2000);
+    }
+    TEST_ASSERT_EQUAL(2, limiter.limit());
+    TEST_ASSERT_EQUAL(4, limiter.overloads());
+    TEST_ASSERT_EQUAL(2000, limiter.tryAcquire(now));
+    TEST_ASSERT_EQUAL(0, limiter.tryAcquire(now + 2000));
+
+    // Latency far above the baseline is overload too, even when the answer is a 200
+    limiter.release(now += 2100, 200, 20);
+    TEST_ASSERT_EQUAL(0, limiter.tryAcquire(now));
+    limiter.release(now += 200, 200, 200);
+    TEST_ASSERT_EQUAL(1, limiter.limit());
+    TEST_ASSERT_EQUAL(0, limiter.inFlight());
+}
+
+void test_submission_limiter_baseline(void) {
+    SubmissionLimiter limiter(0, 1, 4, 16);
+    unsigned long now = 1000;
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_EQUAL(0, limiter.tryAcquire(now));
+        limiter.release(now += 100, 200, 40);
+    }
+
+    // Fast error replies and a few sub-millisecond successes leave the baseline alone
+    for (int i = 0; i < 20; i++) {
+        TEST_ASSERT_EQUAL(0, limiter.tryAcquire(now));
+        limiter.release(now += 100, 400, 0);
+    }
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL(0, limiter.tryAcquire(now));
+        limiter.release(now += 100, 200, 0);
+    }
+    TEST_ASSERT_EQUAL(0, limiter.tryAcquire(now));
+    limiter.release(now += 100, 200, 110);
+    TEST_ASSERT_EQUAL(0, limiter.overloads());
+    TEST_ASSERT_EQUAL(0, limiter.tryAcquire(now));
+    limiter.release(now += 100, 200, 130);
+    TEST_ASSERT_EQUAL(1, limiter.overloads());
+
+    // A gateway in front of the node timing out or failing to reach it is overload
+    TEST_ASSERT_EQUAL(0, limiter.tryAcquire(now));
+    limiter.release(now += 100, 502, 5);
+    TEST_ASSERT_EQUAL(0, limiter.tryAcquire(now));
+    limiter.release(now += 100, 504, 5);
+    TEST_ASSERT_EQUAL(3, limiter.overloads());
+    TEST_ASSERT_EQUAL(1, limiter.limit());
+
+    // A node that has become slower for good sets a new baseline once it fills the window
+    for (int i = 0; i < SUBMISSION_LATENCY_WINDOW; i++) {
+        TEST_ASSERT_EQUAL(0, limiter.tryAcquire(now));
+        limiter.release(now += 1000, 200, 300);
+    }
+    TEST_ASSERT_EQUAL(0, limiter.tryAcquire(now));
+    uint32_t overloads = limiter.overloads();
+    limiter.release(now += 1000, 200, 300);
+    TEST_ASSERT_EQUAL(overloads, limiter.overloads());
+    TEST_ASSERT_TRUE(limiter.limit() > 1);
+}
+
+void test_submission_limiter_token_bucket(void) {
+    // 10 per second with a burst of 2: two at once, then one every 100 ms
+    SubmissionLimiter limiter(10, 2, 64, 64);
+    unsigned long now = 5000;
+    TEST_ASSERT_EQUAL(0, limiter.tryAcquire(now));
+    TEST_ASSERT_EQUAL(0, limiter.tryAcquire(now));
+    uint32_t wait = limiter.tryAcquire(now);
+    TEST_ASSERT_TRUE(wait > 90 && wait <= 101);
+    TEST_ASSERT_TRUE(limiter.tryAcquire(now + 50) > 0);
+    TEST_ASSERT_EQUAL(0, limiter.tryAcquire(now + 100));
+
+    TEST_ASSERT_EQUAL(120000, SubmissionLimiter::parseRetryAfterMs("120", 0));
+    TEST_ASSERT_EQUAL(0, SubmissionLimiter::parseRetryAfterMs("", 0));
+    TEST_ASSERT_EQUAL(30000, SubmissionLimiter::parseRetryAfterMs("Sun, 06 Nov 1994 08:50:07 GMT", 784111777));
+}
+
+void test_submission_limiter_converges(void) {
+    // A node serving 8 requests at a time in 50 ms and answering 429 beyond that
+    const uint32_t capacity = 8;
+    SubmissionLimiter limiter(0, 1, 1, 64);
+    std::vector<unsigned long> completions;
+    uint32_t served = 0, rejected = 0;
+    for (unsigned long now = 0; now < 20000; now++) {
+        for (size_t i = 0; i < completions.size();) {
+            if (completions[i] == now) {
+                limiter.release(now, 200, 50);
+                completions.erase(completions.begin() + i);
+            } else {
+                i++;
+            }
+        }
+        while (limiter.tryAcquire(now) == 0) {
+            if (completions.size() >= capacity) {
+                limiter.release(now, 429, 1, 0);
+                rejected++;
+                break;
+            }
+            completions.push_back(now + 50);
+            served++;
+        }
+    }
+    Serial.printf("Converged limit %u, %u served, %u rejected\n", (unsigned)limiter.limit(), (unsigned)served,
+                  (unsigned)rejected);
+    // Near the node's capacity (8 per 50 ms is 3200 in 20 s) with few rejections
+    TEST_ASSERT_TRUE(served > 2400);
+    TEST_ASSERT_TRUE(rejected < served / 20);
+}
+
+void test_submission_limiter_handler(void) {
+    std::string pub_key(64, 'a');
+    BlockchainHandler handler(pub_key, std::string(64, 'b'), true, "http://test.url/chain/19/pact/api/v1/");
+    SubmissionLimiter limiter(0, 1, 4, 16);
+    handler.setSubmissionLimiter(&limiter);
+    RetryPolicy policy;
+    policy.minDelayMs = 10;
+    handler.setRetryPolicy(policy);
+    static std::vector<uint32_t> sleeps;
+    sleeps.clear();
+    handler.setRetrySleep([](uint32_t ms) { sleeps.push_back(ms); });
+    static int sends;
+    sends = 0;
+    WiFi.setStatus(WL_CONNECTED);
+
+    // A 429 is retried after the node's Retry-After, without polling: the node never took the command.
+    // The stubbed sleep returns at once, so the limiter's pause is what holds the retry back.
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        TEST_ASSERT_TRUE(url.indexOf("/poll") < 0);
+        if (sends++ == 0) {
+            return {429, "", {{"Retry-After", "1"}}};
+        }
+        return {200, TEST_SEND_RESPONSE};
+    });
+    unsigned long start = millis();
+    TEST_ASSERT_EQUAL(BlockchainStatus::SUCCESS, handler.executeBlockchainCommand(PactCall::UPDATE_SENT, "secret"));
+    HTTPClient::setResponder(nullptr);
+    TEST_ASSERT_EQUAL(2, sends);
+    TEST_ASSERT_EQUAL(1, sleeps.size());
+    TEST_ASSERT_EQUAL(1000, sleeps[0]);
+    TEST_ASSERT_TRUE(millis() - start >= 1000);
+    TEST_ASSERT_EQUAL(1, limiter.overloads());
+    TEST_ASSERT_EQUAL(0, limiter.inFlight());
+}
+
+void test_submission_limiter_poll(void) {
+    BlockchainHandler handler(std::string(64, 'a'), std::string(64, 'b'), true, "http://test.url/chain/19/pact/api/v1/");
+    SubmissionLimiter limiter(0, 1, 4, 16);
+    handler.setSubmissionLimiter(&limiter);
+    handler.setRetrySleep([](uint32_t ms) {});
+    static int requests;
+    requests = 0;
+    WiFi.setStatus(WL_CONNECTED);
+
+    // The /send fails behind a proxy, and so does the /poll checking whether it landed anyway
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        requests++;
+        if (url.indexOf("/poll") >= 0) {
+            return {504, ""};
+        }
+        return requests == 1 ? MockHttpResponse{502, ""} : MockHttpResponse{200, TEST_SEND_RESPONSE};
+    });
+    TEST_ASSERT_EQUAL(BlockchainStatus::SUCCESS, handler.executeBlockchainCommand(PactCall::UPDATE_SENT, "secret"));
+    HTTPClient::setResponder(nullptr);
+    TEST_ASSERT_EQUAL(3, requests);
+    TEST_ASSERT_EQUAL(2, limiter.overloads());
+    TEST_ASSERT_EQUAL(0, limiter.inFlight());
+}
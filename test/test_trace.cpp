@@ -0,0 +1,111 @@
+#include <unity.h>
+#include <cstring>
+#include "BlockchainHandler.h"
+#include "Trace.h"
+#include "test_fixtures.h"
+#include "trace_replay.h"
+
+
+// Captures a get-my-node and an insert-my-node exchange
+static void captureTrace(TraceBuffer &buffer)
+{
+    WiFi.setStatus(WL_CONNECTED);
+    std::string valid_pub_key(64, 'a');
+    std::string valid_priv_key(64, 'b');
+    BlockchainHandler handler(valid_pub_key, valid_priv_key, true, "http://test.url/chain/19/pact/api/v1/");
+    TraceWriter writer(buffer);
+    handler.setTraceWriter(&writer);
+
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        return {200, url.indexOf("/local") >= 0 ? TEST_GET_MY_NODE_READY_RESPONSE : TEST_SEND_RESPONSE};
+    });
+    handler.executeBlockchainCommand(PactCall::GET_MY_NODE);
+    handler.executeBlockchainCommand(PactCall::INSERT_MY_NODE, "node-1");
+    HTTPClient::setResponder(nullptr);
+    TEST_ASSERT_EQUAL(2, writer.records());
+    TEST_ASSERT_EQUAL(buffer.data.size(), writer.bytesWritten());
+}
+
+void test_trace_capture(void) {
+    TraceBuffer buffer;
+    captureTrace(buffer);
+
+    TraceReader reader(buffer.data.data(), buffer.data.size());
+    TEST_ASSERT_TRUE(reader.valid());
+    TraceRecord record;
+    TEST_ASSERT_TRUE(reader.next(record));
+    TEST_ASSERT_TRUE(record.call == PactCall::GET_MY_NODE);
+    TEST_ASSERT_TRUE(record.local);
+    TEST_ASSERT_EQUAL(200, record.httpCode);
+    TEST_ASSERT_EQUAL(static_cast<uint8_t>(BlockchainStatus::READY), record.status);
+    TEST_ASSERT_EQUAL(TEST_GET_MY_NODE_READY_RESPONSE.size(), record.responseLength);
+    TEST_ASSERT_EQUAL_MEMORY(TEST_GET_MY_NODE_READY_RESPONSE.data(), record.response, record.responseLength);
+    TEST_ASSERT_EQUAL_MEMORY("(" PACT_MODULE ".get-my-node", record.code, strlen("(" PACT_MODULE ".get-my-node"));
+
+    TEST_ASSERT_TRUE(reader.next(record));
+    TEST_ASSERT_TRUE(record.call == PactCall::INSERT_MY_NODE);
+    TEST_ASSERT_FALSE(record.local);
+    TEST_ASSERT_EQUAL(0, record.stageUs[TRACE_STAGE_PARSE]);
+    TEST_ASSERT_EQUAL_MEMORY("{\"cmds\":[", record.request, 9);
+    TEST_ASSERT_FALSE(reader.next(record));
+
+    // A truncated trace stops at the last complete record
+    TraceReader truncated(buffer.data.data(), buffer.data.size() - 1);
+    TEST_ASSERT_TRUE(truncated.next(record));
+    TEST_ASSERT_FALSE(truncated.next(record));
+}
+
+void test_trace_replay(void) {
+    TraceBuffer buffer;
+    captureTrace(buffer);
+
+    TraceReplayReport report = replayTrace(buffer.data.data(), buffer.data.size(), false);
+    TEST_ASSERT_EQUAL(2, report.records);
+    TEST_ASSERT_EQUAL(0, report.statusMismatches);
+    TEST_ASSERT_TRUE(report.replayedUs[TRACE_STAGE_SIGN] > 0);
+}
+
+void test_trace_replay_calls_and_retries(void) {
+    WiFi.setStatus(WL_CONNECTED);
+    BlockchainHandler handler(std::string(64, 'a'), std::string(64, 'b'), true, "http://test.url/chain/19/pact/api/v1/");
+    TraceBuffer buffer;
+    TraceWriter writer(buffer);
+    handler.setTraceWriter(&writer);
+    handler.setRetrySleep([](uint32_t ms) {});
+
+    // A multi-node query, then a get-my-node answered 503 once
+    static int calls;
+    calls = 0;
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        if (calls++ == 0) {
+            return {200, "{\"result\":{\"status\":\"success\",\"data\":[{\"send\":true},false]}}"};
+        }
+        return calls == 2 ? MockHttpResponse{503, ""} : MockHttpResponse{200, TEST_GET_MY_NODE_READY_RESPONSE};
+    });
+    std::vector<NodeQueryResult> results;
+    TEST_ASSERT_EQUAL(BlockchainStatus::SUCCESS, handler.queryNodeStatuses({"node-\"1\"", "node-2"}, results));
+    TEST_ASSERT_EQUAL(BlockchainStatus::READY, handler.executeBlockchainCommand(PactCall::GET_MY_NODE));
+    HTTPClient::setResponder(nullptr);
+    TEST_ASSERT_EQUAL(3, writer.records());
+
+    // Each attempt carries its own timings; build and sign happened once, before the first
+    TraceReader reader(buffer.data.data(), buffer.data.size());
+    TraceRecord record;
+    TEST_ASSERT_TRUE(reader.next(record));
+    TEST_ASSERT_TRUE(record.call == PactCall::GET_NODES);
+    TEST_ASSERT_TRUE(reader.next(record));
+    TEST_ASSERT_EQUAL(1, record.attempt);
+    TEST_ASSERT_EQUAL(503, record.httpCode);
+    TEST_ASSERT_TRUE(record.stageUs[TRACE_STAGE_SIGN] > 0);
+    TEST_ASSERT_EQUAL(0, record.stageUs[TRACE_STAGE_PARSE]);
+    TEST_ASSERT_TRUE(reader.next(record));
+    TEST_ASSERT_EQUAL(2, record.attempt);
+    TEST_ASSERT_EQUAL(0, record.stageUs[TRACE_STAGE_BUILD]);
+    TEST_ASSERT_EQUAL(0, record.stageUs[TRACE_STAGE_SIGN]);
+    TEST_ASSERT_EQUAL(0, record.stageUs[TRACE_STAGE_SERIALIZE]);
+
+    // The query is replayed as a query, so its list result decodes as it did on the device
+    TraceReplayReport report = replayTrace(buffer.data.data(), buffer.data.size(), false);
+    TEST_ASSERT_EQUAL(3, report.records);
+    TEST_ASSERT_EQUAL(0, report.statusMismatches);
+}
@@ -0,0 +1,135 @@
+#include "trace_replay.h"
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include "BlockchainHandler.h"
+
+static const char *const STAGE_NAMES[TRACE_STAGE_COUNT] = {"build", "sign", "serialize", "http", "parse"};
+
+// Recovers the node ids of a multi-node query from the quoted list buildNodeQueryCode wrote
+static std::vector<std::string> nodeIdsFromQueryCode(const char *code, size_t length)
+{
+    std::vector<std::string> nodeIds;
+    const char *end = code + length;
+    const char *p = static_cast<const char *>(memchr(code, '[', length));
+    while (p && p < end) {
+        p = static_cast<const char *>(memchr(p, '"', end - p));
+        if (!p) {
+            break;
+        }
+        std::string id;
+        for (p++; p < end && *p != '"'; p++) {
+            if (*p == '\\' && p + 1 < end) {
+                p++;
+            }
+            id += *p;
+        }
+        nodeIds.push_back(id);
+        p++;
+    }
+    return nodeIds;
+}
+
+// Makes the recorded call again the way the device made it
+static BlockchainStatus replayRecord(BlockchainHandler &handler, const TraceRecord &record)
+{
+    if (record.call == PactCall::GET_NODES) {
+        // Capped at the recorded code length, the rebuilt query holds the same nodes in one /local
+        std::vector<NodeQueryResult> results;
+        return handler.queryNodeStatuses(nodeIdsFromQueryCode(record.code, record.codeLength), results,
+                                         record.codeLength);
+    }
+    return handler.executeBlockchainCommand(record.call, record.local ? "local" : "send",
+                                            String(std::string(record.code, record.codeLength)));
+}
+
+TraceReplayReport replayTrace(const uint8_t *trace, size_t length, bool recordedTiming, Arena *arena)
+{
+    TraceReplayReport report;
+    TraceReader reader(trace, length);
+    if (!reader.valid()) {
+        return report;
+    }
+
+    // Keys only affect signature bytes, not the work done, so fixed test keys stand in for the node's
+    WiFi.setStatus(WL_CONNECTED);
+    BlockchainHandler handler(std::string(64, 'a'), std::string(64, 'b'), true, "http://replay/chain/19/pact/api/v1/", arena);
+    TraceBuffer replayed;
+    TraceWriter writer(replayed);
+    handler.setTraceWriter(&writer);
+    // Every attempt of a retried command was recorded on its own, so each record is sent once
+    RetryPolicy singleAttempt;
+    singleAttempt.attempts = 1;
+    handler.setRetryPolicy(singleAttempt);
+
+    static TraceRecord current;
+    static bool waitForHttp;
+    waitForHttp = recordedTiming;
+    HTTPClient::setResponder([](const String &url, const String &body) -> MockHttpResponse {
+        if (waitForHttp) {
+            std::this_thread::sleep_for(std::chrono::microseconds(current.stageUs[TRACE_STAGE_HTTP]));
+        }
+        MockHttpResponse response{current.httpCode,
+                                  String(std::string(reinterpret_cast<const char *>(current.response), current.responseLength)),
+                                  {}};
+        if (current.compressed) {
+            response.headers.push_back({"Content-Encoding", "gzip"});
+        }
+        return response;
+    });
+
+    std::vector<uint8_t> recordedStatus;
+    std::vector<uint8_t> recordedAttempt;
+    auto start = std::chrono::steady_clock::now();
+    uint32_t firstTimestamp = 0;
+    while (reader.next(current)) {
+        if (current.codeLength == 0) {
+            report.skipped++;
+            continue;
+        }
+        if (report.records == 0) {
+            firstTimestamp = current.timestampMs;
+        }
+        if (recordedTiming) {
+            std::this_thread::sleep_until(start + std::chrono::milliseconds(current.timestampMs - firstTimestamp));
+        }
+        for (int stage = 0; stage < TRACE_STAGE_COUNT; stage++) {
+            report.recordedUs[stage] += current.stageUs[stage];
+        }
+        recordedStatus.push_back(current.status);
+        recordedAttempt.push_back(current.attempt);
+        replayRecord(handler, current);
+        report.records++;
+    }
+    HTTPClient::setResponder(nullptr);
+
+    TraceReader replayedReader(replayed.data.data(), replayed.data.size());
+    TraceRecord record;
+    for (size_t i = 0; replayedReader.next(record) && i < recordedStatus.size(); i++) {
+        // A retry reuses the first attempt's signed command, so only its exchange is compared
+        int firstStage = recordedAttempt[i] > 1 ? TRACE_STAGE_HTTP : TRACE_STAGE_BUILD;
+        for (int stage = firstStage; stage < TRACE_STAGE_COUNT; stage++) {
+            report.replayedUs[stage] += record.stageUs[stage];
+        }
+        if (record.status != recordedStatus[i]) {
+            report.statusMismatches++;
+        }
+    }
+    return report;
+}
+
+void printTraceReplayReport(const TraceReplayReport &report)
+{
+    Serial.printf("Trace replay: %u records (%u skipped, %u status mismatches)\n", report.records, report.skipped,
+                  report.statusMismatches);
+    if (report.records == 0) {
+        return;
+    }
+    Serial.printf("%-10s %14s %14s %9s\n", "stage", "recorded us", "replayed us", "delta");
+    for (int stage = 0; stage < TRACE_STAGE_COUNT; stage++) {
+        double recorded = static_cast<double>(report.recordedUs[stage]) / report.records;
+        double replayed = static_cast<double>(report.replayedUs[stage]) / report.records;
+        double delta = recorded > 0 ? (replayed - recorded) * 100.0 / recorded : 0.0;
+        Serial.printf("%-10s %14.1f %14.1f %8.1f%%\n", STAGE_NAMES[stage], recorded, replayed, delta);
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Arena.h"
+#include "Trace.h"
+
+/**
+ * In-memory Print sink for capturing traces in native runs.
+ */
+class TraceBuffer : public Print
+{
+  public:
+    size_t write(uint8_t c) override
+    {
+        data.push_back(c);
+        return 1;
+    }
+
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        data.insert(data.end(), buffer, buffer + size);
+        return size;
+    }
+
+    std::vector<uint8_t> data;
+};
+
+/**
+ * @struct TraceReplayReport
+ * @brief Per-stage totals for a trace as recorded and as replayed by the current build.
+ */
+struct TraceReplayReport {
+    uint32_t records = 0;                     ///< Records replayed.
+    uint32_t skipped = 0;                     ///< Records without Pact code (e.g. relayed commands).
+    uint32_t statusMismatches = 0;            ///< Records whose replayed status differs from the recorded one.
+    uint64_t recordedUs[TRACE_STAGE_COUNT] = {};
+    uint64_t replayedUs[TRACE_STAGE_COUNT] = {};
+};
+
+/**
+ * Runs every record of a trace through the current build/sign/parse pipeline.
+ *
+ * Each record is made again as the call it recorded. A retry record is compared on its HTTP and
+ * parse stages only, since the device reused the first attempt's signed command.
+ *
+ * The mock HTTP layer answers each request with the recorded status and response body. With
+ * recordedTiming the replay waits out the recorded gaps between commands and the recorded HTTP
+ * time of each; otherwise it runs as fast as possible and the HTTP stage measures the mock only.
+ *
+ * @param arena Optional arena for the replaying handler, to compare allocation modes.
+ */
+TraceReplayReport replayTrace(const uint8_t *trace, size_t length, bool recordedTiming, Arena *arena = nullptr);
+
+/**
+ * Prints recorded and replayed mean stage times with their relative delta.
+ */
+void printTraceReplayReport(const TraceReplayReport &report);
@@ -16,7 +16,75 @@ void test_binary_hash_generation(void);
 void test_kda_hash_generation(void);
 void test_hex_conversion(void);
 void test_payload_encryption(void);
+void test_ed25519_rfc8032_vectors(void);
+void test_signature_backends_match(void);
+void test_binhash_batch_matches_single(void);
 void test_wifi_connection(void);
+void test_chain_router_mapping(void);
+void test_chain_router_stats(void);
+void test_chain_router_rejects_malformed_url(void);
+void test_nonce_format(void);
+void test_nonce_unique_within_same_millisecond(void);
+void test_arena_allocation(void);
+void test_arena_backed_command(void);
+void test_pact_code_building(void);
+void test_pact_typed_decoding(void);
+void test_node_query_building(void);
+void test_node_query_decoding(void);
+void test_clock_skew_estimation(void);
+void test_clock_skew_applied_to_commands(void);
+void test_inflate_gzip_stream(void);
+void test_inflate_compressed_response(void);
+void test_inflate_far_reference(void);
+void test_mesh_relay_codec(void);
+void test_mesh_relay_gateway_submission(void);
+void test_mesh_relay_gateway_batch(void);
+void test_mesh_relay_gateway_arena_chunks(void);
+void test_mesh_relay_rejects_local_calls(void);
+void test_mesh_relay_seeded_node_resends(void);
+void test_block_header_event_parsing(void);
+void test_block_header_subscription_reconnect(void);
+void test_block_header_driven_sync(void);
+void test_block_header_sync_waits_for_due_time(void);
+void test_trace_capture(void);
+void test_trace_replay(void);
+void test_trace_replay_calls_and_retries(void);
+void test_snapshot_round_trip(void);
+void test_snapshot_skips_local_until_due(void);
+void test_snapshot_rejected(void);
+void test_retry_resends_signed_bytes(void);
+void test_retry_stops_when_poll_finds_command(void);
+void test_retry_limits(void);
+void test_retry_honors_retry_after(void);
+void test_retry_releases_arena_between_attempts(void);
+void test_submission_limiter_aimd(void);
+void test_submission_limiter_baseline(void);
+void test_submission_limiter_token_bucket(void);
+void test_submission_limiter_converges(void);
+void test_submission_limiter_handler(void);
+void test_submission_limiter_poll(void);
+void test_merkle_tree_incremental(void);
+void test_beacon_batch_submission(void);
+void test_secret_decryption_round_trip(void);
+void test_secret_decryption_rejected(void);
+void test_secret_decryption_batch(void);
+void test_fleet_sim_herd_and_jitter(void);
+void test_fleet_sim_errors_and_registration(void);
+void test_fleet_sim_assumed_beacon_interval(void);
+void test_benchmark_nonce_generation(void);
+void test_benchmark_compressed_response(void);
+void test_benchmark_trace_replay(void);
+void test_benchmark_signatures(void);
+void test_benchmark_batch_hashing(void);
+void test_benchmark_snapshot_resume(void);
+void test_benchmark_merkle_batch(void);
+void test_benchmark_secret_decryption(void);
+void test_benchmark_fleet_sim(void);
+#ifdef ALLOC_ACCOUNTING
+void test_allocations_command_pipeline(void);
+void test_allocations_encrypt(void);
+void test_allocations_node_sync(void);
+#endif
 
 int main(void) {
     UNITY_BEGIN();
@@ -31,6 +99,108 @@ int main(void) {
     RUN_TEST(test_kda_hash_generation);
     RUN_TEST(test_hex_conversion);
     RUN_TEST(test_payload_encryption);
+    RUN_TEST(test_ed25519_rfc8032_vectors);
+    RUN_TEST(test_signature_backends_match);
+    RUN_TEST(test_binhash_batch_matches_single);
+
+    // Chain routing tests
+    RUN_TEST(test_chain_router_mapping);
+    RUN_TEST(test_chain_router_stats);
+    RUN_TEST(test_chain_router_rejects_malformed_url);
+
+    // Nonce tests
+    RUN_TEST(test_nonce_format);
+    RUN_TEST(test_nonce_unique_within_same_millisecond);
+
+    // Arena tests
+    RUN_TEST(test_arena_allocation);
+    RUN_TEST(test_arena_backed_command);
+
+    // Pact command tests
+    RUN_TEST(test_pact_code_building);
+    RUN_TEST(test_pact_typed_decoding);
+    RUN_TEST(test_node_query_building);
+    RUN_TEST(test_node_query_decoding);
+
+    // Clock skew tests
+    RUN_TEST(test_clock_skew_estimation);
+    RUN_TEST(test_clock_skew_applied_to_commands);
+
+    // Response compression tests
+    RUN_TEST(test_inflate_gzip_stream);
+    RUN_TEST(test_inflate_compressed_response);
+    RUN_TEST(test_inflate_far_reference);
+
+    // Mesh relay tests
+    RUN_TEST(test_mesh_relay_codec);
+    RUN_TEST(test_mesh_relay_gateway_submission);
+    RUN_TEST(test_mesh_relay_gateway_batch);
+    RUN_TEST(test_mesh_relay_gateway_arena_chunks);
+    RUN_TEST(test_mesh_relay_rejects_local_calls);
+    RUN_TEST(test_mesh_relay_seeded_node_resends);
+
+    // Block header stream tests
+    RUN_TEST(test_block_header_event_parsing);
+    RUN_TEST(test_block_header_subscription_reconnect);
+    RUN_TEST(test_block_header_driven_sync);
+    RUN_TEST(test_block_header_sync_waits_for_due_time);
+
+    // Trace tests
+    RUN_TEST(test_trace_capture);
+    RUN_TEST(test_trace_replay);
+    RUN_TEST(test_trace_replay_calls_and_retries);
+
+    // Snapshot tests
+    RUN_TEST(test_snapshot_round_trip);
+    RUN_TEST(test_snapshot_skips_local_until_due);
+    RUN_TEST(test_snapshot_rejected);
+
+    // Retry tests
+    RUN_TEST(test_retry_resends_signed_bytes);
+    RUN_TEST(test_retry_stops_when_poll_finds_command);
+    RUN_TEST(test_retry_limits);
+    RUN_TEST(test_retry_honors_retry_after);
+    RUN_TEST(test_retry_releases_arena_between_attempts);
+
+    // Submission limiter tests
+    RUN_TEST(test_submission_limiter_aimd);
+    RUN_TEST(test_submission_limiter_baseline);
+    RUN_TEST(test_submission_limiter_token_bucket);
+    RUN_TEST(test_submission_limiter_converges);
+    RUN_TEST(test_submission_limiter_handler);
+    RUN_TEST(test_submission_limiter_poll);
+
+    // Merkle beacon batch tests
+    RUN_TEST(test_merkle_tree_incremental);
+    RUN_TEST(test_beacon_batch_submission);
+
+    // Secret decryption tests
+    RUN_TEST(test_secret_decryption_round_trip);
+    RUN_TEST(test_secret_decryption_rejected);
+    RUN_TEST(test_secret_decryption_batch);
+
+    // Fleet simulation tests
+    RUN_TEST(test_fleet_sim_herd_and_jitter);
+    RUN_TEST(test_fleet_sim_errors_and_registration);
+    RUN_TEST(test_fleet_sim_assumed_beacon_interval);
+
+#ifdef ALLOC_ACCOUNTING
+    // Allocation budget tests
+    RUN_TEST(test_allocations_command_pipeline);
+    RUN_TEST(test_allocations_encrypt);
+    RUN_TEST(test_allocations_node_sync);
+#endif
+
+    // Benchmarks
+    RUN_TEST(test_benchmark_nonce_generation);
+    RUN_TEST(test_benchmark_compressed_response);
+    RUN_TEST(test_benchmark_trace_replay);
+    RUN_TEST(test_benchmark_signatures);
+    RUN_TEST(test_benchmark_batch_hashing);
+    RUN_TEST(test_benchmark_snapshot_resume);
+    RUN_TEST(test_benchmark_merkle_batch);
+    RUN_TEST(test_benchmark_secret_decryption);
+    RUN_TEST(test_benchmark_fleet_sim);
 
     return UNITY_END();
 }
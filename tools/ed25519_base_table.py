@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""Generates src/Ed25519BaseTable.h, the fixed-base table used by Ed25519Fast.
+
+Row i holds (j + 1) * 16^(2i) * B for j = 0..7, each point stored as
+(y + x, y - x, 2 * d * x * y) in canonical little-endian form. Every row is
+guarded so that builds with fewer ED25519_BASE_TABLE_ROWS only keep the rows
+they use (every 32 / ED25519_BASE_TABLE_ROWS-th one).
+
+Usage: python3 tools/ed25519_base_table.py > src/Ed25519BaseTable.h
+"""
+
+import sys
+
+P = 2**255 - 19
+D = -121665 * pow(121666, P - 2, P) % P
+ROWS = 32
+ENTRIES = 8
+
+
+def add(a, b):
+    x1, y1 = a
+    x2, y2 = b
+    t = D * x1 * x2 * y1 * y2 % P
+    x3 = (x1 * y2 + x2 * y1) * pow(1 + t, P - 2, P) % P
+    y3 = (y1 * y2 + x1 * x2) * pow(1 - t, P - 2, P) % P
+    return x3, y3
+
+
+def multiply(point, n):
+    result = (0, 1)
+    while n:
+        if n & 1:
+            result = add(result, point)
+        point = add(point, point)
+        n >>= 1
+    return result
+
+
+def base_point():
+    y = 4 * pow(5, P - 2, P) % P
+    u = (y * y - 1) * pow(D * y * y + 1, P - 2, P) % P
+    x = pow(u, (P + 3) // 8, P)
+    if (x * x - u) % P:
+        x = x * pow(2, (P - 1) // 4, P) % P
+    if x & 1:
+        x = P - x
+    return x, y
+
+
+def encode(value):
+    return (value % P).to_bytes(32, "little")
+
+
+def main():
+    out = sys.stdout
+    out.write("// Generated by tools/ed25519_base_table.py, do not edit.\n")
+    out.write("#pragma once\n#include <cstdint>\n\n")
+    out.write("// Row i: (j + 1) * 16^(2i) * B as (y + x, y - x, 2dxy), 32 bytes each, little-endian\n")
+    out.write("static const uint8_t ED25519_BASE_TABLE[ED25519_BASE_TABLE_ROWS][%d][96] = {\n" % ENTRIES)
+    row_base = base_point()
+    for row in range(ROWS):
+        out.write("#if (%d %% (32 / ED25519_BASE_TABLE_ROWS)) == 0\n" % row)
+        out.write("    {\n")
+        point = row_base
+        for _ in range(ENTRIES):
+            x, y = point
+            data = encode(y + x) + encode(y - x) + encode(2 * D * x * y)
+            lines = [", ".join("0x%02x" % b for b in data[i:i + 16]) for i in range(0, 96, 16)]
+            out.write("        {" + (",\n         ".join(lines)) + "},\n")
+            point = add(point, row_base)
+        out.write("    },\n#endif\n")
+        row_base = multiply(row_base, 256)
+    out.write("};\n")
+
+
+if __name__ == "__main__":
+    main()